@@ -0,0 +1,63 @@
+import argparse
+import json
+import logging
+import sys
+
+# Compares two result files of the host microbenchmarks (sim/microbench.cpp, one JSON object per line), e.g. of the
+# commit before and after a change. Benchmarks are matched by name and parameters, the median ns per operation is
+# compared. Exits with 1 if a benchmark got slower by more than the threshold, so it can be used in scripts.
+
+
+def read_results(path: str) -> dict:
+    results = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith('{'):
+                continue
+            result = json.loads(line)
+            key = (result['benchmark'], json.dumps(result['params'], sort_keys=True))
+            results[key] = result
+    return results
+
+
+def format_params(params: str) -> str:
+    return ', '.join(f'{k}={v}' for k, v in json.loads(params).items())
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare two runs of the host microbenchmarks.')
+    parser.add_argument('base', type=str, help='Results of the reference run')
+    parser.add_argument('new', type=str, help='Results of the run to check')
+    parser.add_argument('--threshold', type=float, default=10, help='Slowdown in percent that counts as regression')
+
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+    base = read_results(args.base)
+    new = read_results(args.new)
+    regressions = 0
+    print(f'{"benchmark":36} {"params":34} {"base ns":>10} {"new ns":>10} {"change":>8}')
+    for key, result in new.items():
+        name, params = key
+        if key not in base:
+            logging.info(f'{name} ({format_params(params)}) is new')
+            continue
+        before = base[key]['ns_per_op']
+        after = result['ns_per_op']
+        change = (after - before) / before * 100 if before > 0 else 0
+        mark = ''
+        if change > args.threshold:
+            mark = '  <-- slower'
+            regressions += 1
+        print(f'{name:36} {format_params(params):34} {before:10.2f} {after:10.2f} {change:+7.1f}%{mark}')
+    for key in base.keys() - new.keys():
+        logging.warning(f'{key[0]} ({format_params(key[1])}) is missing in {args.new}')
+
+    if regressions:
+        logging.warning(f'{regressions} benchmarks are more than {args.threshold}% slower')
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
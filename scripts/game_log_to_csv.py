@@ -0,0 +1,124 @@
+import argparse
+import csv
+import logging
+import os
+import re
+import struct
+import sys
+
+# Converts a game log from the SD card (logs/game_NNN.bin, see src/gameLog.h) into CSV, one line per event with its
+# time in seconds since the boot. Sounds are logged as hashes of their filenames: the files in the given SD card
+# directory and the paths in src/sounds.h are hashed the same way to get the names back. Config values are named by
+# the keys in src/config.cpp, in the order of the definitions.
+# Record layout (little endian), keep in sync with src/gameLog.h: u64 time us, u8 type, u8 arg8, u16 arg16, u32 arg32
+
+RECORD = struct.Struct('<QBBHI')
+MAGIC = 0x474f4c47
+VERSION = 1
+EVENTS = ['padding', 'start', 'buzzers_open', 'buzzer_press', 'answering', 'timeout', 'round_closed', 'sound',
+          'config', 'lost']
+COLUMNS = ['time_s', 'event', 'team', 'place', 'since_open_ms', 'sound', 'prio', 'volume', 'dropped', 'playlist',
+           'config', 'value']
+SOUND_DROPPED = 1 << 8
+SOUND_PLAYLIST = 1 << 9
+SRC_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src')
+
+
+def hash_filename(filename: str) -> int:
+    """ FNV-1a like hashFilename() in src/audio/filenameHash.h """
+    h = 2166136261
+    for byte in filename.encode('utf-8'):
+        h ^= byte
+        h = (h * 16777619) & 0xffffffff
+    return h
+
+
+def sound_names(sd_dir: str) -> dict:
+    names = {}
+    try:
+        with open(os.path.join(SRC_DIR, 'sounds.h'), encoding='utf-8') as f:
+            for path in re.findall(r'"(/[^"]+)"', f.read()):
+                names[hash_filename(path)] = path
+    except OSError as e:
+        logging.warning(f'Cannot read the sound paths of the firmware: {e}')
+    if sd_dir:
+        for root, _, files in os.walk(sd_dir):
+            for file in files:
+                path = '/' + os.path.relpath(os.path.join(root, file), sd_dir).replace(os.sep, '/')
+                names[hash_filename(path)] = path
+    return names
+
+
+def config_names() -> list:
+    try:
+        with open(os.path.join(SRC_DIR, 'config.cpp'), encoding='utf-8') as f:
+            return re.findall(r'\.key = "([^"]+)"', f.read())
+    except OSError as e:
+        logging.warning(f'Cannot read the config keys of the firmware: {e}')
+        return []
+
+
+def decode(log_file: str, sounds: dict, configs: list, teams: list, writer):
+    def team(buzzer: int) -> str:
+        return teams[buzzer] if buzzer < len(teams) else str(buzzer)
+
+    with open(log_file, 'rb') as f:
+        data = f.read()
+    if len(data) % RECORD.size:
+        logging.warning(f'{log_file} ends with a partial record, it is ignored')
+    writer.writerow(COLUMNS)
+    events = 0
+    for offset in range(0, len(data) - len(data) % RECORD.size, RECORD.size):
+        time_us, event_type, arg8, arg16, arg32 = RECORD.unpack_from(data, offset)
+        if event_type == 0:
+            continue
+        if offset == 0 and (event_type != 1 or arg32 != MAGIC):
+            logging.error(f'{log_file} is no game log')
+            sys.exit(1)
+        if event_type >= len(EVENTS):
+            logging.warning(f'Unknown event {event_type} at offset {offset}')
+            continue
+        name = EVENTS[event_type]
+        row = {'time_s': f'{time_us / 1e6:.6f}', 'event': name}
+        if name == 'start' and arg16 != VERSION:
+            logging.warning(f'Log version {arg16}, this script knows version {VERSION}')
+        elif name == 'buzzer_press':
+            row.update(team=team(arg8), place=arg16 + 1, since_open_ms=f'{arg32 / 1000:.3f}' if arg32 else '')
+        elif name in ('answering', 'timeout', 'round_closed'):
+            row['team'] = team(arg8)
+        elif name == 'sound':
+            row.update(sound=sounds.get(arg32, f'#{arg32:08x}'), prio=arg8, volume=arg16 & 0xff,
+                       dropped=int(bool(arg16 & SOUND_DROPPED)), playlist=int(bool(arg16 & SOUND_PLAYLIST)))
+        elif name == 'config':
+            value = arg32 - (1 << 32) if arg32 & 0x80000000 else arg32
+            row.update(config=configs[arg8] if arg8 < len(configs) else str(arg8), value=value)
+        elif name == 'lost':
+            row['value'] = arg32
+            logging.warning(f'{arg32} events were lost at {time_us / 1e6:.3f}s, the ring buffer was full')
+        writer.writerow([row.get(column, '') for column in COLUMNS])
+        events += 1
+    logging.info(f'{events} events')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a game log of the buzzer into CSV.')
+    parser.add_argument('log', type=str, help='Game log (logs/game_NNN.bin on the SD card)')
+    parser.add_argument('--sd', type=str, default='', help='Copy of the SD card, to name the sounds')
+    parser.add_argument('--teams', type=str, default='ROT,BLAU', help='Names of the buzzers in the order of the table')
+    parser.add_argument('-o', '--output', type=str, default='', help='CSV file, default is stdout')
+
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+    sounds = sound_names(args.sd)
+    configs = config_names()
+    teams = args.teams.split(',')
+    if args.output:
+        with open(args.output, 'w', newline='', encoding='utf-8') as f:
+            decode(args.log, sounds, configs, teams, csv.writer(f))
+    else:
+        decode(args.log, sounds, configs, teams, csv.writer(sys.stdout))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,103 @@
+import argparse
+import csv
+import logging
+import os
+import struct
+import tempfile
+
+from trim_silence import find_trim, read_overrides, write_trimmed, OVERRIDE_FILE
+from wav_to_adpcm import convert
+
+# Packs the fixed sounds into an image for the "soundbank" flash partition (see partitions.csv).
+# Layout (little endian), keep in sync with src/audio/soundBank.h:
+#   header: magic "SBNK", u16 version, u16 count, u32 total size
+#   table of contents: count entries of char[56] name, u32 offset, u32 length
+#   data: the files, 4 byte aligned
+
+MAGIC = b'SBNK'
+VERSION = 1
+NAME_LEN = 56
+HEADER = struct.Struct('<4sHHI')
+ENTRY = struct.Struct(f'<{NAME_LEN}sII')
+
+# Sounds from sounds.h that are played all the time
+DEFAULT_SOUNDS = [
+    'buzzer/ding.wav',
+    'random/egon_kurz.wav',
+    'random/egon_komplett.wav',
+    'random/time-for-a-drink.wav',
+]
+
+
+def get_partition(partitions_file: str, name: str) -> (int, int):
+    """ Get offset and size of a partition from the partition table """
+    with open(partitions_file) as f:
+        rows = [r for r in csv.reader(f) if r and not r[0].strip().startswith('#')]
+    for row in rows:
+        if row[0].strip() == name:
+            return int(row[3].strip(), 0), int(row[4].strip(), 0)
+    raise ValueError(f'No partition {name} in {partitions_file}')
+
+
+def pack(root_dir: str, sounds: list, output_file: str, max_size: int, adpcm: bool, trim: bool):
+    files = []
+    overrides = read_overrides(os.path.join(root_dir, OVERRIDE_FILE)) if trim else {}
+    with tempfile.TemporaryDirectory() as tmp:
+        for sound in sounds:
+            path = os.path.join(root_dir, sound)
+            name = '/' + sound.replace(os.sep, '/')
+            # The trim index of the SD card does not apply to the bank, so the silence is cut off here
+            audible = None
+            if trim and sound.lower().endswith('.wav'):
+                audible = find_trim(path, -50, 10, False, overrides.get(name, (None, None)))
+            if audible:
+                trimmed = os.path.join(tmp, 'trimmed', sound)
+                write_trimmed(path, trimmed, audible)
+                path = trimmed
+            if adpcm and sound.lower().endswith('.wav'):
+                converted = os.path.join(tmp, sound)
+                convert(path, converted, True, 512)
+                path = converted
+            with open(path, 'rb') as f:
+                files.append((name, f.read()))
+
+    offset = HEADER.size + ENTRY.size * len(files)
+    toc = b''
+    data = b''
+    for name, content in files:
+        if len(name.encode()) >= NAME_LEN:
+            raise ValueError(f'Name {name} is too long (max {NAME_LEN - 1} chars)')
+        padding = (-(offset + len(data))) % 4
+        data += b'\0' * padding
+        toc += ENTRY.pack(name.encode(), offset + len(data), len(content))
+        logging.info(f'{name}: {len(content)} bytes at {offset + len(data):#x}')
+        data += content
+
+    total_size = offset + len(data)
+    if total_size > max_size:
+        raise ValueError(f'Sound bank has {total_size} bytes, partition only {max_size} (try --adpcm)')
+
+    with open(output_file, 'wb') as f:
+        f.write(HEADER.pack(MAGIC, VERSION, len(files), total_size) + toc + data)
+    logging.info(f'Wrote {output_file} with {len(files)} sounds, {total_size} of {max_size} bytes used')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack sounds into an image for the soundbank flash partition.')
+    parser.add_argument('--dir', type=str, default='../wav', help='Root directory, same layout as the SD card')
+    parser.add_argument('--output', type=str, default='soundbank.bin', help='Output file, default: soundbank.bin')
+    parser.add_argument('--partitions', type=str, default='../partitions.csv', help='Partition table')
+    parser.add_argument('--adpcm', action='store_true', help='Convert WAV files to mono IMA-ADPCM to save space')
+    parser.add_argument('--trim', action='store_true', help='Cut off the silence at the start of WAV files')
+    parser.add_argument('sounds', nargs='*', default=DEFAULT_SOUNDS, help='Sounds relative to --dir')
+
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+    partition_offset, partition_size = get_partition(args.partitions, 'soundbank')
+    pack(args.dir, args.sounds, args.output, partition_size, args.adpcm, args.trim)
+    logging.info(f'Flash with: esptool.py write_flash {partition_offset:#x} {args.output}')
+
+
+if __name__ == "__main__":
+    main()
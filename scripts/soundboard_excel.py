@@ -125,7 +125,7 @@ def directory_excel_generator(root_dir: str, output_file: str, flat: bool = Fals
                 name = m.group(2)
 
                 filenames[index] = name
-                if add_duration:
+                if add_duration and file.lower().endswith('.wav'):
                     minutes, sec = get_sound_length(os.path.join(subdir['path'], file))
                     filenames[index] += f' ({minutes}:{sec:02d})'
             except (IndexError, NameError, AttributeError):
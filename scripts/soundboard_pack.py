@@ -0,0 +1,71 @@
+import argparse
+import logging
+import os
+import struct
+
+# Packs the soundboard sounds into one file for the SD card root (see src/audio/soundPack.h). Opening a sound
+# is then a seek in this file instead of a walk through the FAT directories.
+# Layout (little endian), keep in sync with src/audio/soundPack.h:
+#   header: magic "SPAK", u16 version, u16 count, u32 data start
+#   table of contents: count entries of char[120] name, u32 offset, u32 length
+#   data: the files, each starting at a 512 byte (SD sector) boundary
+
+MAGIC = b'SPAK'
+VERSION = 1
+NAME_LEN = 120
+SECTOR = 512
+HEADER = struct.Struct('<4sHHI')
+ENTRY = struct.Struct(f'<{NAME_LEN}sII')
+SOUND_EXTENSIONS = ('.wav', '.mp3')
+
+
+def find_sounds(root_dir: str, board_dir: str) -> list:
+    """ Find the sounds like readFiles() in soundboard.cpp does: one level of page directories with the files """
+    sounds = []
+    board_path = os.path.join(root_dir, board_dir)
+    for page in sorted(os.listdir(board_path)):
+        page_path = os.path.join(board_path, page)
+        if not os.path.isdir(page_path) or '_' not in page:
+            continue
+        for file in sorted(os.listdir(page_path)):
+            if file.lower().endswith(SOUND_EXTENSIONS) and '_' in file:
+                sounds.append(f'/{board_dir}/{page}/{file}')
+    return sounds
+
+
+def pack(root_dir: str, sounds: list, output_file: str):
+    data_start = HEADER.size + ENTRY.size * len(sounds)
+    data_start += (-data_start) % SECTOR
+    toc = b''
+    offset = data_start
+    with open(output_file, 'wb') as out:
+        out.seek(data_start)
+        for name in sounds:
+            if len(name.encode()) >= NAME_LEN:
+                raise ValueError(f'Name {name} is too long (max {NAME_LEN - 1} chars)')
+            with open(os.path.join(root_dir, name.lstrip('/')), 'rb') as f:
+                content = f.read()
+            toc += ENTRY.pack(name.encode(), offset, len(content))
+            out.write(content + b'\0' * ((-len(content)) % SECTOR))
+            logging.debug(f'{name}: {len(content)} bytes at {offset:#x}')
+            offset += len(content) + (-len(content)) % SECTOR
+
+        out.seek(0)
+        out.write(HEADER.pack(MAGIC, VERSION, len(sounds), data_start) + toc)
+    logging.info(f'Wrote {output_file} with {len(sounds)} sounds, {offset} bytes')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack the soundboard sounds into one file for the SD card.')
+    parser.add_argument('--dir', type=str, default='../wav', help='Root directory, same layout as the SD card')
+    parser.add_argument('--output', type=str, default='soundboard.pak', help='Output file, default: soundboard.pak')
+
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+    pack(args.dir, find_sounds(args.dir, 'soundboard'), args.output)
+    logging.info(f'Copy {args.output} to the root of the SD card')
+
+
+if __name__ == "__main__":
+    main()
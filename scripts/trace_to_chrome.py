@@ -0,0 +1,97 @@
+import argparse
+import json
+import logging
+import sys
+
+# Converts a dump of the trace points (src/tracePoints.h) into the Chrome trace event format, to be opened in
+# https://ui.perfetto.dev or chrome://tracing. The dump is the text between "TRACE DUMP" and "TRACE END" in a log of
+# the serial port (e.g. from "pio device monitor | tee serial.log" after sending 't'), the last one in the file is
+# used. Every core is a process and every task a thread in the trace. The cycle counters wrap every 18s at 240MHz,
+# they are unwrapped per core, so events of a core must not be further apart than that. The counters of the two
+# cores are not synchronized exactly, compare times across cores with care.
+
+WRAP = 1 << 32
+
+
+def read_dump(path: str):
+    header = None
+    events = []
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\r\n')
+            start = line.find('TRACE DUMP')
+            if start >= 0:
+                header = dict(item.split('=') for item in line[start:].split()[2:])
+                events = []
+            elif line.startswith('TRACE END'):
+                if header is None:
+                    logging.warning('End of a dump without its start')
+            elif header is not None:
+                fields = line.split('\t')
+                if len(fields) == 5 and fields[0].isdigit():
+                    events.append((int(fields[0]), int(fields[1]), fields[2], fields[3], fields[4]))
+    return header, events
+
+
+def convert(header: dict, events: list) -> dict:
+    mhz = int(header.get('cpu_mhz', 240))
+    last = {}
+    first_us = None
+    trace_events = []
+    tids = {}
+    open_spans = {}
+    for cycles, core, kind, task, name in events:
+        # Unwrap: the counter value closest to the latest one of the core, events may be written slightly out of order
+        if core in last:
+            delta = (cycles - last[core]) % WRAP
+            unwrapped = last[core] + (delta - WRAP if delta >= WRAP // 2 else delta)
+            last[core] = max(last[core], unwrapped)
+        else:
+            unwrapped = last[core] = cycles
+        us = unwrapped / mhz
+        if first_us is None:
+            first_us = us
+        tid = tids.setdefault((core, task), len(tids) + 1)
+        key = (core, task)
+        if kind == 'E':
+            # Spans that started before the oldest event in the ring are left out
+            if not open_spans.get(key):
+                continue
+            open_spans[key].pop()
+        elif kind == 'B':
+            open_spans.setdefault(key, []).append(name)
+        trace_events.append({'name': name, 'ph': kind, 'ts': round(us - first_us, 3), 'pid': core, 'tid': tid,
+                             **({'s': 't'} if kind == 'i' else {})})
+
+    for (core, task), tid in tids.items():
+        trace_events.append({'name': 'thread_name', 'ph': 'M', 'pid': core, 'tid': tid, 'args': {'name': task}})
+    for core in sorted({core for core, _ in tids}):
+        trace_events.append({'name': 'process_name', 'ph': 'M', 'pid': core, 'args': {'name': f'Core {core}'}})
+    for key, names in open_spans.items():
+        if names:
+            logging.info(f'{len(names)} spans of {key[1]} on core {key[0]} still open at the end ({", ".join(names)})')
+    return {'traceEvents': trace_events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a trace point dump of the buzzer into a Chrome trace.')
+    parser.add_argument('log', type=str, help='Serial log (or stress harness output) with a trace dump')
+    parser.add_argument('-o', '--output', type=str, default='trace.json', help='Chrome trace JSON file')
+
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+    header, events = read_dump(args.log)
+    if header is None:
+        logging.error(f'No trace dump in {args.log}')
+        sys.exit(1)
+    if int(header.get('overwritten', 0)):
+        logging.info(f'{header["overwritten"]} older events were overwritten in the ring')
+    trace = convert(header, events)
+    with open(args.output, 'w') as f:
+        json.dump(trace, f)
+    logging.info(f'{len(events)} events written to {args.output}')
+
+
+if __name__ == "__main__":
+    main()
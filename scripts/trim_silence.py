@@ -0,0 +1,192 @@
+import argparse
+import logging
+import math
+import os
+import struct
+from array import array
+from collections import namedtuple
+
+from wav_to_adpcm import AdpcmState, WAVE_FORMAT_IMA_ADPCM
+
+# Finds the silence at the start (and optionally the end) of WAV files and writes the byte offsets of the audible
+# part to a trim index. Copy the index to the SD card root together with the sounds, the SoundPlayer then skips
+# the silence when playing. Layout of a line, keep in sync with src/audio/soundTrim.h:
+#   filename;data chunk start;first played byte;byte after the last played one
+# Single files can be set by hand in the override file (same directory):
+#   filename;start in ms;end in ms
+# An empty field means automatic detection, e.g. "/buzzer/ding.wav;0;" never trims the start of ding.wav.
+
+WAVE_FORMAT_PCM = 1
+INDEX_FILE = 'trim.txt'
+OVERRIDE_FILE = 'trim_override.txt'
+MIN_TRIM_MS = 5  # Less is not worth it
+
+WavFormat = namedtuple('WavFormat', 'tag channels rate block_align bits')
+Trim = namedtuple('Trim', 'data_start start end')
+
+
+def read_wav(data: bytes) -> (WavFormat, int, int):
+    """ Parse the chunks of a WAV file, returns the format, offset and size of the data chunk """
+    if data[:4] != b'RIFF' or data[8:12] != b'WAVE':
+        raise ValueError('No WAV file')
+    pos = 12
+    fmt = None
+    while pos + 8 <= len(data):
+        chunk_id, size = struct.unpack_from('<4sI', data, pos)
+        if chunk_id == b'fmt ':
+            tag, channels, rate, _, block_align, bits = struct.unpack_from('<HHIIHH', data, pos + 8)
+            fmt = WavFormat(tag, channels, rate, block_align, bits)
+        elif chunk_id == b'data':
+            if fmt is None:
+                raise ValueError('Data chunk before format chunk')
+            return fmt, pos + 8, min(size, len(data) - pos - 8)
+        pos += 8 + size + (size & 1)
+    raise ValueError('No data chunk')
+
+
+def get_peaks(data: bytes, fmt: WavFormat) -> (list, int):
+    """ Peak level (0..32768) per unit of the data chunk and the frames per unit.
+        A unit is a frame for PCM and a block for IMA-ADPCM, as that can only be decoded as a whole. """
+    if fmt.tag == WAVE_FORMAT_PCM and fmt.bits == 16:
+        samples = array('h', data[:len(data) // 2 * 2])
+        if samples.itemsize != 2:
+            raise ValueError('No 16 bit array type')
+        levels = [abs(s) for s in samples]
+        c = fmt.channels
+        return [max(levels[i:i + c]) for i in range(0, len(levels) - c + 1, c)], 1
+    if fmt.tag == WAVE_FORMAT_PCM and fmt.bits == 8:
+        c = fmt.channels
+        levels = [abs(b - 128) << 8 for b in data]
+        return [max(levels[i:i + c]) for i in range(0, len(levels) - c + 1, c)], 1
+    if fmt.tag == WAVE_FORMAT_IMA_ADPCM:
+        c = fmt.channels
+        frames_per_block = (fmt.block_align - 4 * c) * 2 // c + 1
+        peaks = []
+        for pos in range(0, len(data) - 4 * c, fmt.block_align):
+            block = data[pos:pos + fmt.block_align]
+            states = []
+            peak = 0
+            for ch in range(c):
+                predictor, index = struct.unpack_from('<hB', block, 4 * ch)
+                states.append(AdpcmState(predictor, min(index, 88)))
+                peak = max(peak, abs(predictor))
+            body = block[4 * c:]
+            for i, b in enumerate(body):
+                # Mono: bytes in order, stereo: 4 bytes per channel alternating
+                state = states[0] if c == 1 else states[(i // 4) % 2]
+                peak = max(peak, abs(state.decode(b & 0x0f)), abs(state.decode(b >> 4)))
+            peaks.append(peak)
+        return peaks, frames_per_block
+    raise ValueError(f'Format {fmt.tag:#x} with {fmt.bits} bits is not supported')
+
+
+def find_trim(file: str, threshold_db: float, pad_ms: int, tail: bool, override: tuple = (None, None)):
+    """ Find the audible part of a WAV file, returns a Trim or None if there is nothing to trim """
+    with open(file, 'rb') as f:
+        content = f.read()
+    fmt, data_start, data_size = read_wav(content)
+    peaks, frames_per_unit = get_peaks(content[data_start:data_start + data_size], fmt)
+    unit_bytes = fmt.block_align
+    units = data_size // unit_bytes
+    if not peaks:
+        return None
+
+    def ms_to_units(ms: int, round_up: bool) -> int:
+        frames = ms * fmt.rate / 1000 / frames_per_unit
+        return min(units, math.ceil(frames) if round_up else int(frames))
+
+    threshold = 32768 * 10 ** (threshold_db / 20)
+    audible = [i for i, p in enumerate(peaks) if p > threshold]
+    if not audible:
+        logging.warning(f'{file} is silent, not trimmed')
+        return None
+    pad = ms_to_units(pad_ms, True)
+
+    start_ms, end_ms = override
+    first = ms_to_units(start_ms, False) if start_ms is not None else max(0, audible[0] - pad)
+    if start_ms is None and first < ms_to_units(MIN_TRIM_MS, True):
+        first = 0
+    if end_ms is not None:
+        last = ms_to_units(end_ms, True)
+    elif tail:
+        last = min(units, audible[-1] + 1 + pad)
+        if units - last < ms_to_units(MIN_TRIM_MS, True):
+            last = units
+    else:
+        last = units
+    if first >= last:
+        raise ValueError(f'Nothing left to play (start {first}, end {last})')
+
+    start = data_start + first * unit_bytes
+    # The last partial block of ADPCM files is still played
+    end = data_start + last * unit_bytes if last < units else data_start + data_size
+    if start == data_start and end == data_start + data_size:
+        return None
+    logging.info(f'{file}: {first * frames_per_unit * 1000 // fmt.rate}ms silence at the start, '
+                 f'{(units - last) * frames_per_unit * 1000 // fmt.rate}ms at the end trimmed')
+    return Trim(data_start, start, end)
+
+
+def write_trimmed(src: str, dst: str, trim: Trim):
+    """ Write a copy of a WAV file that only contains the audible part """
+    with open(src, 'rb') as f:
+        content = f.read()
+    data = content[trim.start:trim.end]
+    header = bytearray(content[:trim.data_start])
+    struct.pack_into('<I', header, trim.data_start - 4, len(data))
+    out = header + data + (b'\0' if len(data) & 1 else b'')
+    struct.pack_into('<I', out, 4, len(out) - 8)
+    os.makedirs(os.path.dirname(dst) or '.', exist_ok=True)
+    with open(dst, 'wb') as f:
+        f.write(out)
+
+
+def read_overrides(file: str) -> dict:
+    overrides = {}
+    if not os.path.exists(file):
+        return overrides
+    with open(file) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            name, start_ms, end_ms = (line.split(';') + ['', ''])[:3]
+            overrides[name] = (int(start_ms) if start_ms.strip() else None, int(end_ms) if end_ms.strip() else None)
+    return overrides
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Write the trim index with the silence to skip in WAV files.')
+    parser.add_argument('--dir', type=str, default='../wav', help='Root directory, same layout as the SD card')
+    parser.add_argument('--threshold_db', type=float, default=-50, help='Level below which audio is silence')
+    parser.add_argument('--pad_ms', type=int, default=10, help='Silence to keep before the audio starts')
+    parser.add_argument('--tail', action='store_true', help='Also trim the silence at the end')
+
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+    overrides = read_overrides(os.path.join(args.dir, OVERRIDE_FILE))
+    lines = []
+    for root, _, files in os.walk(args.dir):
+        for file in sorted(files):
+            if not file.lower().endswith('.wav'):
+                continue
+            path = os.path.join(root, file)
+            name = '/' + os.path.relpath(path, args.dir).replace(os.sep, '/')
+            try:
+                trim = find_trim(path, args.threshold_db, args.pad_ms, args.tail, overrides.get(name, (None, None)))
+            except ValueError as e:
+                logging.warning(f'Skipping {path}: {e}')
+                continue
+            if trim:
+                lines.append(f'{name};{trim.data_start};{trim.start};{trim.end}')
+
+    index = os.path.join(args.dir, INDEX_FILE)
+    with open(index, 'w', newline='\n') as f:
+        f.write('# Generated by scripts/trim_silence.py: filename;data start;start;end (bytes)\n')
+        f.write('\n'.join(lines) + '\n')
+    logging.info(f'Wrote {index} with {len(lines)} trimmed sounds')
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,164 @@
+import argparse
+import logging
+import os
+import struct
+import wave
+
+# Converts WAV files to IMA-ADPCM WAV (format tag 0x11, 4 bits per sample) that the SoundPlayer can play.
+# These need a quarter of the space of 16 bit PCM, so four times as many sounds fit into RAM and SD reads per
+# stream drop by the same factor.
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+    107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+    5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+    27086, 29794, 32767
+]
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+
+WAVE_FORMAT_IMA_ADPCM = 0x11
+
+
+class AdpcmState:
+    def __init__(self, predictor: int = 0, index: int = 0):
+        self.predictor = predictor
+        self.index = index
+
+    def encode(self, sample: int) -> int:
+        step = STEP_TABLE[self.index]
+        diff = sample - self.predictor
+        nibble = 0
+        if diff < 0:
+            nibble = 8
+            diff = -diff
+        vpdiff = step >> 3
+        if diff >= step:
+            nibble |= 4
+            diff -= step
+            vpdiff += step
+        if diff >= step >> 1:
+            nibble |= 2
+            diff -= step >> 1
+            vpdiff += step >> 1
+        if diff >= step >> 2:
+            nibble |= 1
+            vpdiff += step >> 2
+        self.predictor += -vpdiff if nibble & 8 else vpdiff
+        self.predictor = max(-32768, min(32767, self.predictor))
+        self.index = max(0, min(88, self.index + INDEX_TABLE[nibble]))
+        return nibble
+
+    def decode(self, nibble: int) -> int:
+        step = STEP_TABLE[self.index]
+        vpdiff = step >> 3
+        if nibble & 4:
+            vpdiff += step
+        if nibble & 2:
+            vpdiff += step >> 1
+        if nibble & 1:
+            vpdiff += step >> 2
+        self.predictor += -vpdiff if nibble & 8 else vpdiff
+        self.predictor = max(-32768, min(32767, self.predictor))
+        self.index = max(0, min(88, self.index + INDEX_TABLE[nibble]))
+        return self.predictor
+
+
+def read_pcm16(file: str, mono: bool) -> (list, int, int):
+    """ Read a WAV file and return a list of channels with signed 16 bit samples, the rate and the channel count """
+    with wave.open(file, 'rb') as w:
+        channels = w.getnchannels()
+        width = w.getsampwidth()
+        rate = w.getframerate()
+        raw = w.readframes(w.getnframes())
+
+    if width == 1:
+        samples = [(b - 128) << 8 for b in raw]
+    elif width == 2:
+        samples = list(struct.unpack(f'<{len(raw) // 2}h', raw))
+    else:
+        raise ValueError(f'{width * 8} bit samples are not supported')
+
+    data = [samples[c::channels] for c in range(channels)]
+    if mono and channels > 1:
+        data = [[sum(frame) // channels for frame in zip(*data)]]
+        channels = 1
+    return data, rate, channels
+
+
+def encode_blocks(data: list, channels: int, block_align: int) -> (bytes, int):
+    """ Encode the channels into ADPCM blocks, returns the data and the number of samples per block """
+    samples_per_block = (block_align - 4 * channels) * 2 // channels + 1
+    frames = len(data[0])
+    states = [AdpcmState() for _ in range(channels)]
+    out = bytearray()
+
+    for start in range(0, frames, samples_per_block):
+        # Pad the last block with silence
+        block = [ch[start:start + samples_per_block] for ch in data]
+        block = [b + [0] * (samples_per_block - len(b)) for b in block]
+
+        nibbles = []
+        for c in range(channels):
+            states[c].predictor = block[c][0]
+            out += struct.pack('<hBB', block[c][0], states[c].index, 0)
+            nibbles.append([states[c].encode(s) for s in block[c][1:]])
+
+        if channels == 1:
+            n = nibbles[0]
+            out += bytes(n[i] | (n[i + 1] << 4) for i in range(0, len(n), 2))
+        else:
+            # 8 samples (4 bytes) per channel, alternating
+            for g in range(0, len(nibbles[0]), 8):
+                for c in range(channels):
+                    n = nibbles[c][g:g + 8]
+                    out += bytes(n[i] | (n[i + 1] << 4) for i in range(0, 8, 2))
+    return bytes(out), samples_per_block
+
+
+def convert(src: str, dst: str, mono: bool, block_size: int):
+    data, rate, channels = read_pcm16(src, mono)
+    block_align = block_size * channels
+    encoded, samples_per_block = encode_blocks(data, channels, block_align)
+
+    fmt = struct.pack('<HHIIHHHH', WAVE_FORMAT_IMA_ADPCM, channels, rate, rate * block_align // samples_per_block,
+                      block_align, 4, 2, samples_per_block)
+    fact = struct.pack('<I', len(data[0]))
+    chunks = b'fmt ' + struct.pack('<I', len(fmt)) + fmt + b'fact' + struct.pack('<I', len(fact)) + fact
+    chunks += b'data' + struct.pack('<I', len(encoded)) + encoded
+    if len(encoded) & 1:
+        chunks += b'\0'
+
+    os.makedirs(os.path.dirname(dst) or '.', exist_ok=True)
+    with open(dst, 'wb') as f:
+        f.write(b'RIFF' + struct.pack('<I', 4 + len(chunks)) + b'WAVE' + chunks)
+    logging.info(f'{src} -> {dst}: {os.path.getsize(src)} -> {os.path.getsize(dst)} bytes')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert WAV files to IMA-ADPCM WAV files.')
+    parser.add_argument('input', type=str, help='WAV file or directory (converted recursively)')
+    parser.add_argument('output', type=str, help='Output file or directory')
+    parser.add_argument('--mono', action='store_true', help='Mix stereo files down to mono')
+    parser.add_argument('--block_size', type=int, default=512, help='Block size per channel in bytes, default: 512')
+
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+    if os.path.isdir(args.input):
+        for root, _, files in os.walk(args.input):
+            for file in files:
+                if not file.lower().endswith('.wav'):
+                    continue
+                src = os.path.join(root, file)
+                dst = os.path.join(args.output, os.path.relpath(src, args.input))
+                try:
+                    convert(src, dst, args.mono, args.block_size)
+                except (wave.Error, ValueError) as e:
+                    logging.warning(f'Skipping {src}: {e}')
+    else:
+        convert(args.input, args.output, args.mono, args.block_size)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,346 @@
+/*
+ * Latency benchmark on the host simulation
+ * Runs the firmware's setup() and loop() on the virtual clock and presses buzzers and buttons, either from a script
+ * or randomly. Reported are the times from a press to the buzzer LED, to the sound request and to the first
+ * display update, and the duration of loop(). All times are virtual (see simHal.h), so a run is reproducible and
+ * differences between commits come from the firmware.
+ *
+ * Script lines: <time ms> <input> [hold ms], inputs are buzzer:red|blue, push:yellow|red|black|green|white|blue
+ * and lcd:up|left|down|right|enter. Lines starting with # are ignored.
+ *
+ * If the SD directory contains an input trace to replay (see inputTrace.h), the trace is run instead and the
+ * outputs are compared with the recorded ones. With --record 1 the run records a trace into the SD directory, to be
+ * renamed to replay.bin and replayed by a later run (e.g. after a change that should not alter the behaviour).
+ * The game log (gameLog.h) is off unless --game-log 1 is given, it is then written to logs/ in the SD directory.
+ */
+
+#include "simHal.h"
+#include "distribution.h"
+#include "SD.h"
+#include "pins.h"
+#include "inputs.h"
+#include "sounds.h"
+#include "inputTrace.h"
+#include "gameLog.h"
+#include "config.h"
+#include <Preferences.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+// ADC readings of the buttons, keep in sync with inputs.cpp
+static const std::map<std::string, uint16_t> pushReadings = {
+   { "none", 3513 }, { "yellow", 1643 }, { "red", 2278 }, { "black", 0 }, { "green", 1073 }, { "white", 2913 },
+   { "blue", 439 },
+};
+static const std::map<std::string, uint16_t> lcdReadings = {
+   { "none", 3626 }, { "up", 2384 }, { "left", 150 }, { "down", 471 }, { "right", 1700 }, { "enter", 1012 },
+};
+
+enum PressKind
+{
+   PRESS_BUZZER,
+   PRESS_PUSH,
+   PRESS_LCD,
+   PRESS_KIND_COUNT
+};
+
+static const char* pressKindNames[PRESS_KIND_COUNT] = { "buzzer", "push", "lcd" };
+
+struct Press
+{
+   uint64_t atUs;
+   uint32_t holdMs;
+   PressKind kind;
+   std::string button;
+   bool ledSeen = false;
+   bool soundSeen = false;
+   bool displaySeen = false;
+};
+
+struct Options
+{
+   std::string sdDir = "wav";
+   std::string script;
+   int presses = 300;
+   uint32_t seed = 1;
+   uint16_t noise = 0;
+   int logLevel = ESP_LOG_WARN;
+   bool record = false;
+   bool gameLog = false;
+};
+
+static void usage(const char* name)
+{
+   fprintf(stderr, "Usage: %s [--sd dir] [--script file] [--presses n] [--seed n] [--noise lsb] [--log 0-5] [--record 0|1] "
+                   "[--game-log 0|1]\n", name);
+}
+
+static bool parseArgs(int argc, char** argv, Options& options)
+{
+   for (int i = 1; i < argc; i++)
+   {
+      std::string arg = argv[i];
+      if (i + 1 >= argc) return false;
+      const char* value = argv[++i];
+      if (arg == "--sd") options.sdDir = value;
+      else if (arg == "--script") options.script = value;
+      else if (arg == "--presses") options.presses = atoi(value);
+      else if (arg == "--seed") options.seed = (uint32_t)strtoul(value, nullptr, 10);
+      else if (arg == "--noise") options.noise = (uint16_t)atoi(value);
+      else if (arg == "--log") options.logLevel = atoi(value);
+      else if (arg == "--record") options.record = atoi(value) != 0;
+      else if (arg == "--game-log") options.gameLog = atoi(value) != 0;
+      else return false;
+   }
+   return true;
+}
+
+static bool parsePress(const std::string& input, Press& press)
+{
+   size_t colon = input.find(':');
+   if (colon == std::string::npos) return false;
+   std::string kind = input.substr(0, colon);
+   press.button = input.substr(colon + 1);
+   if (kind == "buzzer" && (press.button == "red" || press.button == "blue")) press.kind = PRESS_BUZZER;
+   else if (kind == "push" && pushReadings.count(press.button) && press.button != "none") press.kind = PRESS_PUSH;
+   else if (kind == "lcd" && lcdReadings.count(press.button) && press.button != "none") press.kind = PRESS_LCD;
+   else return false;
+   return true;
+}
+
+static bool readScript(const std::string& path, std::vector<Press>& presses)
+{
+   std::ifstream file(path);
+   if (!file) return false;
+   std::string line;
+   int lineNumber = 0;
+   while (std::getline(file, line))
+   {
+      lineNumber++;
+      if (line.empty() || line[0] == '#') continue;
+      std::istringstream fields(line);
+      double atMs;
+      std::string input;
+      Press press{};
+      press.holdMs = 100;
+      if (!(fields >> atMs >> input) || !parsePress(input, press))
+      {
+         fprintf(stderr, "%s:%d: invalid line\n", path.c_str(), lineNumber);
+         return false;
+      }
+      fields >> press.holdMs;
+      press.atUs = (uint64_t)(atMs * 1000);
+      presses.push_back(press);
+   }
+   std::stable_sort(presses.begin(), presses.end(), [](const Press& a, const Press& b) { return a.atUs < b.atUs; });
+   return true;
+}
+
+/**
+ * \brief Random presses like during a show: mostly soundboard, some buzzers and page changes
+ */
+static void generatePresses(int count, uint32_t seed, uint64_t startUs, std::vector<Press>& presses)
+{
+   static const char* const pushButtons[] = { "yellow", "red", "black", "green", "white", "blue" };
+   static const char* const lcdButtons[] = { "left", "right", "right", "enter" };
+   std::mt19937 rng(seed);
+   auto uniform = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+   uint64_t t = startUs;
+   for (int i = 0; i < count; i++)
+   {
+      Press press{};
+      int pick = uniform(0, 99);
+      if (pick < 25) parsePress(std::string("buzzer:") + (uniform(0, 1) ? "red" : "blue"), press);
+      else if (pick < 80) parsePress(std::string("push:") + pushButtons[uniform(0, 5)], press);
+      else parsePress(std::string("lcd:") + lcdButtons[uniform(0, 3)], press);
+      // Presses start anywhere within a loop period
+      t += (uint64_t)uniform(200, 1500) * 1000 + (uint64_t)uniform(0, 4999);
+      press.atUs = t;
+      press.holdMs = uniform(80, 250);
+      t += (uint64_t)press.holdMs * 1000;
+      presses.push_back(press);
+   }
+}
+
+static void schedulePress(const Press& press)
+{
+   uint64_t releaseUs = press.atUs + (uint64_t)press.holdMs * 1000;
+   switch (press.kind)
+   {
+      case PRESS_BUZZER:
+      {
+         uint8_t pin = press.button == "red" ? RED_BUZZER_INPUT : BLUE_BUZZER_INPUT;
+         sim::scheduleDigital(press.atUs, pin, LOW);
+         sim::scheduleDigital(releaseUs, pin, HIGH);
+         break;
+      }
+      case PRESS_PUSH:
+         sim::scheduleAnalog(press.atUs, PUSH_BUTTONS_ANALOG_PIN, pushReadings.at(press.button));
+         sim::scheduleAnalog(releaseUs, PUSH_BUTTONS_ANALOG_PIN, pushReadings.at("none"));
+         break;
+      case PRESS_LCD:
+         sim::scheduleAnalog(press.atUs, LCD_BUTTONS_ANALOG_PIN, lcdReadings.at(press.button));
+         sim::scheduleAnalog(releaseUs, LCD_BUTTONS_ANALOG_PIN, lcdReadings.at("none"));
+         break;
+      default:
+         break;
+   }
+}
+
+// Later output is not caused by the press (e.g. an LCD button that does nothing in page jump mode)
+static constexpr uint64_t MAX_RESPONSE_US = 1000000;
+
+/**
+ * \brief Latest press of a kind that has already happened, earlier presses without the response are left out
+ * \param seen Response flag of the press
+ * \return Press or nullptr if there is none waiting for this response
+ */
+static Press* findPress(std::vector<Press>& presses, PressKind kind, bool Press::* seen)
+{
+   Press* found = nullptr;
+   uint64_t now = sim::now();
+   for (auto& press: presses)
+   {
+      if (press.atUs > now) break;
+      if (press.kind == kind && !(press.*seen) && now - press.atUs <= MAX_RESPONSE_US) found = &press;
+   }
+   if (found) found->*seen = true;
+   return found;
+}
+
+int main(int argc, char** argv)
+{
+   Options options;
+   if (!parseArgs(argc, argv, options))
+   {
+      usage(argv[0]);
+      return 2;
+   }
+   esp_log_level_set("*", (esp_log_level_t)options.logLevel);
+   SD.setRoot(options.sdDir);
+   if (!SD.exists("/soundboard")) fprintf(stderr, "No soundboard directory in %s\n", options.sdDir.c_str());
+
+   // Idle levels: buzzers are active low, the button ladders read "none"
+   sim::setDigital(RED_BUZZER_INPUT, HIGH);
+   sim::setDigital(BLUE_BUZZER_INPUT, HIGH);
+   sim::setAnalog(PUSH_BUTTONS_ANALOG_PIN, pushReadings.at("none"));
+   sim::setAnalog(LCD_BUTTONS_ANALOG_PIN, lcdReadings.at("none"));
+   sim::setAnalogNoise(options.noise, options.seed);
+   randomSeed(options.seed);
+
+   // Switched on or off before the boot, so the trace starts in the same state as a replay of it
+   Preferences preferences;
+   preferences.begin("buzzer", false);
+   if (options.record) preferences.putInt(configDef[CFG_INPUT_TRACE].key, 1);
+   preferences.putInt(configDef[CFG_GAME_LOG].key, options.gameLog);
+   preferences.end();
+
+   setup();
+   uint64_t setupUs = sim::now();
+
+   if (inputTrace.isReplaying())
+   {
+      while (inputTrace.isReplaying()) loop();
+      const InputTraceReplayResult& result = inputTrace.getReplayResult();
+      printf("Replayed %u records over %.1fs virtual: %u with different outputs\n", result.records,
+             (sim::now() - setupUs) / 1e6, result.mismatches);
+      if (result.mismatches) printf("First difference at %ums\n", result.firstMismatchMs);
+      return result.mismatches ? 1 : 0;
+   }
+
+   std::vector<Press> presses;
+   if (!options.script.empty())
+   {
+      if (!readScript(options.script, presses)) return 1;
+      for (auto& press: presses) press.atUs += setupUs;
+   }
+   else
+   {
+      generatePresses(options.presses, options.seed, setupUs + 1000000, presses);
+   }
+   for (const auto& press: presses) schedulePress(press);
+
+   Distribution pressToLed, pressToBuzzerSound, pressToSoundboardSound, pressToDisplay, loopVirtual, loopHost;
+   sim::hooks().digitalWrite = [&](uint8_t pin, int level)
+   {
+      if (level != HIGH || (pin != RED_BUZZER_LED && pin != BLUE_BUZZER_LED)) return;
+      Press* press = findPress(presses, PRESS_BUZZER, &Press::ledSeen);
+      if (press) pressToLed.add((double)(sim::now() - press->atUs) / 1000.0);
+   };
+   sim::hooks().soundRequest = [&](const char* filename, int prio)
+   {
+      bool buzzer = strcmp(filename, SOUND_TIMER_START) == 0;
+      if (!buzzer && strncmp(filename, "/soundboard/", 12) != 0) return;
+      Press* press = findPress(presses, buzzer ? PRESS_BUZZER : PRESS_PUSH, &Press::soundSeen);
+      if (press) (buzzer ? pressToBuzzerSound : pressToSoundboardSound).add((double)(sim::now() - press->atUs) / 1000.0);
+   };
+   sim::hooks().displayWrite = [&](const char* display)
+   {
+      if (strcmp(display, "lcd") != 0) return;
+      Press* press = findPress(presses, PRESS_LCD, &Press::displaySeen);
+      if (press) pressToDisplay.add((double)(sim::now() - press->atUs) / 1000.0);
+   };
+
+   uint64_t endUs = (presses.empty() ? setupUs : presses.back().atUs + (uint64_t)presses.back().holdMs * 1000) + 2000000;
+   // Reserved up front, so the measurements don't allocate while the firmware runs (ALLOC_COUNTER=1 builds)
+   for (Distribution* d: { &pressToLed, &pressToBuzzerSound, &pressToSoundboardSound, &pressToDisplay })
+   {
+      d->reserve(presses.size());
+   }
+   loopVirtual.reserve((endUs - setupUs) / 1000); // A loop takes at least 5ms
+   loopHost.reserve((endUs - setupUs) / 1000);
+   uint64_t loops = 0;
+   auto hostStart = std::chrono::steady_clock::now();
+   while (sim::now() < endUs)
+   {
+      uint64_t start = sim::now();
+      auto hostLoopStart = std::chrono::steady_clock::now();
+      loop();
+      auto hostLoopEnd = std::chrono::steady_clock::now();
+      loopVirtual.add((double)(sim::now() - start) / 1000.0);
+      loopHost.add(std::chrono::duration<double, std::micro>(hostLoopEnd - hostLoopStart).count());
+      loops++;
+   }
+   double hostMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - hostStart).count();
+   if (options.record)
+   {
+      config.setValue(CFG_INPUT_TRACE, 0);
+      inputTrace.loop();
+   }
+   gameLog.flush();
+
+   int count[PRESS_KIND_COUNT] = {};
+   int ledMissing = 0, soundMissing[PRESS_KIND_COUNT] = {}, displayMissing = 0;
+   for (const auto& press: presses)
+   {
+      count[press.kind]++;
+      if (press.kind == PRESS_BUZZER && !press.ledSeen) ledMissing++;
+      if (press.kind != PRESS_LCD && !press.soundSeen) soundMissing[press.kind]++;
+      if (press.kind == PRESS_LCD && !press.displaySeen) displayMissing++;
+   }
+
+   printf("Setup: %.1fms virtual, %llu loops over %.1fs virtual in %.0fms host time\n", setupUs / 1000.0,
+          (unsigned long long)loops, (endUs - setupUs) / 1e6, hostMs);
+   for (int kind = 0; kind < PRESS_KIND_COUNT; kind++) printf("%s presses: %d\n", pressKindNames[kind], count[kind]);
+   printf("Without response within 1s (buzzer locked, empty sound slot, page jump mode): LED %d, buzzer sound %d, "
+          "soundboard sound %d, display %d\n", ledMissing, soundMissing[PRESS_BUZZER], soundMissing[PRESS_PUSH],
+          displayMissing);
+   Distribution::printHeader();
+   pressToLed.print("press-to-LED", "ms");
+   pressToBuzzerSound.print("press-to-buzzer-sound", "ms");
+   pressToSoundboardSound.print("press-to-sound", "ms");
+   pressToDisplay.print("press-to-display", "ms");
+   loopVirtual.print("loop (virtual)", "ms");
+   loopHost.print("loop (host CPU)", "us");
+   return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Percentiles of measured values, for the reports of the simulation programs
+ */
+
+#ifndef ESP32_BUZZER_SIM_DISTRIBUTION_H
+#define ESP32_BUZZER_SIM_DISTRIBUTION_H
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+class Distribution
+{
+private:
+   std::vector<double> values;
+
+public:
+   void add(double value) { values.push_back(value); }
+   void reserve(size_t count) { values.reserve(count); }
+   size_t count() const { return values.size(); }
+
+   /**
+    * \brief Value below which p percent of the values are, 0 if there are none
+    */
+   double percentile(double p)
+   {
+      if (values.empty()) return 0;
+      std::sort(values.begin(), values.end());
+      return values[std::min(values.size() - 1, (size_t)(p / 100.0 * values.size()))];
+   }
+
+   static void printHeader()
+   {
+      printf("\n%-22s %7s %9s %9s %9s %9s %9s\n", "metric", "count", "min", "p50", "p90", "p99", "max");
+   }
+
+   void print(const char* name, const char* unit)
+   {
+      if (values.empty())
+      {
+         printf("%-22s %7d\n", name, 0);
+         return;
+      }
+      printf("%-22s %7zu %9.3f %9.3f %9.3f %9.3f %9.3f  %s\n", name, values.size(), percentile(0), percentile(50),
+             percentile(90), percentile(99), percentile(100), unit);
+   }
+};
+
+#endif //ESP32_BUZZER_SIM_DISTRIBUTION_H
@@ -0,0 +1,118 @@
+/*
+ * Arduino core for the host simulation
+ * Only what the firmware uses. Time is virtual (see simHal.h): it only moves on with delay() and the cost of the
+ * hardware calls, so setup() and loop() run as fast as the host can and the results are the same on every run.
+ * Harnesses with several tasks switch to the host clock (sim::setRealTime).
+ */
+
+#ifndef ESP32_BUZZER_SIM_ARDUINO_H
+#define ESP32_BUZZER_SIM_ARDUINO_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include "esp_log.h"
+#include "freertos.h"
+
+using std::min;
+using std::max;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define ANALOG 0xC0
+
+enum gpio_num_t
+{
+   GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6, GPIO_NUM_7, GPIO_NUM_8,
+   GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15, GPIO_NUM_16,
+   GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_23, GPIO_NUM_24,
+   GPIO_NUM_25, GPIO_NUM_26, GPIO_NUM_27, GPIO_NUM_28, GPIO_NUM_29, GPIO_NUM_30, GPIO_NUM_31, GPIO_NUM_32,
+   GPIO_NUM_33, GPIO_NUM_34, GPIO_NUM_35, GPIO_NUM_36, GPIO_NUM_37, GPIO_NUM_38, GPIO_NUM_39, GPIO_NUM_MAX
+};
+
+enum adc_attenuation_t
+{
+   ADC_0db,
+   ADC_2_5db,
+   ADC_6db,
+   ADC_11db
+};
+
+#define SS 5
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void analogSetAttenuation(adc_attenuation_t attenuation);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 38)))
+size_t strlcpy(char* dst, const char* src, size_t size);
+#endif
+
+class EspClass
+{
+public:
+   // The heap is not tracked, a size of 0 says so
+   uint32_t getHeapSize() { return 0; }
+   uint32_t getFreeHeap() { return 0; }
+   uint32_t getMinFreeHeap() { return 0; }
+   uint32_t getMaxAllocHeap() { return 0; }
+   uint32_t getCycleCount(); // From the clock at 240MHz
+   uint32_t getCpuFreqMHz() { return 240; }
+};
+
+extern EspClass ESP;
+
+/**
+ * \brief Base of the displays, like the Print class of the Arduino core
+ */
+class Print
+{
+public:
+   virtual ~Print() = default;
+   virtual size_t write(uint8_t c) = 0;
+   virtual size_t write(const uint8_t* buffer, size_t size);
+   size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+   size_t print(const char* str) { return write(str); }
+   size_t print(char c) { return write((uint8_t)c); }
+   size_t print(int n);
+   size_t print(unsigned int n);
+   size_t print(long n);
+   size_t print(unsigned long n);
+   size_t print(double n, int digits = 2);
+};
+
+/**
+ * \brief Serial port: output goes to stdout, nothing is received
+ */
+class HardwareSerial : public Print
+{
+public:
+   void begin(unsigned long baud) {}
+   int available() { return 0; }
+   int read() { return -1; }
+   size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+   using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif //ESP32_BUZZER_SIM_ARDUINO_H
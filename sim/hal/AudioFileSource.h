@@ -0,0 +1,25 @@
+/*
+ * Interface of the ESP8266Audio file sources for the host simulation
+ * Only the interface, as the sources of the firmware and the sound stress harness use it.
+ */
+
+#ifndef ESP32_BUZZER_SIM_AUDIOFILESOURCE_H
+#define ESP32_BUZZER_SIM_AUDIOFILESOURCE_H
+
+#include <cstdint>
+
+class AudioFileSource
+{
+public:
+   virtual ~AudioFileSource() = default;
+   virtual bool open(const char* filename) { return false; }
+   virtual uint32_t read(void* data, uint32_t len) = 0;
+   virtual bool seek(int32_t pos, int dir) { return false; }
+   virtual bool close() { return false; }
+   virtual bool isOpen() { return false; }
+   virtual uint32_t getSize() { return 0; }
+   virtual uint32_t getPos() { return 0; }
+   virtual bool loop() { return true; }
+};
+
+#endif //ESP32_BUZZER_SIM_AUDIOFILESOURCE_H
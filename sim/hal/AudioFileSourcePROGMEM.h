@@ -0,0 +1,58 @@
+/*
+ * ESP8266Audio source for data in memory, for the host simulation
+ */
+
+#ifndef ESP32_BUZZER_SIM_AUDIOFILESOURCEPROGMEM_H
+#define ESP32_BUZZER_SIM_AUDIOFILESOURCEPROGMEM_H
+
+#include "AudioFileSource.h"
+#include <cstdio>
+#include <cstring>
+
+class AudioFileSourcePROGMEM : public AudioFileSource
+{
+private:
+   const uint8_t* data = nullptr;
+   uint32_t size = 0;
+   uint32_t pos = 0;
+
+public:
+   bool open(const void* buffer, uint32_t len)
+   {
+      data = static_cast<const uint8_t*>(buffer);
+      size = len;
+      pos = 0;
+      return data != nullptr;
+   }
+
+   uint32_t read(void* buffer, uint32_t len) override
+   {
+      if (!data) return 0;
+      len = len < size - pos ? len : size - pos;
+      memcpy(buffer, data + pos, len);
+      pos += len;
+      return len;
+   }
+
+   bool seek(int32_t offset, int dir) override
+   {
+      int64_t target = dir == SEEK_SET ? offset : dir == SEEK_CUR ? (int64_t)pos + offset : (int64_t)size + offset;
+      if (!data || target < 0 || target > size) return false;
+      pos = (uint32_t)target;
+      return true;
+   }
+
+   bool close() override
+   {
+      data = nullptr;
+      size = 0;
+      pos = 0;
+      return true;
+   }
+
+   bool isOpen() override { return data != nullptr; }
+   uint32_t getSize() override { return size; }
+   uint32_t getPos() override { return pos; }
+};
+
+#endif //ESP32_BUZZER_SIM_AUDIOFILESOURCEPROGMEM_H
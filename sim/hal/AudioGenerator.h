@@ -0,0 +1,28 @@
+/*
+ * Base of the ESP8266Audio generators for the host simulation
+ */
+
+#ifndef ESP32_BUZZER_SIM_AUDIOGENERATOR_H
+#define ESP32_BUZZER_SIM_AUDIOGENERATOR_H
+
+#include "AudioFileSource.h"
+#include "AudioOutput.h"
+
+class AudioGenerator
+{
+public:
+   virtual ~AudioGenerator() = default;
+   virtual bool begin(AudioFileSource* source, AudioOutput* output) { return false; }
+   virtual bool loop() { return false; }
+   virtual bool stop() { return false; }
+   virtual bool isRunning() { return false; }
+   virtual void desync() {}
+
+protected:
+   bool running = false;
+   AudioFileSource* file = nullptr;
+   AudioOutput* output = nullptr;
+   int16_t lastSample[2] = { 0, 0 };
+};
+
+#endif //ESP32_BUZZER_SIM_AUDIOGENERATOR_H
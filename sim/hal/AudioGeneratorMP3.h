@@ -0,0 +1,30 @@
+/*
+ * ESP8266Audio MP3 generator for the host simulation
+ * MP3 decoding is not simulated, begin() fails like for a broken file. The stress harness uses WAV files.
+ */
+
+#ifndef ESP32_BUZZER_SIM_AUDIOGENERATORMP3_H
+#define ESP32_BUZZER_SIM_AUDIOGENERATORMP3_H
+
+#include "AudioGenerator.h"
+#include "esp_log.h"
+
+class AudioGeneratorMP3 : public AudioGenerator
+{
+public:
+   bool begin(AudioFileSource* source, AudioOutput* out) override
+   {
+      ESP_LOGE("sim", "MP3 is not simulated");
+      return false;
+   }
+
+   bool stop() override
+   {
+      running = false;
+      return true;
+   }
+
+   bool isRunning() override { return running; }
+};
+
+#endif //ESP32_BUZZER_SIM_AUDIOGENERATORMP3_H
@@ -0,0 +1,111 @@
+/*
+ * ESP8266Audio WAV generator for the host simulation
+ * Plays PCM WAV files (8 or 16 bit, mono or stereo) like the library: the fmt and data chunks are looked up in
+ * begin(), loop() hands samples to the output until it is full, the sample it did not take is kept for the next call.
+ */
+
+#ifndef ESP32_BUZZER_SIM_AUDIOGENERATORWAV_H
+#define ESP32_BUZZER_SIM_AUDIOGENERATORWAV_H
+
+#include "AudioGenerator.h"
+#include <cstdio>
+#include <cstring>
+
+class AudioGeneratorWAV : public AudioGenerator
+{
+private:
+   uint16_t channels = 0;
+   uint16_t bitsPerSample = 0;
+   uint32_t dataLeft = 0;
+   bool pending = false; // lastSample was not taken by the output
+
+   static uint32_t readLe(const uint8_t* p, int bytes)
+   {
+      uint32_t v = 0;
+      for (int i = bytes - 1; i >= 0; i--) v = v << 8 | p[i];
+      return v;
+   }
+
+   bool readHeader()
+   {
+      uint8_t buf[16];
+      if (file->read(buf, 12) != 12 || memcmp(buf, "RIFF", 4) != 0 || memcmp(buf + 8, "WAVE", 4) != 0) return false;
+      while (file->read(buf, 8) == 8)
+      {
+         uint32_t size = readLe(buf + 4, 4);
+         if (memcmp(buf, "fmt ", 4) == 0 && size >= 16)
+         {
+            if (file->read(buf, 16) != 16 || readLe(buf, 2) != 1) return false;
+            channels = (uint16_t)readLe(buf + 2, 2);
+            output->SetRate((int)readLe(buf + 4, 4));
+            bitsPerSample = (uint16_t)readLe(buf + 14, 2);
+            size -= 16;
+         }
+         else if (memcmp(buf, "data", 4) == 0)
+         {
+            dataLeft = size;
+            return channels >= 1 && channels <= 2 && (bitsPerSample == 8 || bitsPerSample == 16);
+         }
+         if (!file->seek((int32_t)(size + (size & 1)), SEEK_CUR)) return false;
+      }
+      return false;
+   }
+
+   bool readSample()
+   {
+      uint32_t frameBytes = channels * bitsPerSample / 8;
+      uint8_t buf[4];
+      if (dataLeft < frameBytes || file->read(buf, frameBytes) != frameBytes) return false;
+      dataLeft -= frameBytes;
+      for (int c = 0; c < 2; c++)
+      {
+         const uint8_t* p = buf + (c < channels ? c : 0) * bitsPerSample / 8;
+         lastSample[c] = bitsPerSample == 16 ? (int16_t)readLe(p, 2) : (int16_t)((p[0] - 128) << 8);
+      }
+      return true;
+   }
+
+public:
+   bool begin(AudioFileSource* source, AudioOutput* out) override
+   {
+      file = source;
+      output = out;
+      pending = false;
+      if (!file || !file->isOpen() || !output) return false;
+      output->SetBitsPerSample(16);
+      output->SetChannels(2);
+      if (!readHeader() || !output->begin()) return false;
+      running = true;
+      return true;
+   }
+
+   bool loop() override
+   {
+      if (!running) return false;
+      while (true)
+      {
+         if (!pending && !readSample())
+         {
+            stop();
+            return false;
+         }
+         pending = !output->ConsumeSample(lastSample);
+         if (pending) break;
+      }
+      file->loop();
+      output->loop();
+      return running;
+   }
+
+   bool stop() override
+   {
+      if (running && output) output->stop();
+      running = false;
+      pending = false;
+      return true;
+   }
+
+   bool isRunning() override { return running; }
+};
+
+#endif //ESP32_BUZZER_SIM_AUDIOGENERATORWAV_H
@@ -0,0 +1,71 @@
+/*
+ * Base of the ESP8266Audio outputs for the host simulation
+ * Same members and sample handling as the library, so the firmware's outputs (resampler, ring buffer) run unchanged.
+ */
+
+#ifndef ESP32_BUZZER_SIM_AUDIOOUTPUT_H
+#define ESP32_BUZZER_SIM_AUDIOOUTPUT_H
+
+#include <cstdint>
+
+class AudioOutput
+{
+public:
+   virtual ~AudioOutput() = default;
+   virtual bool SetRate(int hz) { hertz = hz; return true; }
+   virtual bool SetBitsPerSample(int bits) { bps = bits; return true; }
+   virtual bool SetChannels(int chan) { channels = chan; return true; }
+   virtual bool SetGain(float f)
+   {
+      if (f > 4.0f) f = 4.0f;
+      if (f < 0.0f) f = 0.0f;
+      gainF2P6 = (uint8_t)(f * (1 << 6));
+      return true;
+   }
+   virtual bool begin() { return false; }
+
+   typedef enum
+   {
+      LEFTCHANNEL = 0,
+      RIGHTCHANNEL = 1
+   } SampleIndex;
+
+   virtual bool ConsumeSample(int16_t sample[2]) { return false; }
+   virtual uint16_t ConsumeSamples(int16_t* samples, uint16_t count)
+   {
+      for (uint16_t i = 0; i < count; i++)
+      {
+         if (!ConsumeSample(samples + 2 * i)) return i;
+      }
+      return count;
+   }
+   virtual bool stop() { return false; }
+   virtual void flush() {}
+   virtual bool loop() { return true; }
+
+protected:
+   void MakeSampleStereo16(int16_t sample[2])
+   {
+      if (channels == 1) sample[RIGHTCHANNEL] = sample[LEFTCHANNEL];
+      if (bps == 8)
+      {
+         sample[LEFTCHANNEL] = (int16_t)((((int16_t)(sample[LEFTCHANNEL] & 0xff)) - 128) << 8);
+         sample[RIGHTCHANNEL] = (int16_t)((((int16_t)(sample[RIGHTCHANNEL] & 0xff)) - 128) << 8);
+      }
+   }
+
+   int16_t Amplify(int16_t s)
+   {
+      int32_t v = (s * gainF2P6) >> 6;
+      if (v < -32767) return -32767;
+      if (v > 32767) return 32767;
+      return (int16_t)v;
+   }
+
+   uint16_t hertz = 0;
+   uint8_t bps = 16;
+   uint8_t channels = 2;
+   uint8_t gainF2P6 = 1 << 6;
+};
+
+#endif //ESP32_BUZZER_SIM_AUDIOOUTPUT_H
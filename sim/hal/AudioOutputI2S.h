@@ -0,0 +1,60 @@
+/*
+ * ESP8266Audio I2S output for the host simulation
+ * Stands for the I2S DMA buffers (8 buffers of 128 frames) that are played at the sample rate on the host clock.
+ * ConsumeSample() refuses a sample while they are full, like the library. Every accepted sample is handed to the
+ * i2sSample hook with the time it is played. When the buffers run empty, the stream starts again with the next
+ * sample, as the DMA then sends silence.
+ */
+
+#ifndef ESP32_BUZZER_SIM_AUDIOOUTPUTI2S_H
+#define ESP32_BUZZER_SIM_AUDIOOUTPUTI2S_H
+
+#include "AudioOutput.h"
+#include "simHal.h"
+
+class AudioOutputI2S : public AudioOutput
+{
+private:
+   static constexpr uint64_t DMA_FRAMES = 8 * 128;
+
+   uint64_t streamStartUs = 0;
+   uint64_t written = 0; // Frames since the stream started
+
+   uint64_t playedFrames(uint64_t nowUs) const { return (nowUs - streamStartUs) * hertz / 1000000; }
+
+public:
+   bool SetPinout(int bclk, int wclk, int dout) { return true; }
+
+   bool begin() override
+   {
+      streamStartUs = sim::now();
+      written = 0;
+      return true;
+   }
+
+   bool ConsumeSample(int16_t sample[2]) override
+   {
+      if (hertz == 0) return false;
+      uint64_t nowUs = sim::now();
+      uint64_t played = playedFrames(nowUs);
+      if (played >= written)
+      {
+         // Underrun
+         streamStartUs = nowUs;
+         written = 0;
+      }
+      else if (written - played >= DMA_FRAMES)
+      {
+         return false;
+      }
+      int16_t out[2] = { Amplify(sample[LEFTCHANNEL]), Amplify(sample[RIGHTCHANNEL]) };
+      uint64_t playUs = streamStartUs + written * 1000000 / hertz;
+      written++;
+      if (sim::hooks().i2sSample) sim::hooks().i2sSample(out, playUs);
+      return true;
+   }
+
+   bool stop() override { return true; }
+};
+
+#endif //ESP32_BUZZER_SIM_AUDIOOUTPUTI2S_H
@@ -0,0 +1,68 @@
+/*
+ * Arduino file system for the host simulation
+ * View of a host directory, which stands for the root of the file system. Files are opened either for reading or
+ * for writing from the start ("w"), which is all the firmware does.
+ */
+
+#ifndef ESP32_BUZZER_SIM_FS_H
+#define ESP32_BUZZER_SIM_FS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace fs
+{
+   enum SeekMode
+   {
+      SeekSet = 0,
+      SeekCur = 1,
+      SeekEnd = 2
+   };
+
+   class HostFile;
+
+   class File
+   {
+   private:
+      std::shared_ptr<HostFile> impl;
+
+   public:
+      File() = default;
+      explicit File(std::shared_ptr<HostFile> impl) : impl(std::move(impl)) {}
+      explicit operator bool() const { return impl != nullptr; }
+      size_t read(uint8_t* buf, size_t size);
+      size_t write(const uint8_t* buf, size_t size);
+      void flush();
+      bool seek(uint32_t pos, SeekMode mode = SeekSet);
+      size_t position() const;
+      size_t size() const;
+      void close() { impl.reset(); }
+      const char* name() const;
+      const char* path() const;
+      bool isDirectory();
+      File openNextFile(const char* mode = "r");
+   };
+
+   class FS
+   {
+   private:
+      std::string root;
+
+   public:
+      /**
+       * \brief Set the host directory with the content of the file system
+       */
+      void setRoot(const std::string& hostDir) { root = hostDir; }
+      const std::string& getRoot() const { return root; }
+      File open(const char* path, const char* mode = "r", bool create = false);
+      bool exists(const char* path);
+      bool mkdir(const char* path);
+   };
+}
+
+using fs::File;
+using fs::FS;
+
+#endif //ESP32_BUZZER_SIM_FS_H
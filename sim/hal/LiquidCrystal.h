@@ -0,0 +1,20 @@
+/*
+ * Parallel HD44780 display (LiquidCrystal library) for the host simulation
+ */
+
+#ifndef ESP32_BUZZER_SIM_LIQUIDCRYSTAL_H
+#define ESP32_BUZZER_SIM_LIQUIDCRYSTAL_H
+
+#include "simDisplay.h"
+#include "simHal.h"
+
+class LiquidCrystal : public SimDisplay
+{
+public:
+   LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3)
+      : SimDisplay("lcd", SIM_COST_LCD_CHAR_US)
+   {
+   }
+};
+
+#endif //ESP32_BUZZER_SIM_LIQUIDCRYSTAL_H
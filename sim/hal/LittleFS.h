@@ -0,0 +1,18 @@
+/*
+ * LittleFS for the host simulation, there is none, like on a device without uploaded file system image
+ */
+
+#ifndef ESP32_BUZZER_SIM_LITTLEFS_H
+#define ESP32_BUZZER_SIM_LITTLEFS_H
+
+#include "FS.h"
+
+class LittleFSFS : public fs::FS
+{
+public:
+   bool begin(bool formatOnFail = false) { return false; }
+};
+
+extern LittleFSFS LittleFS;
+
+#endif //ESP32_BUZZER_SIM_LITTLEFS_H
@@ -0,0 +1,27 @@
+/*
+ * NVS preferences for the host simulation, kept in memory for the run
+ */
+
+#ifndef ESP32_BUZZER_SIM_PREFERENCES_H
+#define ESP32_BUZZER_SIM_PREFERENCES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+class Preferences
+{
+private:
+   std::string ns;
+
+public:
+   bool begin(const char* name, bool readOnly = false);
+   void end() {}
+   int32_t getInt(const char* key, int32_t defaultValue = 0);
+   size_t putInt(const char* key, int32_t value);
+   size_t getBytesLength(const char* key);
+   size_t getBytes(const char* key, void* buf, size_t maxLen);
+   size_t putBytes(const char* key, const void* value, size_t len);
+};
+
+#endif //ESP32_BUZZER_SIM_PREFERENCES_H
@@ -0,0 +1,19 @@
+/*
+ * SD card for the host simulation, the card content is a host directory (e.g. the wav directory of the repo)
+ */
+
+#ifndef ESP32_BUZZER_SIM_SD_H
+#define ESP32_BUZZER_SIM_SD_H
+
+#include "FS.h"
+#include "Arduino.h"
+
+class SDFS : public fs::FS
+{
+public:
+   bool begin(uint8_t ssPin = SS) { return true; }
+};
+
+extern SDFS SD;
+
+#endif //ESP32_BUZZER_SIM_SD_H
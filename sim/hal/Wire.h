@@ -0,0 +1,8 @@
+/*
+ * I2C for the host simulation, the I2C display is simulated as a whole (see hd44780.h)
+ */
+
+#ifndef ESP32_BUZZER_SIM_WIRE_H
+#define ESP32_BUZZER_SIM_WIRE_H
+
+#endif //ESP32_BUZZER_SIM_WIRE_H
@@ -0,0 +1,36 @@
+/*
+ * ESP-IDF logging for the host simulation, goes to stderr
+ */
+
+#ifndef ESP32_BUZZER_SIM_ESP_LOG_H
+#define ESP32_BUZZER_SIM_ESP_LOG_H
+
+#include <cstdint>
+
+typedef enum
+{
+   ESP_LOG_NONE,
+   ESP_LOG_ERROR,
+   ESP_LOG_WARN,
+   ESP_LOG_INFO,
+   ESP_LOG_DEBUG,
+   ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+/**
+ * \brief Set the log level, only "*" (all tags) is supported. Default is warnings, so benchmark output stays clean.
+ */
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...);
+uint32_t esp_log_timestamp();
+
+// Same line format as ESP-IDF, without the colors
+#define LOG_FORMAT(letter, format) #letter " (%u) %s: " format "\n"
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, LOG_FORMAT(E, format), esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, LOG_FORMAT(W, format), esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, LOG_FORMAT(I, format), esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, LOG_FORMAT(D, format), esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_write(ESP_LOG_VERBOSE, tag, LOG_FORMAT(V, format), esp_log_timestamp(), tag, ##__VA_ARGS__)
+
+#endif //ESP32_BUZZER_SIM_ESP_LOG_H
@@ -0,0 +1,71 @@
+/*
+ * ESP-IDF flash partitions for the host simulation
+ * There is no sound bank partition on the host, esp_partition_find_first() finds nothing.
+ */
+
+#ifndef ESP32_BUZZER_SIM_ESP_PARTITION_H
+#define ESP32_BUZZER_SIM_ESP_PARTITION_H
+
+#include <cstdint>
+#include <cstddef>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum
+{
+   ESP_PARTITION_TYPE_APP = 0,
+   ESP_PARTITION_TYPE_DATA = 1
+} esp_partition_type_t;
+
+typedef enum
+{
+   ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+   ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+typedef enum
+{
+   SPI_FLASH_MMAP_DATA,
+   SPI_FLASH_MMAP_INST
+} spi_flash_mmap_memory_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct
+{
+   esp_partition_type_t type;
+   esp_partition_subtype_t subtype;
+   uint32_t address;
+   uint32_t size;
+   char label[17];
+   bool encrypted;
+} esp_partition_t;
+
+inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char*)
+{
+   return nullptr;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t*, size_t, void*, size_t)
+{
+   return ESP_FAIL;
+}
+
+inline esp_err_t esp_partition_mmap(const esp_partition_t*, size_t, size_t, spi_flash_mmap_memory_t, const void**,
+                                    spi_flash_mmap_handle_t*)
+{
+   return ESP_FAIL;
+}
+
+inline void spi_flash_munmap(spi_flash_mmap_handle_t)
+{
+}
+
+inline const char* esp_err_to_name(esp_err_t err)
+{
+   return err == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+#endif //ESP32_BUZZER_SIM_ESP_PARTITION_H
@@ -0,0 +1,12 @@
+/*
+ * High resolution timer for the host simulation, runs on the virtual clock
+ */
+
+#ifndef ESP32_BUZZER_SIM_ESP_TIMER_H
+#define ESP32_BUZZER_SIM_ESP_TIMER_H
+
+#include <cstdint>
+
+int64_t esp_timer_get_time();
+
+#endif //ESP32_BUZZER_SIM_ESP_TIMER_H
@@ -0,0 +1,66 @@
+/*
+ * FreeRTOS for the host simulation
+ * The simulation of the firmware runs single threaded: the sound player is replaced by a recorder and the FTP task is
+ * not built (RUN_FTP=0), so it only needs the types. The sound stress harness runs the real playback task, for it
+ * tasks, queues and mutexes are implemented with host threads (simFreertos.cpp). Tasks are only created in real-time
+ * mode, they are not pinned and have no priorities, the host schedules them.
+ */
+
+#ifndef ESP32_BUZZER_SIM_FREERTOS_H
+#define ESP32_BUZZER_SIM_FREERTOS_H
+
+#include <cstdint>
+
+typedef void* QueueHandle_t;
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef QueueHandle_t xQueueHandle;
+typedef TaskHandle_t xTaskHandle;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void (* TaskFunction_t)(void*);
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portPRIVILEGE_BIT 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms)) // 1ms ticks like on the ESP32
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define errQUEUE_FULL 0
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait);
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t coreId);
+
+/**
+ * \brief Name of a task, nullptr for the calling one. The main thread is "loopTask" like on the ESP32.
+ */
+const char* pcTaskGetTaskName(TaskHandle_t task);
+
+/**
+ * \brief End a task, only the calling one (nullptr) can be deleted
+ */
+void vTaskDelete(TaskHandle_t task);
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+/**
+ * \brief Least free stack of a task in bytes like on the ESP32, nullptr for the calling one. Not measured: it is the
+ * configured stack size.
+ */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+inline BaseType_t xPortGetCoreID()
+{
+   return 0;
+}
+
+#endif //ESP32_BUZZER_SIM_FREERTOS_H
@@ -0,0 +1,10 @@
+/*
+ * hd44780 library for the host simulation, see hd44780ioClass/hd44780_I2Cexp.h
+ */
+
+#ifndef ESP32_BUZZER_SIM_HD44780_H
+#define ESP32_BUZZER_SIM_HD44780_H
+
+#include "simDisplay.h"
+
+#endif //ESP32_BUZZER_SIM_HD44780_H
@@ -0,0 +1,17 @@
+/*
+ * HD44780 display behind an I2C expander for the host simulation
+ */
+
+#ifndef ESP32_BUZZER_SIM_HD44780_I2CEXP_H
+#define ESP32_BUZZER_SIM_HD44780_I2CEXP_H
+
+#include "../simDisplay.h"
+#include "../simHal.h"
+
+class hd44780_I2Cexp : public SimDisplay
+{
+public:
+   explicit hd44780_I2Cexp(uint8_t address) : SimDisplay("i2c-lcd", SIM_COST_I2C_LCD_CHAR_US) {}
+};
+
+#endif //ESP32_BUZZER_SIM_HD44780_I2CEXP_H
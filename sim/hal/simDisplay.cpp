@@ -0,0 +1,45 @@
+/*
+ * Character display for the host simulation
+ */
+
+#include "simDisplay.h"
+#include "simHal.h"
+
+int SimDisplay::begin(uint8_t displayCols, uint8_t displayRows)
+{
+   cols = displayCols;
+   rows = displayRows;
+   lines.assign(rows, std::string(cols, ' '));
+   clear();
+   return 0;
+}
+
+void SimDisplay::clear()
+{
+   for (auto& line: lines) line.assign(cols, ' ');
+   col = 0;
+   row = 0;
+   sim::advance(SIM_COST_LCD_CLEAR_US);
+   if (sim::hooks().displayWrite) sim::hooks().displayWrite(name);
+}
+
+void SimDisplay::setCursor(uint8_t newCol, uint8_t newRow)
+{
+   col = newCol;
+   row = newRow;
+   sim::advance(charCostUs);
+}
+
+size_t SimDisplay::write(uint8_t c)
+{
+   sim::advance(charCostUs);
+   if (row < rows && col < cols) lines[row][col] = (char)c;
+   col++;
+   if (sim::hooks().displayWrite) sim::hooks().displayWrite(name);
+   return 1;
+}
+
+std::string SimDisplay::getLine(int lineRow) const
+{
+   return lineRow < rows ? lines[lineRow] : "";
+}
@@ -0,0 +1,39 @@
+/*
+ * Character display for the host simulation
+ * Keeps the text in memory, so the benchmark driver can show it, and charges the time the real display takes.
+ */
+
+#ifndef ESP32_BUZZER_SIM_DISPLAY_H
+#define ESP32_BUZZER_SIM_DISPLAY_H
+
+#include "Arduino.h"
+#include <string>
+#include <vector>
+
+class SimDisplay : public Print
+{
+private:
+   const char* name;
+   uint32_t charCostUs;
+   int cols = 0;
+   int rows = 0;
+   int col = 0;
+   int row = 0;
+   std::vector<std::string> lines;
+
+public:
+   SimDisplay(const char* name, uint32_t charCostUs) : name(name), charCostUs(charCostUs) {}
+   int begin(uint8_t cols, uint8_t rows);
+   void clear();
+   void setCursor(uint8_t col, uint8_t row);
+   size_t write(uint8_t c) override;
+   using Print::write;
+
+   /**
+    * \return Text of a line as it would be shown
+    */
+   std::string getLine(int row) const;
+   int getRows() const { return rows; }
+};
+
+#endif //ESP32_BUZZER_SIM_DISPLAY_H
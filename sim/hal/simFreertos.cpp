@@ -0,0 +1,158 @@
+/*
+ * FreeRTOS queues, mutexes and tasks on host threads
+ */
+
+#include "freertos.h"
+#include "simHal.h"
+#include "esp_log.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+   // Fixed ring of items like the FreeRTOS queue, sending and receiving don't allocate
+   struct Queue
+   {
+      std::mutex mutex;
+      std::condition_variable notEmpty;
+      std::condition_variable notFull;
+      std::vector<uint8_t> items;
+      size_t first = 0;
+      size_t count = 0;
+      size_t length;
+      size_t itemSize;
+   };
+
+   /**
+    * \brief Wait on a condition like a FreeRTOS call, portMAX_DELAY waits forever
+    */
+   template<typename Predicate>
+   bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Predicate ready)
+   {
+      if (ticks == portMAX_DELAY)
+      {
+         cv.wait(lock, ready);
+         return true;
+      }
+      return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+   }
+
+   struct Task
+   {
+      const char* name;
+      uint32_t stackDepth;
+   };
+
+   struct TaskDeleted
+   {
+   };
+
+   Task loopTask{ "loopTask", 8192 };
+   thread_local Task* currentTask = &loopTask;
+}
+
+const char* pcTaskGetTaskName(TaskHandle_t task)
+{
+   return (task ? static_cast<Task*>(task) : currentTask)->name;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+   return currentTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+   // Host threads have their own stacks, none of the configured one is used
+   return (task ? static_cast<Task*>(task) : currentTask)->stackDepth;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+   auto* queue = new Queue;
+   queue->length = length;
+   queue->itemSize = itemSize;
+   queue->items.resize(length * itemSize);
+   return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t ticksToWait)
+{
+   auto* queue = static_cast<Queue*>(handle);
+   std::unique_lock<std::mutex> lock(queue->mutex);
+   if (!waitFor(queue->notFull, lock, ticksToWait, [&]() { return queue->count < queue->length; }))
+   {
+      return errQUEUE_FULL;
+   }
+   size_t slot = (queue->first + queue->count++) % queue->length;
+   memcpy(&queue->items[slot * queue->itemSize], item, queue->itemSize);
+   queue->notEmpty.notify_one();
+   return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t ticksToWait)
+{
+   auto* queue = static_cast<Queue*>(handle);
+   std::unique_lock<std::mutex> lock(queue->mutex);
+   if (!waitFor(queue->notEmpty, lock, ticksToWait, [&]() { return queue->count > 0; })) return pdFALSE;
+   memcpy(item, &queue->items[queue->first * queue->itemSize], queue->itemSize);
+   queue->first = (queue->first + 1) % queue->length;
+   queue->count--;
+   queue->notFull.notify_one();
+   return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+   return new std::timed_mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticksToWait)
+{
+   auto* mutex = static_cast<std::timed_mutex*>(handle);
+   if (ticksToWait == portMAX_DELAY)
+   {
+      mutex->lock();
+      return pdTRUE;
+   }
+   return mutex->try_lock_for(std::chrono::milliseconds(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle)
+{
+   static_cast<std::timed_mutex*>(handle)->unlock();
+   return pdTRUE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t coreId)
+{
+   // A thread would race the virtual clock, the callers fall back to doing the work in the loop
+   if (!sim::isRealTime()) return pdFALSE;
+   // Tasks run until they delete themselves or the program exits, the handle stays valid
+   auto* task = new Task{ name, stackDepth };
+   std::thread([=]()
+   {
+      currentTask = task;
+      try
+      {
+         function(param);
+      }
+      catch (const TaskDeleted&)
+      {
+      }
+   }).detach();
+   if (handle) *handle = task;
+   return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+   // Ends the thread of the calling task, from its function down
+   if (!task || task == currentTask) throw TaskDeleted{};
+   ESP_LOGE("freertos", "Deleting another task is not simulated");
+}
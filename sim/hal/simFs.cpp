@@ -0,0 +1,146 @@
+/*
+ * Arduino file systems for the host simulation
+ */
+
+#include "FS.h"
+#include "SD.h"
+#include "LittleFS.h"
+#include "simHal.h"
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+SDFS SD;
+LittleFSFS LittleFS;
+
+namespace fs
+{
+   class HostFile
+   {
+   public:
+      std::string path; // Path in the simulated file system
+      std::string name;
+      FILE* file = nullptr;
+      size_t fileSize = 0;
+      bool directory = false;
+      std::vector<std::filesystem::path> entries; // Directories only
+      size_t nextEntry = 0;
+      std::string root;
+
+      ~HostFile()
+      {
+         if (file) fclose(file);
+      }
+   };
+
+   static std::filesystem::path hostPathOf(const std::string& root, const std::string& path)
+   {
+      size_t start = path.find_first_not_of('/');
+      return std::filesystem::path(root) / (start == std::string::npos ? "" : path.substr(start));
+   }
+
+   static std::shared_ptr<HostFile> openHost(const std::string& root, const std::string& path, bool write = false)
+   {
+      if (root.empty()) return nullptr;
+      std::filesystem::path hostPath = hostPathOf(root, path);
+      std::error_code ec;
+      if (!write && !std::filesystem::exists(hostPath, ec)) return nullptr;
+
+      sim::advance(SIM_COST_FILE_OPEN_US);
+      auto f = std::make_shared<HostFile>();
+      f->path = path;
+      f->name = path.substr(path.find_last_of('/') + 1);
+      f->root = root;
+      if (std::filesystem::is_directory(hostPath, ec))
+      {
+         f->directory = true;
+         for (const auto& entry: std::filesystem::directory_iterator(hostPath, ec)) f->entries.push_back(entry.path());
+         // Directory order on the card is not sorted either, but runs should be reproducible
+         std::sort(f->entries.begin(), f->entries.end());
+         return f;
+      }
+      f->file = fopen(hostPath.string().c_str(), write ? "wb" : "rb");
+      if (!f->file) return nullptr;
+      f->fileSize = (size_t)std::filesystem::file_size(hostPath, ec);
+      return f;
+   }
+
+   size_t File::read(uint8_t* buf, size_t size)
+   {
+      if (!impl || !impl->file) return 0;
+      size_t n = fread(buf, 1, size, impl->file);
+      sim::advance((uint64_t)n * SIM_COST_FILE_READ_KB_US / 1024);
+      return n;
+   }
+
+   size_t File::write(const uint8_t* buf, size_t size)
+   {
+      if (!impl || !impl->file) return 0;
+      size_t n = fwrite(buf, 1, size, impl->file);
+      impl->fileSize += n;
+      sim::advance((uint64_t)n * SIM_COST_FILE_READ_KB_US / 1024);
+      return n;
+   }
+
+   void File::flush()
+   {
+      if (impl && impl->file) fflush(impl->file);
+   }
+
+   bool File::seek(uint32_t pos, SeekMode mode)
+   {
+      static const int whence[] = { SEEK_SET, SEEK_CUR, SEEK_END };
+      return impl && impl->file && fseek(impl->file, (long)pos, whence[mode]) == 0;
+   }
+
+   size_t File::position() const
+   {
+      return impl && impl->file ? (size_t)ftell(impl->file) : 0;
+   }
+
+   size_t File::size() const
+   {
+      return impl ? impl->fileSize : 0;
+   }
+
+   const char* File::name() const
+   {
+      return impl ? impl->name.c_str() : "";
+   }
+
+   const char* File::path() const
+   {
+      return impl ? impl->path.c_str() : "";
+   }
+
+   bool File::isDirectory()
+   {
+      return impl && impl->directory;
+   }
+
+   File File::openNextFile(const char* mode)
+   {
+      if (!impl || !impl->directory || impl->nextEntry >= impl->entries.size()) return File();
+      sim::advance(SIM_COST_DIR_ENTRY_US);
+      std::string dir = impl->path == "/" ? "" : impl->path;
+      std::string entryPath = dir + '/' + impl->entries[impl->nextEntry++].filename().string();
+      return File(openHost(impl->root, entryPath));
+   }
+
+   File FS::open(const char* path, const char* mode, bool create)
+   {
+      if (mode[0] != 'r' && mode[0] != 'w') return File(); // No appending
+      return File(openHost(root, path, mode[0] == 'w'));
+   }
+
+   bool FS::exists(const char* path)
+   {
+      return openHost(root, path) != nullptr;
+   }
+
+   bool FS::mkdir(const char* path)
+   {
+      std::error_code ec;
+      return !root.empty() && std::filesystem::create_directory(hostPathOf(root, path), ec);
+   }
+}
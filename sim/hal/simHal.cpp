@@ -0,0 +1,296 @@
+/*
+ * Simulated hardware: virtual clock, pins, Arduino core functions
+ */
+
+#include "simHal.h"
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include <cstdarg>
+#include <chrono>
+#include <thread>
+#include <map>
+#include <random>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace
+{
+   struct InputChange
+   {
+      uint8_t pin;
+      bool analog;
+      int value;
+   };
+
+   uint64_t clockUs = 0;
+   bool realTime = false;
+   std::chrono::steady_clock::time_point realTimeStart;
+   std::multimap<uint64_t, InputChange> pending; // By time, same times in the order they were scheduled
+   int digitalLevels[GPIO_NUM_MAX]{};
+   uint16_t analogValues[GPIO_NUM_MAX]{};
+   uint16_t noiseAmplitude = 0;
+   std::mt19937 noise;
+   std::mt19937 randomGenerator;
+   esp_log_level_t logLevel = ESP_LOG_WARN;
+   sim::Hooks simHooks;
+
+   void apply(const InputChange& change)
+   {
+      if (change.pin >= GPIO_NUM_MAX) return;
+      if (change.analog) analogValues[change.pin] = (uint16_t)change.value;
+      else digitalLevels[change.pin] = change.value;
+   }
+}
+
+namespace sim
+{
+   uint64_t now()
+   {
+      if (realTime)
+      {
+         auto elapsed = std::chrono::steady_clock::now() - realTimeStart;
+         return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+      }
+      return clockUs;
+   }
+
+   void setRealTime(bool enable)
+   {
+      // Continue from the virtual time, so the clock never goes back
+      realTimeStart = std::chrono::steady_clock::now() - std::chrono::microseconds(clockUs);
+      realTime = enable;
+   }
+
+   bool isRealTime()
+   {
+      return realTime;
+   }
+
+   void advance(uint64_t us)
+   {
+      if (realTime) return;
+      uint64_t target = clockUs + us;
+      while (!pending.empty() && pending.begin()->first <= target)
+      {
+         auto it = pending.begin();
+         clockUs = max(clockUs, it->first);
+         apply(it->second);
+         pending.erase(it);
+      }
+      clockUs = target;
+   }
+
+   void scheduleDigital(uint64_t atUs, uint8_t pin, int level)
+   {
+      pending.emplace(atUs, InputChange{ pin, false, level });
+   }
+
+   void scheduleAnalog(uint64_t atUs, uint8_t pin, uint16_t value)
+   {
+      pending.emplace(atUs, InputChange{ pin, true, value });
+   }
+
+   void setAnalogNoise(uint16_t amplitude, uint32_t seed)
+   {
+      noiseAmplitude = amplitude;
+      noise.seed(seed);
+   }
+
+   void setDigital(uint8_t pin, int level)
+   {
+      if (pin < GPIO_NUM_MAX) digitalLevels[pin] = level;
+   }
+
+   void setAnalog(uint8_t pin, uint16_t value)
+   {
+      if (pin < GPIO_NUM_MAX) analogValues[pin] = value;
+   }
+
+   int getDigital(uint8_t pin)
+   {
+      return pin < GPIO_NUM_MAX ? digitalLevels[pin] : LOW;
+   }
+
+   Hooks& hooks()
+   {
+      return simHooks;
+   }
+}
+
+uint32_t millis()
+{
+   return (uint32_t)(sim::now() / 1000);
+}
+
+uint32_t micros()
+{
+   return (uint32_t)sim::now();
+}
+
+int64_t esp_timer_get_time()
+{
+   return (int64_t)sim::now();
+}
+
+void delay(uint32_t ms)
+{
+   if (realTime) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+   else sim::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+   if (realTime) std::this_thread::sleep_for(std::chrono::microseconds(us));
+   else sim::advance(us);
+}
+
+uint32_t EspClass::getCycleCount()
+{
+   return (uint32_t)(sim::now() * getCpuFreqMHz());
+}
+
+void yield()
+{
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+   sim::setDigital(pin, val);
+   if (simHooks.digitalWrite) simHooks.digitalWrite(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+   return sim::getDigital(pin);
+}
+
+uint32_t simRegRead(uint32_t reg)
+{
+   int first = reg == GPIO_IN_REG ? 0 : reg == GPIO_IN1_REG ? 32 : -1;
+   uint32_t value = 0;
+   for (int pin = first; first >= 0 && pin < GPIO_NUM_MAX && pin < first + 32; pin++)
+   {
+      if (digitalLevels[pin]) value |= 1u << (pin - first);
+   }
+   return value;
+}
+
+void simRegWrite(uint32_t reg, uint32_t value)
+{
+   int first = reg == GPIO_OUT_W1TS_REG || reg == GPIO_OUT_W1TC_REG ? 0 : 32;
+   int level = reg == GPIO_OUT_W1TS_REG || reg == GPIO_OUT1_W1TS_REG ? HIGH : LOW;
+   for (int bit = 0; bit < 32 && first + bit < GPIO_NUM_MAX; bit++)
+   {
+      if (value & (1u << bit)) digitalWrite((uint8_t)(first + bit), (uint8_t)level);
+   }
+}
+
+uint16_t analogRead(uint8_t pin)
+{
+   sim::advance(SIM_COST_ANALOG_READ_US);
+   if (pin >= GPIO_NUM_MAX) return 0;
+   int value = analogValues[pin];
+   if (noiseAmplitude)
+   {
+      value += std::uniform_int_distribution<int>(-noiseAmplitude, noiseAmplitude)(noise);
+   }
+   return (uint16_t)std::min(std::max(value, 0), 4095);
+}
+
+void analogSetAttenuation(adc_attenuation_t attenuation)
+{
+}
+
+long random(long max)
+{
+   return random(0, max);
+}
+
+long random(long min, long max)
+{
+   if (max <= min) return min;
+   return std::uniform_int_distribution<long>(min, max - 1)(randomGenerator);
+}
+
+void randomSeed(unsigned long seed)
+{
+   randomGenerator.seed(seed);
+}
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 38)))
+size_t strlcpy(char* dst, const char* src, size_t size)
+{
+   size_t len = strlen(src);
+   if (size)
+   {
+      size_t n = std::min(len, size - 1);
+      memcpy(dst, src, n);
+      dst[n] = '\0';
+   }
+   return len;
+}
+#endif
+
+void esp_log_level_set(const char* tag, esp_log_level_t level)
+{
+   logLevel = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+{
+   if (level > logLevel) return;
+   va_list args;
+   va_start(args, format);
+   vfprintf(stderr, format, args);
+   va_end(args);
+}
+
+uint32_t esp_log_timestamp()
+{
+   return millis();
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+   size_t n = 0;
+   while (size--) n += write(*buffer++);
+   return n;
+}
+
+size_t Print::print(int n)
+{
+   return print((long)n);
+}
+
+size_t Print::print(unsigned int n)
+{
+   return print((unsigned long)n);
+}
+
+size_t Print::print(long n)
+{
+   char buf[24];
+   snprintf(buf, sizeof buf, "%ld", n);
+   return write(buf);
+}
+
+size_t Print::print(unsigned long n)
+{
+   char buf[24];
+   snprintf(buf, sizeof buf, "%lu", n);
+   return write(buf);
+}
+
+size_t Print::print(double n, int digits)
+{
+   char buf[32];
+   snprintf(buf, sizeof buf, "%.*f", digits, n);
+   return write(buf);
+}
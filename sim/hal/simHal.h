@@ -0,0 +1,82 @@
+/*
+ * Control of the simulated hardware
+ * Virtual clock, pin levels, scheduled input changes and hooks for the benchmark driver. Hardware calls that take
+ * noticeable time on the ESP32 (display writes, ADC reads, SD and flash access) move the clock on by a rough cost,
+ * so latencies contain them. The figures are estimates, only changes between runs are meaningful.
+ */
+
+#ifndef ESP32_BUZZER_SIM_HAL_H
+#define ESP32_BUZZER_SIM_HAL_H
+
+#include <cstdint>
+#include <functional>
+
+// Cost of hardware calls in µs of virtual time
+#define SIM_COST_ANALOG_READ_US 10
+#define SIM_COST_LCD_CHAR_US 50 // Parallel HD44780, 4 bit mode
+#define SIM_COST_I2C_LCD_CHAR_US 450 // HD44780 behind a PCF8574 at 100kHz
+#define SIM_COST_LCD_CLEAR_US 2000
+#define SIM_COST_FILE_OPEN_US 1500
+#define SIM_COST_DIR_ENTRY_US 300
+#define SIM_COST_FILE_READ_KB_US 400
+#define SIM_COST_PREFERENCES_US 2000
+
+namespace sim
+{
+   /**
+    * \brief Current virtual time in µs
+    */
+   uint64_t now();
+
+   /**
+    * \brief Move the clock on, scheduled input changes are applied at their time
+    */
+   void advance(uint64_t us);
+
+   /**
+    * \brief Run on the host clock instead of the virtual one, for several threads (FreeRTOS tasks). delay() sleeps
+    *    then, hardware calls cost nothing and scheduled input changes are not applied.
+    */
+   void setRealTime(bool enable);
+   bool isRealTime();
+
+   /**
+    * \brief Schedule a level change of a digital input
+    */
+   void scheduleDigital(uint64_t atUs, uint8_t pin, int level);
+
+   /**
+    * \brief Schedule a change of an analog input (ADC reading without noise)
+    */
+   void scheduleAnalog(uint64_t atUs, uint8_t pin, uint16_t value);
+
+   /**
+    * \brief Add uniform noise of +-amplitude to all ADC readings
+    */
+   void setAnalogNoise(uint16_t amplitude, uint32_t seed);
+
+   /**
+    * \brief Set a pin level right away (also for initial levels)
+    */
+   void setDigital(uint8_t pin, int level);
+   void setAnalog(uint8_t pin, uint16_t value);
+
+   /**
+    * \brief Level of a pin, as last written by the firmware or set by the simulation
+    */
+   int getDigital(uint8_t pin);
+
+   // Hooks for the benchmark driver, called at the virtual time of the event
+   struct Hooks
+   {
+      std::function<void(uint8_t pin, int level)> digitalWrite;
+      std::function<void(const char* filename, int prio)> soundRequest;
+      std::function<void(const char* display)> displayWrite;
+      // From the playback task, with the time the sample leaves the I2S DMA buffers (real-time mode only)
+      std::function<void(const int16_t sample[2], uint64_t playUs)> i2sSample;
+   };
+
+   Hooks& hooks();
+}
+
+#endif //ESP32_BUZZER_SIM_HAL_H
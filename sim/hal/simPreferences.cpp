@@ -0,0 +1,51 @@
+/*
+ * NVS preferences for the host simulation
+ */
+
+#include "Preferences.h"
+#include "simHal.h"
+#include <cstring>
+#include <map>
+#include <vector>
+
+static std::map<std::string, std::vector<uint8_t>> values; // "namespace/key"
+
+bool Preferences::begin(const char* name, bool readOnly)
+{
+   ns = name;
+   return true;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue)
+{
+   int32_t value = defaultValue;
+   getBytes(key, &value, sizeof value);
+   return value;
+}
+
+size_t Preferences::putInt(const char* key, int32_t value)
+{
+   return putBytes(key, &value, sizeof value);
+}
+
+size_t Preferences::getBytesLength(const char* key)
+{
+   auto it = values.find(ns + '/' + key);
+   return it != values.end() ? it->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen)
+{
+   auto it = values.find(ns + '/' + key);
+   if (it == values.end() || it->second.size() > maxLen) return 0;
+   memcpy(buf, it->second.data(), it->second.size());
+   return it->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len)
+{
+   sim::advance(SIM_COST_PREFERENCES_US);
+   auto* bytes = static_cast<const uint8_t*>(value);
+   values[ns + '/' + key].assign(bytes, bytes + len);
+   return len;
+}
@@ -0,0 +1,16 @@
+/*
+ * ESP32 GPIO registers for the host simulation, same addresses as in the ESP-IDF
+ */
+
+#ifndef ESP32_BUZZER_SIM_GPIO_REG_H
+#define ESP32_BUZZER_SIM_GPIO_REG_H
+
+#define DR_REG_GPIO_BASE 0x3ff44000
+#define GPIO_OUT_W1TS_REG (DR_REG_GPIO_BASE + 0x0008) // GPIO 0-31
+#define GPIO_OUT_W1TC_REG (DR_REG_GPIO_BASE + 0x000c)
+#define GPIO_OUT1_W1TS_REG (DR_REG_GPIO_BASE + 0x0014) // GPIO 32-39
+#define GPIO_OUT1_W1TC_REG (DR_REG_GPIO_BASE + 0x0018)
+#define GPIO_IN_REG (DR_REG_GPIO_BASE + 0x003c)
+#define GPIO_IN1_REG (DR_REG_GPIO_BASE + 0x0040)
+
+#endif //ESP32_BUZZER_SIM_GPIO_REG_H
@@ -0,0 +1,17 @@
+/*
+ * ESP32 register access for the host simulation
+ * Only the GPIO registers (soc/gpio_reg.h) are simulated, they work on the pin levels of simHal.
+ */
+
+#ifndef ESP32_BUZZER_SIM_SOC_H
+#define ESP32_BUZZER_SIM_SOC_H
+
+#include <cstdint>
+
+uint32_t simRegRead(uint32_t reg);
+void simRegWrite(uint32_t reg, uint32_t value);
+
+#define REG_READ(reg) simRegRead(reg)
+#define REG_WRITE(reg, value) simRegWrite(reg, value)
+
+#endif //ESP32_BUZZER_SIM_SOC_H
@@ -0,0 +1,271 @@
+/*
+ * Microbenchmarks of the hot functions on the host
+ * Times the quick access sequences, the button ladder decoding, the soundboard directory parsing and page lookup and
+ * the config accessors in host CPU time, over page counts up to MAX_PAGE_COUNT, library sizes and ADC noise patterns.
+ * The soundboard library is a synthetic one on a RAM disk, so no file system access is timed.
+ *
+ * Every benchmark prints one JSON line: name, parameters, iterations, median and minimum ns per operation over the
+ * repetitions. Compare two runs (e.g. of two commits) with scripts/bench_compare.py. Absolute numbers are from the
+ * host CPU, only the changes between runs on the same machine are meaningful.
+ */
+
+#include "inputs.h"
+#include "config.h"
+#include "soundboard.h"
+#include "storage/ramDisk.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Options
+{
+   std::string filter;
+   uint32_t minTimeMs = 20; // Per repetition
+   int repetitions = 7;
+   uint32_t seed = 1;
+};
+
+static Options options;
+static volatile int sink; // Results are written here so the compiler keeps the work
+
+// ADC readings of the buttons, keep in sync with inputs.cpp
+static const uint16_t pushReadings[] = { 3513, 1643, 2278, 0, 1073, 2913, 439 };
+static const uint16_t lcdReadings[] = { 3626, 2384, 150, 471, 1700, 1012 };
+
+static void usage(const char* name)
+{
+   fprintf(stderr, "Usage: %s [--filter text] [--min-time ms] [--repetitions n] [--seed n]\n", name);
+}
+
+static bool parseArgs(int argc, char** argv)
+{
+   for (int i = 1; i < argc; i++)
+   {
+      std::string arg = argv[i];
+      if (i + 1 >= argc) return false;
+      const char* value = argv[++i];
+      if (arg == "--filter") options.filter = value;
+      else if (arg == "--min-time") options.minTimeMs = (uint32_t)atoi(value);
+      else if (arg == "--repetitions") options.repetitions = std::max(1, atoi(value));
+      else if (arg == "--seed") options.seed = (uint32_t)strtoul(value, nullptr, 10);
+      else return false;
+   }
+   return true;
+}
+
+/**
+ * \brief Time an operation and print the result line
+ * \param name Benchmark name, matched against --filter
+ * \param params JSON object members, e.g. "\"pages\": 36"
+ * \param op Called with the iteration number, does one operation
+ */
+template<typename Op>
+static void run(const std::string& name, const std::string& params, Op op)
+{
+   if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+   using Clock = std::chrono::steady_clock;
+   auto timeBatch = [&](uint64_t iterations)
+   {
+      auto start = Clock::now();
+      for (uint64_t i = 0; i < iterations; i++) op(i);
+      return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+   };
+
+   // Grow the batch until it takes the minimum time, this also warms up the caches
+   uint64_t iterations = 1;
+   double minNs = options.minTimeMs * 1e6;
+   for (double ns = timeBatch(iterations); ns < minNs; ns = timeBatch(iterations))
+   {
+      iterations = ns < minNs / 100 ? iterations * 10 : (uint64_t)(iterations * minNs / ns * 1.1) + 1;
+   }
+
+   std::vector<double> perOp;
+   for (int r = 0; r < options.repetitions; r++) perOp.push_back(timeBatch(iterations) / (double)iterations);
+   std::sort(perOp.begin(), perOp.end());
+   printf("{\"benchmark\": \"%s\", \"params\": {%s}, \"iterations\": %llu, \"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f}\n",
+          name.c_str(), params.c_str(), (unsigned long long)iterations, perOp[perOp.size() / 2], perOp.front());
+   fflush(stdout);
+}
+
+/**
+ * \brief ADC readings of a ladder: all buttons in turn with uniform noise, or halfway between two buttons
+ */
+static std::vector<uint16_t> makeReadings(const uint16_t* buttons, size_t count, const std::string& pattern,
+                                          int amplitude)
+{
+   std::mt19937 rng(options.seed);
+   std::uniform_int_distribution<int> noise(-amplitude, amplitude);
+   std::vector<uint16_t> readings;
+   for (int i = 0; i < 1024; i++)
+   {
+      int value;
+      if (pattern == "idle") value = buttons[0];
+      else if (pattern == "between")
+      {
+         std::vector<uint16_t> sorted(buttons, buttons + count);
+         std::sort(sorted.begin(), sorted.end());
+         size_t j = i % (count - 1);
+         value = (sorted[j] + sorted[j + 1]) / 2;
+      }
+      else value = buttons[i % count];
+      readings.push_back((uint16_t)std::min(std::max(value + noise(rng), 0), 4095));
+   }
+   return readings;
+}
+
+static void benchSequences()
+{
+   for (int pageCount: { 1, 6, 7, 12, 18, 24, 30, MAX_PAGE_COUNT })
+   {
+      run("soundboard/get_sequence_for_page", "\"pages\": " + std::to_string(pageCount), [&](uint64_t i)
+      {
+         int sequence[MAX_QUICKACCESS_LEN];
+         get_sequence_for_page((uint32_t)(i % pageCount), pageCount, PUSH_BUTTON_COUNT, sequence, MAX_QUICKACCESS_LEN);
+         sink = sequence[0];
+      });
+   }
+}
+
+static void benchButtons()
+{
+   struct Pattern
+   {
+      const char* name;
+      int amplitude;
+   };
+   static const Pattern patterns[] = { { "idle", 20 }, { "buttons", 0 }, { "buttons", 40 }, { "buttons", 140 },
+                                       { "between", 20 } };
+   for (const auto& pattern: patterns)
+   {
+      std::string params = std::string("\"pattern\": \"") + pattern.name + "\", \"noise\": "
+                           + std::to_string(pattern.amplitude);
+      auto push = makeReadings(pushReadings, sizeof pushReadings / sizeof pushReadings[0], pattern.name,
+                               pattern.amplitude);
+      auto lcd = makeReadings(lcdReadings, sizeof lcdReadings / sizeof lcdReadings[0], pattern.name,
+                              pattern.amplitude);
+      run("inputs/getPushButtonFromReading", params, [&](uint64_t i)
+      {
+         sink = getPushButtonFromReading(push[i % push.size()]);
+      });
+      run("inputs/getLcdButtonFromReading", params, [&](uint64_t i)
+      {
+         sink = getLcdButtonFromReading(lcd[i % lcd.size()]);
+      });
+      // Both ladders with debouncing, a new reading every 5ms like in the main loop
+      run("inputs/processInputs", params, [&](uint64_t i)
+      {
+         static InputValues values{};
+         RawInputs raw{ (uint32_t)(i * 5), lcd[i % lcd.size()], push[i % push.size()], 0, 0 };
+         processInputs(raw, values);
+         sink = values.pushBtn;
+      });
+   }
+}
+
+static void benchDirnames()
+{
+   static const char* const dirnames[] = { "1_Intro", "12_Lustige Sprueche_alt", "36_x", "7_Filme und Serien",
+                                           "invalid" };
+   for (const char* dirname: dirnames)
+   {
+      std::string dir = dirname;
+      run("soundboard/parseDirname", "\"dirname\": \"" + dir + "\"", [&](uint64_t i)
+      {
+         int index = 0;
+         std::string name;
+         sink = parseDirname(dir, index, name) + index;
+      });
+   }
+}
+
+/**
+ * \brief Fill the RAM disk with a soundboard of pageCount directories with filesPerPage sounds each
+ */
+static void makeLibrary(RamDisk& disk, int pageCount, int filesPerPage)
+{
+   static const uint8_t wav[44] = { 'R', 'I', 'F', 'F' };
+   disk.clear();
+   for (int p = 1; p <= pageCount; p++)
+   {
+      for (int f = 1; f <= filesPerPage; f++)
+      {
+         char path[96];
+         snprintf(path, sizeof path, SOUNDBOARD_DIR "/%d_Page %d/%d_Sound %d-%d_extra.wav", p, p, f, p, f);
+         disk.addFile(path, wav, sizeof wav);
+      }
+   }
+}
+
+static void benchLibrary()
+{
+   static RamDisk disk;
+   storage.mount("RAM", "/", &disk);
+   for (int pageCount: { 6, 12, 24, MAX_PAGE_COUNT })
+   {
+      for (int filesPerPage: { 1, FILES_PER_PAGE })
+      {
+         makeLibrary(disk, pageCount, filesPerPage);
+         std::string params = "\"pages\": " + std::to_string(pageCount) + ", \"files_per_page\": "
+                              + std::to_string(filesPerPage);
+         SoundBoard board;
+         run("soundboard/begin", params, [&](uint64_t i)
+         {
+            board.begin();
+            sink = board.getPageCount();
+         });
+
+         if (filesPerPage != FILES_PER_PAGE) continue;
+         // All sequences the page jump mode can see: first button only and both buttons
+         std::vector<std::vector<int>> sequences;
+         for (int a = 0; a < PUSH_BUTTON_COUNT; a++)
+         {
+            sequences.push_back({ a, -1 });
+            for (int b = 0; b < PUSH_BUTTON_COUNT; b++) sequences.push_back({ a, b });
+         }
+         run("soundboard/getPageRangeFromSequence", params, [&](uint64_t i)
+         {
+            int minPage, maxPage;
+            sink = board.getPageRangeFromSequence(sequences[i % sequences.size()].data(), minPage, maxPage) + minPage;
+         });
+      }
+   }
+}
+
+static void benchConfig()
+{
+   run("config/getValue", "", [](uint64_t i)
+   {
+      sink = config.getValue((ConfigValue)(i % CFG_COUNT));
+   });
+   run("config/hasChanged", "", [](uint64_t i)
+   {
+      sink = config.hasChanged((ConfigValue)(i % CFG_COUNT));
+   });
+   // Every change is saved to the (simulated) preferences
+   run("config/setValue", "", [](uint64_t i)
+   {
+      config.setValue(CFG_SOUNDBOARD_VOLUME, (int)(i & 1) + 50);
+   });
+}
+
+int main(int argc, char** argv)
+{
+   if (!parseArgs(argc, argv))
+   {
+      usage(argv[0]);
+      return 2;
+   }
+   esp_log_level_set("*", ESP_LOG_ERROR);
+   config.load();
+
+   benchSequences();
+   benchButtons();
+   benchDirnames();
+   benchLibrary();
+   benchConfig();
+   return 0;
+}
@@ -0,0 +1,27 @@
+/*
+ * File system watch of the host simulation
+ * Replaces fsWatch.cpp, there is no FTP server (RUN_FTP=0) and the simulated SD card does not change.
+ */
+
+#include "storage/fsWatch.h"
+
+FsWatch sdWatch;
+
+void FsWatch::begin(const char* mountpoint, const char* watchedDir)
+{
+   dir = watchedDir;
+}
+
+void FsWatch::report(FsChangeType type, const char* path, const char* newPath)
+{
+}
+
+bool FsWatch::getChange(FsChange& change)
+{
+   return false;
+}
+
+bool FsWatch::takeOverflow()
+{
+   return false;
+}
@@ -0,0 +1,21 @@
+/*
+ * Menu screen of the host simulation
+ * Replaces menuScreen.cpp, LcdMenu is not available for the host. Like the real menu, a push button goes back to
+ * the soundboard and nothing else happens.
+ */
+
+#include "screens/menuScreen.h"
+
+void menuInit()
+{
+}
+
+Screen menuScreen(const InputValues& values, LiquidCrystal& lcd, bool enter)
+{
+   if (enter)
+   {
+      lcd.clear();
+      lcd.print("Menu");
+   }
+   return values.pushBtnChanged ? SCREEN_SOUNDBOARD : SCREEN_MENU;
+}
@@ -0,0 +1,78 @@
+/*
+ * Sound player of the host simulation
+ * Replaces sounds.cpp: there is no audio pipeline, requests are handed to the benchmark driver with their virtual
+ * time. That is where the firmware's part of the press-to-sound latency ends.
+ */
+
+#include "sounds.h"
+#include "gameLog.h"
+#include "simHal.h"
+#include <strings.h>
+
+static const char* TAG = "sounds";
+SoundPlayer soundPlayer;
+
+static bool hasExtension(const char* filename, const char* extension)
+{
+   size_t len = strlen(filename);
+   size_t extLen = strlen(extension);
+   return len >= extLen && strcasecmp(filename + len - extLen, extension) == 0;
+}
+
+bool isSupportedSoundFile(const std::string& filename)
+{
+   return hasExtension(filename.c_str(), ".wav") || hasExtension(filename.c_str(), ".mp3");
+}
+
+void SoundPlayer::begin()
+{
+   ready = true;
+}
+
+void SoundPlayer::loadIndex()
+{
+}
+
+bool SoundPlayer::requestPlayback(const char* filename, int prio, uint8_t volume)
+{
+   if (volume <= 0) return false;
+   requestCount++;
+   ESP_LOGD(TAG, "Playback of %s (prio %i, vol %i%%)", filename, prio, volume);
+   if (sim::hooks().soundRequest) sim::hooks().soundRequest(filename, prio);
+   gameLog.addSound(filename, prio, volume, true, false);
+   return true;
+}
+
+bool SoundPlayer::requestPlaylist(const char* const filenames[], int count, int prio, uint8_t volume)
+{
+   if (volume <= 0 || count <= 0) return false;
+   requestCount++;
+   if (sim::hooks().soundRequest) sim::hooks().soundRequest(filenames[0], prio);
+   gameLog.addSound(filenames[0], prio, volume, true, true);
+   return true;
+}
+
+void SoundPlayer::prefetch(const char* const filenames[], int count)
+{
+}
+
+void SoundPlayer::preload(const char* const filenames[], int count)
+{
+}
+
+void SoundPlayer::invalidate(const char* path)
+{
+}
+
+void SoundPlayer::startCountdown(uint32_t timeToAnswerMs, uint8_t beepVolume, uint8_t endVolume)
+{
+}
+
+void SoundPlayer::stopCountdown(uint8_t endVolume)
+{
+}
+
+bool SoundPlayer::listPackedSounds(const char* prefix, std::vector<std::string>& filenames) const
+{
+   return false;
+}
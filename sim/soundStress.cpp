@@ -0,0 +1,432 @@
+/*
+ * Stress test of the sound player on the host
+ * Runs the real playback task (sounds.cpp and the audio pipeline) on host threads in real time and sends playback
+ * requests from several tasks, each at its own rate (Poisson arrivals) and priority. The files are WAVs on a RAM
+ * disk, each with its own constant sample value, so the I2S stand-in (AudioOutputI2S.h) tells from the samples which
+ * file is heard and from when. Reported are dropped requests (queue full), the time the callers are blocked in
+ * requestPlayback(), the latency from a request to its first sample at the I2S output, separately for starts from
+ * silence and preemptions of another file, and the jitter of the start latency (p99 - p50).
+ * With --stall a read of the RAM disk blocks now and then like a busy SD card, playbacks must go on without underruns.
+ * With --open-ms opening a file takes as long as on the SD card. With --prefetch the first files are prefetched
+ * like the visible page of the soundboard, their playbacks start from RAM before their files are opened.
+ *
+ * Task spec: <requests per second>:<prio>, e.g. --task 5:4 --task 1:3 for a soundboard being hammered while
+ * buzzers are pressed. Times are host times, they depend on the host and its load. Compare runs on the same machine.
+ * With --trace the trace points of the last events (tracePoints.h) are dumped into a file at the end, for
+ * scripts/trace_to_chrome.py.
+ */
+
+#include "simHal.h"
+#include "distribution.h"
+#include "sounds.h"
+#include "deferredLog.h"
+#include "tracePoints.h"
+#include "allocCounter.h"
+#include "storage/storage.h"
+#include "storage/ramDisk.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STRESS_SAMPLE_STEP 1000 // Left channel of file k is k * step, the right one -k * step (max 16 files, no clipping)
+#define STRESS_STABLE_SAMPLES 8 // The resampler blends two files for a sample, a change counts after this many
+#define STRESS_GAP_US 2000 // Longer gaps between samples are silence (the I2S buffers ran empty)
+#define STRESS_STALL_INTERVAL_MS 200 // At most one stalled read in this time
+
+struct TaskSpec
+{
+   double rate; // Requests per second
+   int prio;
+};
+
+struct Options
+{
+   std::vector<TaskSpec> tasks;
+   uint32_t durationS = 20;
+   int files = 8;
+   uint32_t fileMs = 400;
+   uint32_t countdownMs = 0;
+   uint32_t seed = 1;
+   uint32_t stallMs = 0;
+   uint32_t openMs = 0;
+   int prefetch = 0; // Files 1..n
+   int logLevel = ESP_LOG_ERROR;
+   std::string traceFile;
+};
+
+struct Request
+{
+   uint64_t atUs; // Before the call
+   int task;
+   int file;
+   bool accepted;
+   uint64_t blockedUs; // In requestPlayback()
+};
+
+struct StartEvent
+{
+   uint64_t atUs; // Play time of the first sample of the file
+   int file;
+   bool preempted; // Another file was playing until then
+};
+
+static std::mutex mutex;
+static std::vector<Request> requests;
+static std::vector<StartEvent> starts;
+static std::atomic<bool> stopRequests{ false };
+
+static void usage(const char* name)
+{
+   fprintf(stderr, "Usage: %s [--task rate:prio]... [--duration s] [--files n] [--file-ms ms] [--countdown-ms ms] "
+                   "[--seed n] [--stall ms] [--open-ms ms] [--prefetch n] [--log 0-5] [--trace file]\n", name);
+}
+
+static bool parseArgs(int argc, char** argv, Options& options)
+{
+   for (int i = 1; i < argc; i++)
+   {
+      std::string arg = argv[i];
+      if (i + 1 >= argc) return false;
+      const char* value = argv[++i];
+      if (arg == "--task")
+      {
+         TaskSpec task{};
+         if (sscanf(value, "%lf:%d", &task.rate, &task.prio) != 2 || task.rate <= 0) return false;
+         options.tasks.push_back(task);
+      }
+      else if (arg == "--duration") options.durationS = (uint32_t)atoi(value);
+      else if (arg == "--files") options.files = std::max(1, std::min(atoi(value), 16));
+      else if (arg == "--file-ms") options.fileMs = (uint32_t)std::max(10, atoi(value));
+      else if (arg == "--countdown-ms") options.countdownMs = (uint32_t)atoi(value);
+      else if (arg == "--seed") options.seed = (uint32_t)strtoul(value, nullptr, 10);
+      else if (arg == "--stall") options.stallMs = (uint32_t)atoi(value);
+      else if (arg == "--open-ms") options.openMs = (uint32_t)atoi(value);
+      else if (arg == "--prefetch") options.prefetch = std::max(0, std::min(atoi(value), PREFETCH_SLOTS));
+      else if (arg == "--log") options.logLevel = atoi(value);
+      else if (arg == "--trace") options.traceFile = value;
+      else return false;
+   }
+   if (options.tasks.empty()) options.tasks = { { 4, SOUND_PRIO_SOUNDBOARD }, { 4, SOUND_PRIO_SOUNDBOARD },
+                                                { 1, SOUND_PRIO_BUZZER_START } };
+   return true;
+}
+
+/**
+ * \brief RAM disk that is slow like an SD card: opening a file takes openMs, reads block for stallMs every
+ *    STRESS_STALL_INTERVAL_MS as if the card was busy
+ */
+class StallingDisk : public RamDisk
+{
+private:
+   class StallingFile : public StorageFile
+   {
+   private:
+      StorageFilePtr file;
+      const StallingDisk& disk;
+
+   public:
+      StallingFile(StorageFilePtr file, const StallingDisk& disk) : file(std::move(file)), disk(disk) {}
+
+      size_t read(uint8_t* data, size_t len) override
+      {
+         uint64_t nowUs = sim::now();
+         uint64_t lastUs = disk.lastStallUs.load();
+         if (nowUs - lastUs >= STRESS_STALL_INTERVAL_MS * 1000ULL && disk.lastStallUs.compare_exchange_strong(lastUs, nowUs))
+         {
+            delay(disk.stallMs);
+         }
+         return file->read(data, len);
+      }
+
+      bool seek(uint32_t pos) override { return file->seek(pos); }
+      uint32_t position() const override { return file->position(); }
+      uint32_t size() const override { return file->size(); }
+   };
+
+   mutable std::atomic<uint64_t> lastStallUs{ 0 };
+
+public:
+   uint32_t stallMs = 0;
+   uint32_t openMs = 0;
+
+   StorageFilePtr open(const char* path) override
+   {
+      if (openMs) delay(openMs);
+      StorageFilePtr file = RamDisk::open(path);
+      if (!file || !stallMs) return file;
+      return StorageFilePtr(new StallingFile(std::move(file), *this));
+   }
+};
+
+static std::string filePath(int file)
+{
+   return "/stress/" + std::to_string(file) + ".wav";
+}
+
+/**
+ * \brief 16 bit stereo WAV at the output rate with a constant sample value that identifies it
+ */
+static std::vector<uint8_t> makeWav(int file, uint32_t durationMs)
+{
+   uint32_t frames = (uint32_t)((uint64_t)SOUND_OUTPUT_RATE * durationMs / 1000);
+   uint32_t dataSize = frames * 4;
+   std::vector<uint8_t> wav(44 + dataSize);
+   auto put = [&](size_t pos, uint32_t value, int bytes)
+   {
+      for (int i = 0; i < bytes; i++) wav[pos + i] = (uint8_t)(value >> (8 * i));
+   };
+   memcpy(&wav[0], "RIFF", 4);
+   put(4, 36 + dataSize, 4);
+   memcpy(&wav[8], "WAVEfmt ", 8);
+   put(16, 16, 4);
+   put(20, 1, 2); // PCM
+   put(22, 2, 2);
+   put(24, SOUND_OUTPUT_RATE, 4);
+   put(28, SOUND_OUTPUT_RATE * 4, 4);
+   put(32, 4, 2);
+   put(34, 16, 2);
+   memcpy(&wav[36], "data", 4);
+   put(40, dataSize, 4);
+   auto left = (uint16_t)(int16_t)(file * STRESS_SAMPLE_STEP);
+   auto right = (uint16_t)(int16_t)(-file * STRESS_SAMPLE_STEP);
+   for (uint32_t i = 0; i < frames; i++) put(44 + i * 4, left | (uint32_t)right << 16, 4);
+   return wav;
+}
+
+/**
+ * \brief Follow the file that is heard at the I2S output and note when a new one starts
+ * Tones of the countdown are the same on both channels and drop out of the difference.
+ */
+static void onI2sSample(const int16_t sample[2], uint64_t playUs)
+{
+   static int stableFile = 0;
+   static int candidate = 0;
+   static int candidateCount = 0;
+   static uint64_t candidateUs = 0;
+   static uint64_t lastUs = 0;
+
+   if (playUs > lastUs + STRESS_GAP_US)
+   {
+      stableFile = 0;
+      candidate = 0;
+      candidateCount = 0;
+   }
+   lastUs = playUs;
+
+   int file = (int)lround((sample[0] - sample[1]) / (2.0 * STRESS_SAMPLE_STEP));
+   if (file != candidate)
+   {
+      candidate = file;
+      candidateCount = 0;
+      candidateUs = playUs;
+   }
+   if (++candidateCount != STRESS_STABLE_SAMPLES || candidate == stableFile) return;
+   if (candidate != 0)
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      starts.push_back({ candidateUs, candidate, stableFile != 0 });
+   }
+   stableFile = candidate;
+}
+
+static void requestTask(int task, TaskSpec spec, const Options& options)
+{
+   std::mt19937 rng(options.seed * 7919 + task);
+   std::exponential_distribution<double> interval(spec.rate);
+   std::uniform_int_distribution<int> file(1, options.files);
+   while (!stopRequests)
+   {
+      delayMicroseconds((uint32_t)(interval(rng) * 1e6));
+      if (stopRequests) break;
+      Request request{ sim::now(), task, file(rng), false, 0 };
+      request.accepted = soundPlayer.requestPlayback(filePath(request.file).c_str(), spec.prio, 100);
+      request.blockedUs = sim::now() - request.atUs;
+      std::lock_guard<std::mutex> lock(mutex);
+      requests.push_back(request);
+   }
+}
+
+#if TRACE_POINTS
+class FilePrint : public Print
+{
+private:
+   FILE* file;
+
+public:
+   explicit FilePrint(FILE* file) : file(file) {}
+   size_t write(uint8_t c) override { return fputc(c, file) == EOF ? 0 : 1; }
+   using Print::write;
+};
+#endif
+
+static double ms(uint64_t us)
+{
+   return us / 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+   Options options;
+   if (!parseArgs(argc, argv, options))
+   {
+      usage(argv[0]);
+      return 2;
+   }
+   esp_log_level_set("*", (esp_log_level_t)options.logLevel);
+
+   static StallingDisk disk;
+   disk.stallMs = options.stallMs;
+   disk.openMs = options.openMs;
+   for (int file = 1; file <= options.files; file++)
+   {
+      std::vector<uint8_t> wav = makeWav(file, options.fileMs);
+      disk.addFile(filePath(file).c_str(), wav.data(), wav.size());
+   }
+   storage.mount("RAM", "/", &disk);
+
+   sim::setRealTime(true);
+#if ALLOC_COUNTER
+   allocCounter.begin();
+#endif
+   deferredLog.begin();
+   sim::hooks().i2sSample = onI2sSample;
+   soundPlayer.begin();
+   soundPlayer.loadIndex();
+   while (!soundPlayer.isReady()) delay(1);
+   if (options.prefetch)
+   {
+      std::vector<std::string> paths;
+      const char* names[PREFETCH_SLOTS];
+      for (int file = 1; file <= options.prefetch; file++) paths.push_back(filePath(file));
+      for (int i = 0; i < options.prefetch; i++) names[i] = paths[i].c_str();
+      soundPlayer.prefetch(names, options.prefetch);
+      delay(100); // Loaded by the idle playback task
+   }
+#if ALLOC_COUNTER
+   allocCounter.markSteady();
+#endif
+
+   printf("%zu tasks for %us, %d files of %ums", options.tasks.size(), options.durationS, options.files,
+          options.fileMs);
+   if (options.stallMs) printf(", reads stall for %ums every %ums", options.stallMs, STRESS_STALL_INTERVAL_MS);
+   if (options.openMs) printf(", opening a file takes %ums", options.openMs);
+   if (options.prefetch) printf(", %d prefetched", options.prefetch);
+   printf("\n");
+   // Reserved up front, so recording does not allocate in the playback task (ALLOC_COUNTER=1 builds)
+   double expected = 0;
+   for (const TaskSpec& spec: options.tasks) expected += spec.rate * options.durationS;
+   requests.reserve((size_t)(expected * 2) + 1000);
+   starts.reserve((size_t)(expected * 2) + 1000);
+
+   uint64_t startUs = sim::now();
+   std::vector<std::thread> threads;
+   for (size_t t = 0; t < options.tasks.size(); t++)
+   {
+      threads.emplace_back(requestTask, (int)t, options.tasks[t], std::cref(options));
+   }
+   uint64_t endUs = startUs + options.durationS * 1000000ULL;
+   while (sim::now() < endUs)
+   {
+      if (options.countdownMs)
+      {
+         soundPlayer.startCountdown(options.countdownMs, 30, 30);
+         delay(options.countdownMs + 500);
+      }
+      else delay(100);
+   }
+   stopRequests = true;
+   for (auto& thread: threads) thread.join();
+   delay(options.fileMs + 500); // Let the last playback finish
+#if ALLOC_COUNTER
+   allocCounter.report();
+#endif
+#if TRACE_POINTS
+   if (!options.traceFile.empty())
+   {
+      FILE* file = fopen(options.traceFile.c_str(), "w");
+      if (file)
+      {
+         FilePrint out(file);
+         tracePoints.dump(out);
+         fclose(file);
+      }
+      else fprintf(stderr, "Cannot write %s\n", options.traceFile.c_str());
+   }
+#endif
+
+   std::lock_guard<std::mutex> lock(mutex);
+
+   // A start belongs to the latest accepted request of its file before it. Accepted requests without a start were
+   // stops (same file requested again), had a lower prio than the playing file or were replaced by a later request
+   // before they got played.
+   Distribution startLatency, preemptLatency, blocking;
+   std::vector<uint64_t> lastMatchedUs(options.files + 1, 0);
+   std::vector<bool> matched(requests.size(), false);
+   int unexplained = 0;
+   for (const StartEvent& start: starts)
+   {
+      int best = -1;
+      for (size_t r = 0; r < requests.size(); r++)
+      {
+         const Request& request = requests[r];
+         if (request.accepted && request.file == start.file && request.atUs < start.atUs
+             && request.atUs > lastMatchedUs[start.file] && (best < 0 || request.atUs > requests[best].atUs))
+         {
+            best = (int)r;
+         }
+      }
+      if (best < 0)
+      {
+         unexplained++;
+         continue;
+      }
+      matched[best] = true;
+      lastMatchedUs[start.file] = requests[best].atUs;
+      (start.preempted ? preemptLatency : startLatency).add(ms(start.atUs - requests[best].atUs));
+   }
+
+   printf("\n%-5s %8s %5s %7s %8s %9s %12s %12s\n", "task", "rate/s", "prio", "sent", "dropped", "no start",
+          "blocked p99", "blocked max");
+   int totalSent = 0, totalDropped = 0;
+   for (size_t t = 0; t < options.tasks.size(); t++)
+   {
+      Distribution taskBlocking;
+      int sent = 0, dropped = 0, noStart = 0;
+      for (size_t r = 0; r < requests.size(); r++)
+      {
+         if (requests[r].task != (int)t) continue;
+         sent++;
+         if (!requests[r].accepted) dropped++;
+         else if (!matched[r]) noStart++;
+         taskBlocking.add(ms(requests[r].blockedUs));
+         blocking.add(ms(requests[r].blockedUs));
+      }
+      printf("%-5zu %8.1f %5d %7d %8d %9d %9.3f ms %9.3f ms\n", t, options.tasks[t].rate, options.tasks[t].prio, sent,
+             dropped, noStart, taskBlocking.percentile(99), taskBlocking.percentile(100));
+      totalSent += sent;
+      totalDropped += dropped;
+   }
+   printf("Dropped %d of %d requests (%.1f%%)\n", totalDropped, totalSent,
+          totalSent ? 100.0 * totalDropped / totalSent : 0.0);
+   // A file that goes on after the I2S buffers ran empty looks like a start without a request
+   printf("Underruns during a playback: %d\n", unexplained);
+
+   Distribution::printHeader();
+   blocking.print("caller blocked", "ms");
+   startLatency.print("request-to-start", "ms");
+   preemptLatency.print("preemption", "ms");
+   printf("\nStart jitter (p99 - p50): %.3f ms from silence, %.3f ms preempting\n",
+          startLatency.percentile(99) - startLatency.percentile(50),
+          preemptLatency.percentile(99) - preemptLatency.percentile(50));
+
+   // The playback task never returns, don't wait for it
+   fflush(stdout);
+   _Exit(0);
+}
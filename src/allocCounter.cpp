@@ -0,0 +1,314 @@
+/*
+ * Allocation counter
+ */
+
+#include "allocCounter.h"
+
+#if ALLOC_COUNTER
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#ifdef ESP_PLATFORM
+#include <esp_debug_helpers.h>
+#else
+#include <execinfo.h> // Host simulation
+#include <unistd.h>
+#endif
+
+// Every function from operator new to the backtrace keeps its own frame (no inlining, no tail calls), so the same
+// number of frames is left out for every allocation
+#define ALLOC_FRAME __attribute__((noinline, optimize("no-optimize-sibling-calls")))
+
+static const char* TAG = "allocCounter";
+AllocCounter allocCounter;
+
+/**
+ * \brief Return addresses of the callers
+ * \param skip Frames to leave out, after this function
+ * \param[out] stack Stack pointers of the frames (0 on the host)
+ * \return Number of frames
+ */
+__attribute__((noinline)) static int captureFrames(int skip, uintptr_t* frames, uintptr_t* stack, int depth)
+{
+#ifdef ESP_PLATFORM
+   esp_backtrace_frame_t frame{};
+   esp_backtrace_get_start(&frame.pc, &frame.sp, &frame.next_pc);
+   int n = 0;
+   while (n < depth && frame.next_pc && esp_backtrace_get_next_frame(&frame))
+   {
+      if (skip > 0)
+      {
+         skip--;
+         continue;
+      }
+      // Return addresses carry the register window size in the top bits, the call is 3 bytes before
+      frames[n] = ((frame.pc & 0x3fffffff) | 0x40000000) - 3;
+      stack[n] = frame.sp;
+      n++;
+   }
+   return n;
+#else
+   void* buffer[ALLOC_COUNTER_DEPTH + 8];
+   int count = backtrace(buffer, min(depth + skip + 1, (int)(sizeof buffer / sizeof buffer[0])));
+   int n = 0;
+   for (int i = skip + 1; i < count; i++, n++)
+   {
+      frames[n] = (uintptr_t)buffer[i];
+      stack[n] = 0;
+   }
+   return n;
+#endif
+}
+
+void AllocCounter::begin()
+{
+#ifndef ESP_PLATFORM
+   // The first backtrace() loads the unwinder, which allocates
+   void* buffer[1];
+   backtrace(buffer, 1);
+#endif
+   lastReportMs = millis();
+}
+
+void AllocCounter::markSteady()
+{
+   ESP_LOGI(TAG, "Steady state reached, counting allocations");
+   steady = true;
+}
+
+AllocTaskCounts* AllocCounter::findTask(TaskHandle_t task)
+{
+   for (auto& counts: tasks)
+   {
+      TaskHandle_t current = counts.task.load(std::memory_order_acquire);
+      if (current == task) return &counts;
+      if (!current)
+      {
+         if (counts.task.compare_exchange_strong(current, task, std::memory_order_acq_rel))
+         {
+            counts.name = pcTaskGetTaskName(task);
+            return &counts;
+         }
+         if (current == task) return &counts;
+      }
+   }
+   return nullptr;
+}
+
+ALLOC_FRAME void AllocCounter::recordSite(const AllocTaskCounts* counts)
+{
+   uintptr_t frames[ALLOC_COUNTER_DEPTH], stack[ALLOC_COUNTER_DEPTH];
+   // Leaves out this function, add(), allocate() and the operator new
+   int depth = captureFrames(4, frames, stack, ALLOC_COUNTER_DEPTH);
+
+   // FNV-1a of the return addresses, 0 marks free slots
+   uint32_t hash = 2166136261u;
+   for (int i = 0; i < depth; i++)
+   {
+      hash ^= (uint32_t)frames[i];
+      hash *= 16777619u;
+   }
+   if (!hash) hash = 1;
+
+   for (int i = 0; i < ALLOC_COUNTER_SITES; i++)
+   {
+      AllocSite& site = sites[(hash + i) % ALLOC_COUNTER_SITES];
+      uint32_t current = site.hash.load(std::memory_order_acquire);
+      if (!current && site.hash.compare_exchange_strong(current, hash, std::memory_order_acq_rel))
+      {
+         memcpy(site.frames, frames, sizeof frames);
+         memcpy(site.stack, stack, sizeof stack);
+         site.depth = depth;
+         site.task = counts ? counts->name : nullptr;
+         site.noAllocName = counts && counts->noAllocDepth ? counts->noAllocName : nullptr;
+         site.count.fetch_add(1, std::memory_order_relaxed);
+         site.ready.store(true, std::memory_order_release);
+         return;
+      }
+      if (current == hash)
+      {
+         site.count.fetch_add(1, std::memory_order_relaxed);
+         return;
+      }
+   }
+   lostSites.fetch_add(1, std::memory_order_relaxed);
+}
+
+ALLOC_FRAME void AllocCounter::add(size_t size)
+{
+   if (!steady.load(std::memory_order_relaxed)) return;
+   AllocTaskCounts* counts = findTask(xTaskGetCurrentTaskHandle());
+   if (counts)
+   {
+      if (counts->reporting) return;
+      if (counts->exemptDepth && !counts->noAllocDepth)
+      {
+         counts->exemptCount.fetch_add(1, std::memory_order_relaxed);
+         return;
+      }
+      counts->count.fetch_add(1, std::memory_order_relaxed);
+      counts->bytes.fetch_add((uint32_t)size, std::memory_order_relaxed);
+   }
+   recordSite(counts);
+#if ALLOC_COUNTER_ASSERT
+   assert((!counts || !counts->noAllocDepth) && "Allocation in a NO_ALLOC_SCOPE");
+#endif
+}
+
+void AllocCounter::enterNoAlloc(const char* name)
+{
+   AllocTaskCounts* counts = findTask(xTaskGetCurrentTaskHandle());
+   if (!counts) return;
+   if (counts->noAllocDepth++ == 0) counts->noAllocName = name;
+}
+
+void AllocCounter::leaveNoAlloc()
+{
+   AllocTaskCounts* counts = findTask(xTaskGetCurrentTaskHandle());
+   if (counts && counts->noAllocDepth > 0) counts->noAllocDepth--;
+}
+
+void AllocCounter::enterExempt(const char* name)
+{
+   AllocTaskCounts* counts = findTask(xTaskGetCurrentTaskHandle());
+   if (!counts) return;
+   if (counts->exemptDepth++ == 0) counts->exemptName = name;
+}
+
+void AllocCounter::leaveExempt()
+{
+   AllocTaskCounts* counts = findTask(xTaskGetCurrentTaskHandle());
+   if (counts && counts->exemptDepth > 0) counts->exemptDepth--;
+}
+
+void AllocCounter::report()
+{
+   // The logging may allocate itself, that is not counted
+   AllocTaskCounts* self = findTask(xTaskGetCurrentTaskHandle());
+   if (self) self->reporting = true;
+
+   for (auto& counts: tasks)
+   {
+      if (!counts.task.load(std::memory_order_acquire)) break;
+      uint32_t count = counts.count.load(std::memory_order_relaxed);
+      if (count == counts.reportedCount) continue;
+      ESP_LOGW(TAG, "%s: %u allocations (%u new, %u bytes) since the steady state", counts.name ? counts.name : "?",
+               (unsigned)count, (unsigned)(count - counts.reportedCount),
+               (unsigned)counts.bytes.load(std::memory_order_relaxed));
+      counts.reportedCount = count;
+   }
+
+   for (auto& counts: tasks)
+   {
+      if (!counts.task.load(std::memory_order_acquire)) break;
+      uint32_t count = counts.exemptCount.load(std::memory_order_relaxed);
+      if (count == counts.reportedExemptCount) continue;
+      // Named after the last scope the task entered
+      ESP_LOGI(TAG, "%s: %u exempt allocations (%u new) in %s", counts.name ? counts.name : "?", (unsigned)count,
+               (unsigned)(count - counts.reportedExemptCount), counts.exemptName ? counts.exemptName : "?");
+      counts.reportedExemptCount = count;
+   }
+
+   for (auto& site: sites)
+   {
+      if (site.reported || !site.ready.load(std::memory_order_acquire)) continue;
+      site.reported = true;
+      if (site.noAllocName)
+      {
+         ESP_LOGE(TAG, "Allocation in %s (NO_ALLOC_SCOPE) of %s, %u times:", site.noAllocName,
+                  site.task ? site.task : "?", (unsigned)site.count.load(std::memory_order_relaxed));
+      }
+      else
+      {
+         ESP_LOGW(TAG, "New call site in %s, %u times:", site.task ? site.task : "?",
+                  (unsigned)site.count.load(std::memory_order_relaxed));
+      }
+#ifdef ESP_PLATFORM
+      // Same format as a panic, the exception decoder of the serial monitor turns it into lines of code
+      char line[16 + ALLOC_COUNTER_DEPTH * 22];
+      size_t len = snprintf(line, sizeof line, "Backtrace:");
+      for (int i = 0; i < site.depth && len < sizeof line; i++)
+      {
+         len += snprintf(line + len, sizeof line - len, " 0x%08x:0x%08x", (unsigned)site.frames[i],
+                         (unsigned)site.stack[i]);
+      }
+      esp_log_write(ESP_LOG_WARN, TAG, "%s\n", line);
+#else
+      void* frames[ALLOC_COUNTER_DEPTH];
+      for (int i = 0; i < site.depth; i++) frames[i] = (void*)site.frames[i];
+      backtrace_symbols_fd(frames, site.depth, STDERR_FILENO);
+#endif
+   }
+
+   uint32_t lost = lostSites.exchange(0, std::memory_order_relaxed);
+   if (lost) ESP_LOGW(TAG, "%u allocations from call sites that did not fit into the table", (unsigned)lost);
+
+   if (self) self->reporting = false;
+}
+
+void AllocCounter::loop()
+{
+   if (steady && millis() - lastReportMs >= ALLOC_COUNTER_REPORT_MS)
+   {
+      report();
+      lastReportMs = millis();
+   }
+}
+
+// Every C++ allocation goes through these, C code calling malloc() directly is not counted
+
+/**
+ * \brief Count and allocate, the one path of all operator new
+ * \param nothrow Return nullptr instead of aborting if there is no memory
+ */
+ALLOC_FRAME static void* allocate(size_t size, bool nothrow)
+{
+   allocCounter.add(size);
+   void* p = malloc(size ? size : 1);
+   if (!p && !nothrow) abort(); // Like an uncaught std::bad_alloc
+   return p;
+}
+
+ALLOC_FRAME void* operator new(size_t size)
+{
+   return allocate(size, false);
+}
+
+ALLOC_FRAME void* operator new[](size_t size)
+{
+   return allocate(size, false);
+}
+
+ALLOC_FRAME void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+   return allocate(size, true);
+}
+
+ALLOC_FRAME void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+   return allocate(size, true);
+}
+
+void operator delete(void* p) noexcept
+{
+   free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+   free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+   free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+   free(p);
+}
+
+#endif
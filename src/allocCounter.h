@@ -0,0 +1,142 @@
+/*
+ * Allocation counter
+ * With ALLOC_COUNTER=1 (env:alloc) the global operator new/delete are replaced: once the steady state is reached
+ * (the end of the boot: storage, soundboard, caches and logs are set up), every C++ heap allocation is counted per
+ * task and its call site (a short backtrace) is kept in a fixed table. The loop reports new allocations and sites
+ * every ALLOC_COUNTER_REPORT_MS. NO_ALLOC_SCOPE marks the real-time sections (decoding and I2S in the
+ * playback task, input and buzzer handling in the loop): an allocation in there is an error, with
+ * ALLOC_COUNTER_ASSERT it stops at the allocation, so the panic backtrace shows the culprit. ALLOC_EXEMPT_SCOPE marks
+ * known allocations that can't be avoided (e.g. opening a file in the file system library), they are only counted
+ * and reported by the scope name. Without ALLOC_COUNTER the macros are empty and nothing of this is built.
+ */
+
+#ifndef ESP32_BUZZER_ALLOCCOUNTER_H
+#define ESP32_BUZZER_ALLOCCOUNTER_H
+
+#ifndef ALLOC_COUNTER
+#define ALLOC_COUNTER 0
+#endif
+
+#if ALLOC_COUNTER
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <Arduino.h>
+
+#ifndef ALLOC_COUNTER_ASSERT
+#define ALLOC_COUNTER_ASSERT 1 // Abort on an allocation in a NO_ALLOC_SCOPE
+#endif
+#define ALLOC_COUNTER_REPORT_MS 10000
+#define ALLOC_COUNTER_TASKS 16
+#define ALLOC_COUNTER_SITES 32
+#define ALLOC_COUNTER_DEPTH 6 // Frames per call site, after operator new
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+#define NO_ALLOC_SCOPE(name) NoAllocScope ALLOC_CONCAT(noAllocScope, __LINE__)(name)
+#define ALLOC_EXEMPT_SCOPE(name) AllocExemptScope ALLOC_CONCAT(allocExemptScope, __LINE__)(name)
+
+struct AllocTaskCounts
+{
+   std::atomic<TaskHandle_t> task;
+   const char* name;
+   std::atomic<uint32_t> count; // Since the steady state
+   std::atomic<uint32_t> bytes;
+   std::atomic<uint32_t> exemptCount; // In an ALLOC_EXEMPT_SCOPE, not in count and bytes
+   uint32_t reportedCount;
+   uint32_t reportedExemptCount;
+   int noAllocDepth; // Only changed by the task itself
+   const char* noAllocName; // Outermost NO_ALLOC_SCOPE
+   int exemptDepth; // Only changed by the task itself
+   const char* exemptName; // Outermost ALLOC_EXEMPT_SCOPE
+   bool reporting;
+};
+
+struct AllocSite
+{
+   std::atomic<uint32_t> hash; // Of the frames, 0 = free
+   std::atomic<bool> ready; // Frames are written
+   uintptr_t frames[ALLOC_COUNTER_DEPTH];
+   uintptr_t stack[ALLOC_COUNTER_DEPTH]; // Stack pointers of the frames, for the exception decoder
+   int depth;
+   const char* task;
+   const char* noAllocName; // NO_ALLOC_SCOPE it happened in, nullptr if none
+   std::atomic<uint32_t> count;
+   bool reported;
+};
+
+class AllocCounter
+{
+private:
+   AllocTaskCounts tasks[ALLOC_COUNTER_TASKS]{};
+   AllocSite sites[ALLOC_COUNTER_SITES]{};
+   std::atomic<bool> steady{ false };
+   std::atomic<uint32_t> lostSites{ 0 }; // Allocations whose site did not fit into the table
+   uint32_t lastReportMs = 0;
+
+   AllocTaskCounts* findTask(TaskHandle_t task);
+   void recordSite(const AllocTaskCounts* counts);
+
+public:
+   /**
+    * \brief Prepare the backtraces, call before anything runs in parallel
+    */
+   void begin();
+
+   /**
+    * \brief Start counting, call when the boot is done
+    */
+   void markSteady();
+
+   /**
+    * \brief Report new allocations, call once per loop
+    */
+   void loop();
+
+   /**
+    * \brief Log the allocations and call sites since the last report
+    */
+   void report();
+
+   /**
+    * \brief Count an allocation of the calling task, from operator new
+    */
+   void add(size_t size);
+
+   void enterNoAlloc(const char* name);
+   void leaveNoAlloc();
+   void enterExempt(const char* name);
+   void leaveExempt();
+};
+
+extern AllocCounter allocCounter;
+
+/**
+ * \brief Real-time section from its construction to the end of the block, it must not allocate
+ */
+class NoAllocScope
+{
+public:
+   explicit NoAllocScope(const char* name) { allocCounter.enterNoAlloc(name); }
+   ~NoAllocScope() { allocCounter.leaveNoAlloc(); }
+};
+
+/**
+ * \brief Known allocations from its construction to the end of the block, counted apart without call sites
+ */
+class AllocExemptScope
+{
+public:
+   explicit AllocExemptScope(const char* name) { allocCounter.enterExempt(name); }
+   ~AllocExemptScope() { allocCounter.leaveExempt(); }
+};
+
+#else
+
+#define NO_ALLOC_SCOPE(name) do {} while (0)
+#define ALLOC_EXEMPT_SCOPE(name) do {} while (0)
+
+#endif
+
+#endif //ESP32_BUZZER_ALLOCCOUNTER_H
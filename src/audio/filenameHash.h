@@ -0,0 +1,24 @@
+/*
+ * Hash of filenames for the lookup tables of the sound player (trim index, sound pack) and the play statistics
+ */
+
+#ifndef ESP32_BUZZER_FILENAMEHASH_H
+#define ESP32_BUZZER_FILENAMEHASH_H
+
+#include <cstdint>
+
+/**
+ * \brief FNV-1a hash of a filename
+ */
+inline uint32_t hashFilename(const char* filename)
+{
+   uint32_t h = 2166136261u;
+   for (const char* c = filename; *c; c++)
+   {
+      h ^= (uint8_t)*c;
+      h *= 16777619u;
+   }
+   return h;
+}
+
+#endif //ESP32_BUZZER_FILENAMEHASH_H
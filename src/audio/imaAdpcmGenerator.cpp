@@ -0,0 +1,241 @@
+/*
+ * IMA-ADPCM WAV generator
+ */
+
+#include "imaAdpcmGenerator.h"
+#include <Arduino.h>
+
+static const char* TAG = "adpcm";
+
+static const int16_t stepTable[89] = {
+   7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+   107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+   876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+   5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+   27086, 29794, 32767
+};
+
+static const int8_t indexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+struct AdpcmChannel
+{
+   int32_t predictor;
+   int32_t index;
+};
+
+static inline int16_t decodeNibble(AdpcmChannel& ch, uint8_t nibble)
+{
+   int32_t step = stepTable[ch.index];
+   int32_t diff = step >> 3;
+   if (nibble & 4) diff += step;
+   if (nibble & 2) diff += step >> 1;
+   if (nibble & 1) diff += step >> 2;
+   ch.predictor += (nibble & 8) ? -diff : diff;
+   if (ch.predictor > 32767) ch.predictor = 32767;
+   else if (ch.predictor < -32768) ch.predictor = -32768;
+   ch.index += indexTable[nibble];
+   if (ch.index < 0) ch.index = 0;
+   else if (ch.index > 88) ch.index = 88;
+   return (int16_t)ch.predictor;
+}
+
+static inline uint16_t readLe16(const uint8_t* p)
+{
+   return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t readLe32(const uint8_t* p)
+{
+   return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t readWavFormatTag(AudioFileSource* source)
+{
+   uint8_t buf[12];
+   uint16_t tag = 0;
+   if (source->read(buf, 12) == 12 && memcmp(buf, "RIFF", 4) == 0 && memcmp(buf + 8, "WAVE", 4) == 0)
+   {
+      // Skip chunks until fmt
+      while (source->read(buf, 8) == 8)
+      {
+         uint32_t size = readLe32(buf + 4);
+         if (memcmp(buf, "fmt ", 4) == 0)
+         {
+            if (source->read(buf, 2) == 2) tag = readLe16(buf);
+            break;
+         }
+         if (!source->seek((int32_t)(size + (size & 1)), SEEK_CUR)) break;
+      }
+   }
+   source->seek(0, SEEK_SET);
+   return tag;
+}
+
+ImaAdpcmGenerator::ImaAdpcmGenerator()
+{
+   running = false;
+   file = nullptr;
+   output = nullptr;
+}
+
+ImaAdpcmGenerator::~ImaAdpcmGenerator()
+{
+   free(block);
+   free(pcm);
+}
+
+bool ImaAdpcmGenerator::readHeader()
+{
+   uint8_t buf[20];
+   if (file->read(buf, 12) != 12 || memcmp(buf, "RIFF", 4) != 0 || memcmp(buf + 8, "WAVE", 4) != 0) return false;
+
+   bool haveFormat = false;
+   while (file->read(buf, 8) == 8)
+   {
+      uint32_t size = readLe32(buf + 4);
+      if (memcmp(buf, "fmt ", 4) == 0)
+      {
+         if (size < 16 || file->read(buf, 16) != 16) return false;
+         if (readLe16(buf) != WAVE_FORMAT_IMA_ADPCM || readLe16(buf + 14) != 4) return false;
+         channels = readLe16(buf + 2);
+         sampleRate = readLe32(buf + 4);
+         blockAlign = readLe16(buf + 12);
+         if (channels < 1 || channels > 2 || blockAlign <= 4 * channels || blockAlign > MAX_BLOCK_ALIGN) return false;
+         haveFormat = true;
+         size -= 16;
+      }
+      else if (memcmp(buf, "data", 4) == 0)
+      {
+         dataLeft = size;
+         return haveFormat;
+      }
+      if (!file->seek((int32_t)(size + (size & 1)), SEEK_CUR)) return false;
+   }
+   return false;
+}
+
+/**
+ * \brief Read and decode the next block into pcm
+ * \return false at the end of the data
+ */
+bool ImaAdpcmGenerator::decodeBlock()
+{
+   uint32_t len = min((uint32_t)blockAlign, dataLeft);
+   if (len <= 4u * channels) return false;
+   len = file->read(block, len);
+   if (len <= 4u * channels) return false;
+   dataLeft -= len;
+
+   // Block header per channel: first sample, step index, reserved
+   AdpcmChannel state[2];
+   for (int c = 0; c < channels; c++)
+   {
+      state[c].predictor = (int16_t)readLe16(block + 4 * c);
+      state[c].index = min((int)block[4 * c + 2], 88);
+      pcm[c] = (int16_t)state[c].predictor;
+   }
+
+   const uint8_t* data = block + 4 * channels;
+   uint32_t dataLen = len - 4 * channels;
+   if (channels == 1)
+   {
+      // Two samples per byte, low nibble first
+      for (uint32_t i = 0; i < dataLen; i++)
+      {
+         pcm[1 + 2 * i] = decodeNibble(state[0], data[i] & 0x0f);
+         pcm[2 + 2 * i] = decodeNibble(state[0], data[i] >> 4);
+      }
+      pcmFrames = 1 + 2 * dataLen;
+   }
+   else
+   {
+      // Groups of 4 bytes (8 samples) per channel, alternating left and right
+      uint32_t groups = dataLen / 8;
+      for (uint32_t g = 0; g < groups; g++)
+      {
+         for (int c = 0; c < 2; c++)
+         {
+            const uint8_t* in = data + g * 8 + c * 4;
+            int16_t* out = pcm + 2 * (1 + g * 8) + c;
+            for (int i = 0; i < 4; i++)
+            {
+               out[4 * i] = decodeNibble(state[c], in[i] & 0x0f);
+               out[4 * i + 2] = decodeNibble(state[c], in[i] >> 4);
+            }
+         }
+      }
+      pcmFrames = 1 + 8 * groups;
+   }
+   pcmPos = 0;
+   return true;
+}
+
+bool ImaAdpcmGenerator::begin(AudioFileSource* source, AudioOutput* output)
+{
+   if (!source || !output) return false;
+   file = source;
+   this->output = output;
+   running = false;
+   pcmFrames = 0;
+   pcmPos = 0;
+   if (!file->isOpen() || !readHeader())
+   {
+      ESP_LOGE(TAG, "No valid IMA-ADPCM WAV file");
+      return false;
+   }
+
+   // Each byte holds two samples, plus one sample per channel in the block header
+   uint32_t framesPerBlock = (blockAlign - 4 * channels) * 2 / channels + 1;
+   uint32_t pcmSamples = framesPerBlock * channels;
+   if (blockAlign > blockCapacity)
+   {
+      free(block);
+      block = (uint8_t*)malloc(blockAlign);
+      blockCapacity = block ? blockAlign : 0;
+   }
+   if (pcmSamples > pcmCapacity)
+   {
+      free(pcm);
+      pcm = (int16_t*)malloc(pcmSamples * sizeof(int16_t));
+      pcmCapacity = pcm ? pcmSamples : 0;
+   }
+   if (!block || !pcm)
+   {
+      ESP_LOGE(TAG, "Out of memory for block of %u bytes", blockAlign);
+      stop();
+      return false;
+   }
+
+   if (!output->SetRate((int)sampleRate)) return false;
+   if (!output->SetBitsPerSample(16)) return false;
+   if (!output->SetChannels(channels)) return false;
+   if (!output->begin()) return false;
+   running = true;
+   return true;
+}
+
+bool ImaAdpcmGenerator::loop()
+{
+   while (running)
+   {
+      if (pcmPos == pcmFrames && !decodeBlock())
+      {
+         stop();
+         break;
+      }
+      lastSample[AudioOutput::LEFTCHANNEL] = pcm[pcmPos * channels];
+      lastSample[AudioOutput::RIGHTCHANNEL] = pcm[pcmPos * channels + channels - 1];
+      if (!output->ConsumeSample(lastSample)) break; // Output full, try again with the same sample
+      pcmPos++;
+   }
+   file->loop();
+   output->loop();
+   return running;
+}
+
+bool ImaAdpcmGenerator::stop()
+{
+   running = false;
+   if (output) output->stop();
+   return file && file->close();
+}
@@ -0,0 +1,54 @@
+/*
+ * IMA-ADPCM WAV generator
+ * Plays WAV files with format tag 0x11 (4 bits per sample, mono or stereo). A whole block (blockAlign bytes,
+ * usually 512 or 1024) is read and decoded at once, so reads are few and large. Use
+ * scripts/wav_to_adpcm.py to convert sounds.
+ */
+
+#ifndef ESP32_BUZZER_IMAADPCMGENERATOR_H
+#define ESP32_BUZZER_IMAADPCMGENERATOR_H
+
+#include <cstdint>
+#include "AudioGenerator.h"
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IMA_ADPCM 0x0011
+
+/**
+ * \brief Read the format tag from the fmt chunk of a WAV file and seek back to the start
+ * \param source Opened source positioned at the start of the file
+ * \return Format tag (WAVE_FORMAT_...) or 0 if the file is no valid WAV
+ */
+uint16_t readWavFormatTag(AudioFileSource* source);
+
+class ImaAdpcmGenerator : public AudioGenerator
+{
+private:
+   static constexpr uint16_t MAX_BLOCK_ALIGN = 2048;
+
+   uint16_t channels = 0;
+   uint32_t sampleRate = 0;
+   uint16_t blockAlign = 0;
+   uint32_t dataLeft = 0;
+
+   // Kept from file to file and only grown, so playback does not allocate once the largest block size was seen
+   uint8_t* block = nullptr;
+   int16_t* pcm = nullptr; // Interleaved samples of the decoded block
+   uint32_t blockCapacity = 0;
+   uint32_t pcmCapacity = 0;
+   uint16_t pcmFrames = 0;
+   uint16_t pcmPos = 0;
+
+   bool readHeader();
+   bool decodeBlock();
+
+public:
+   ImaAdpcmGenerator();
+   ~ImaAdpcmGenerator() override;
+   bool begin(AudioFileSource* source, AudioOutput* output) override;
+   bool loop() override;
+   bool stop() override;
+   bool isRunning() override { return running; }
+};
+
+#endif //ESP32_BUZZER_IMAADPCMGENERATOR_H
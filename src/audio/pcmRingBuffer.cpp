@@ -0,0 +1,81 @@
+/*
+ * PCM ring buffer output
+ */
+
+#include "pcmRingBuffer.h"
+#include "allocCounter.h"
+
+PcmRingBuffer::PcmRingBuffer(AudioOutput* sink, size_t capacityFrames, ToneVoice* voice)
+   : sink(sink), voice(voice), frames(new uint32_t[capacityFrames]), capacity(capacityFrames),
+     mutex(xSemaphoreCreateMutex())
+{
+   hertz = 0;
+   bps = 16;
+   channels = 2;
+}
+
+PcmRingBuffer::~PcmRingBuffer()
+{
+   delete[] frames;
+}
+
+TaskHandle_t PcmRingBuffer::startPumpTask(uint32_t stackSize, UBaseType_t priority, BaseType_t core)
+{
+   TaskHandle_t task = nullptr;
+   if (xTaskCreatePinnedToCore(pumpTask, "I2sTask", stackSize, this, priority, &task, core) != pdPASS) return nullptr;
+   return task;
+}
+
+[[noreturn]] void PcmRingBuffer::pumpTask(void* param)
+{
+   auto* self = static_cast<PcmRingBuffer*>(param);
+   while (true)
+   {
+      self->pump();
+      delay(PCM_PUMP_INTERVAL_MS);
+   }
+}
+
+bool PcmRingBuffer::ConsumeSample(int16_t sample[2])
+{
+   uint32_t h = head.load(std::memory_order_relaxed);
+   if (h - tail.load(std::memory_order_acquire) >= capacity || framesIn >= inputLimit) return false;
+   frames[h % capacity] = (uint16_t)sample[LEFTCHANNEL] | ((uint32_t)(uint16_t)sample[RIGHTCHANNEL] << 16);
+   head.store(h + 1, std::memory_order_release);
+   framesIn++;
+   return true;
+}
+
+size_t PcmRingBuffer::pump()
+{
+   NO_ALLOC_SCOPE("i2s");
+   lock();
+   uint32_t t = tail.load(std::memory_order_relaxed);
+   uint32_t h = head.load(std::memory_order_acquire);
+   size_t moved = 0;
+   while (t != h || (voice && voice->isActive()))
+   {
+      int16_t sample[2] = { 0, 0 };
+      bool buffered = t != h;
+      if (buffered)
+      {
+         sample[LEFTCHANNEL] = (int16_t)(frames[t % capacity] & 0xffff);
+         sample[RIGHTCHANNEL] = (int16_t)(frames[t % capacity] >> 16);
+      }
+      if (voice) voice->mix(sample, clock);
+      if (!sink->ConsumeSample(sample)) break;
+      if (buffered) t++;
+      clock++;
+      moved++;
+   }
+   tail.store(t, std::memory_order_release);
+   unlock();
+   return moved;
+}
+
+void PcmRingBuffer::clear()
+{
+   lock();
+   tail.store(head.load(std::memory_order_relaxed), std::memory_order_release);
+   unlock();
+}
@@ -0,0 +1,94 @@
+/*
+ * PCM ring buffer output
+ * Generators decode ahead into this buffer in the playback task. The samples are moved to the I2S output by a pump
+ * task of higher priority, independent of the decoder: while the decoder is stuck in a slow MP3 frame or an SD
+ * hiccup, the pump keeps feeding the DMA from the buffered samples. The ring has a single producer (ConsumeSample(),
+ * clear()). pump() may be called by the producer as well, the callers take turns on a mutex. Without the pump task
+ * (host simulation without threads) only the producer calls it.
+ * The optional tone voice is mixed in on the way out, the frames handed to the sink are the sample clock for it. The
+ * voice and the clock belong to pump(), other tasks only touch them between lock() and unlock().
+ */
+
+#ifndef ESP32_BUZZER_PCMRINGBUFFER_H
+#define ESP32_BUZZER_PCMRINGBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <Arduino.h>
+#include "AudioOutput.h"
+#include "toneVoice.h"
+
+#define PCM_PUMP_INTERVAL_MS 2 // The I2S DMA holds about 23ms
+
+class PcmRingBuffer : public AudioOutput
+{
+private:
+   AudioOutput* sink;
+   ToneVoice* voice;
+   uint32_t* frames; // Stereo 16 bit frames, left channel in the lower half
+   size_t capacity; // Power of two, the positions run over
+   std::atomic<uint32_t> head{ 0 }; // Frames written, by the producer
+   std::atomic<uint32_t> tail{ 0 }; // Frames sent to the sink, by pump() (and clear() with the lock held)
+   uint32_t framesIn = 0;
+   uint32_t inputLimit = UINT32_MAX;
+   uint64_t clock = 0; // Frames handed to the sink
+   SemaphoreHandle_t mutex;
+
+   [[noreturn]] static void pumpTask(void* param);
+
+public:
+   PcmRingBuffer(AudioOutput* sink, size_t capacityFrames, ToneVoice* voice = nullptr);
+   ~PcmRingBuffer() override;
+
+   bool begin() override { return true; }
+   bool ConsumeSample(int16_t sample[2]) override;
+   bool stop() override { return true; }
+
+   /**
+    * \brief Start the task that calls pump() every PCM_PUMP_INTERVAL_MS
+    * \return Task handle, nullptr if it could not be started (then the producer has to call pump())
+    */
+   TaskHandle_t startPumpTask(uint32_t stackSize, UBaseType_t priority, BaseType_t core);
+
+   /**
+    * \brief Move as many buffered frames as the sink accepts
+    * While tones are active, silence is sent when the ring runs empty to keep the sample clock running.
+    * \return Number of frames moved
+    */
+   size_t pump();
+
+   /**
+    * \brief Drop all buffered frames (used when a playback is cancelled), producer only
+    */
+   void clear();
+
+   /**
+    * \brief Keep pump() out, to change the tone voice or read the clock from another task
+    */
+   void lock() { xSemaphoreTake(mutex, portMAX_DELAY); }
+   void unlock() { xSemaphoreGive(mutex); }
+
+   // Producer side, pump() may take out frames at any time
+   bool isEmpty() const { return getCount() == 0; }
+   bool isFull() const { return getCount() >= capacity; }
+   size_t getCount() const { return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire); }
+
+   /**
+    * \brief Number of frames written since the last resetFramesIn()
+    */
+   uint32_t getFramesIn() const { return framesIn; }
+   void resetFramesIn() { framesIn = 0; }
+
+   /**
+    * \brief Refuse frames once getFramesIn() has reached the limit, so a generator stops early (UINT32_MAX = none)
+    */
+   void setInputLimit(uint32_t frames) { inputLimit = frames; }
+
+   /**
+    * \brief Sample clock: number of frames handed to the sink since start (with the lock held, or from pump())
+    */
+   uint64_t getClock() const { return clock; }
+};
+
+#endif //ESP32_BUZZER_PCMRINGBUFFER_H
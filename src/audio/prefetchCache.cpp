@@ -0,0 +1,201 @@
+/*
+ * Prefetch cache for the visible soundboard page
+ */
+
+#include "prefetchCache.h"
+#include "storage/storage.h"
+
+static const char* TAG = "prefetch";
+
+void PrefetchCache::begin(const TrimIndex* trims)
+{
+   this->trims = trims;
+   mutex = xSemaphoreCreateMutex();
+   for (auto& slot: slots)
+   {
+      slot.data = (uint8_t*)malloc(PREFETCH_BYTES);
+   }
+}
+
+void PrefetchCache::request(const char* const filenames[], int count)
+{
+   xSemaphoreTake(mutex, portMAX_DELAY);
+   for (int i = 0; i < PREFETCH_SLOTS; i++)
+   {
+      wanted[i][0] = '\0';
+      if (i < count && filenames[i]) strlcpy(wanted[i], filenames[i], PREFETCH_NAME_LEN);
+   }
+   wantedGeneration.fetch_add(1, std::memory_order_release);
+   xSemaphoreGive(mutex);
+}
+
+/**
+ * \brief Drop slots that are not wanted anymore and assign the new sounds to free slots
+ */
+void PrefetchCache::takeOverWanted(const char* playing)
+{
+   char names[PREFETCH_SLOTS][PREFETCH_NAME_LEN];
+   xSemaphoreTake(mutex, portMAX_DELAY);
+   memcpy(names, wanted, sizeof names);
+   slotsGeneration.store(wantedGeneration.load(std::memory_order_relaxed), std::memory_order_relaxed);
+   xSemaphoreGive(mutex);
+
+   // Keep slots that are still wanted (or still playing), free the others. The playing one can take the spare
+   // slot, so all wanted sounds still get one.
+   bool keep[PREFETCH_SLOTS] = { false };
+   for (auto& slot: slots)
+   {
+      bool stillWanted = playing && strcmp(slot.filename, playing) == 0;
+      for (int i = 0; i < PREFETCH_SLOTS && !stillWanted; i++)
+      {
+         if (!keep[i] && names[i][0] != '\0' && strcmp(slot.filename, names[i]) == 0)
+         {
+            keep[i] = true;
+            stillWanted = true;
+         }
+      }
+      if (!stillWanted)
+      {
+         slot.filename[0] = '\0';
+         slot.loaded = false;
+      }
+   }
+
+   // New sounds go to free slots, they are loaded by loadNext()
+   for (int i = 0; i < PREFETCH_SLOTS; i++)
+   {
+      if (keep[i] || names[i][0] == '\0') continue;
+      for (auto& slot: slots)
+      {
+         if (slot.filename[0] == '\0')
+         {
+            strlcpy(slot.filename, names[i], PREFETCH_NAME_LEN);
+            slot.loaded = false;
+            break;
+         }
+      }
+   }
+}
+
+bool PrefetchCache::loadNext(const char* playing)
+{
+   if (hasNewWanted()) takeOverWanted(playing);
+
+   for (auto& slot: slots)
+   {
+      if (slot.loaded || slot.filename[0] == '\0' || !slot.data) continue;
+
+      StorageFilePtr f = storage.open(slot.filename);
+      if (!f)
+      {
+         ESP_LOGW(TAG, "Failed to open %s", slot.filename);
+         slot.filename[0] = '\0';
+         return hasWork();
+      }
+      // Trimmed sounds are stored without the silence, otherwise the prefetched part could be just that
+      const SoundTrim* trim = trims ? trims->find(slot.filename) : nullptr;
+      slot.fileSize = trimmedSize(trim, f->size());
+      slot.length = readTrimmed(*f, trim, slot.data, min((uint32_t)PREFETCH_BYTES, slot.fileSize));
+      slot.loaded = true;
+      ESP_LOGD(TAG, "Prefetched %u of %u bytes of %s", slot.length, slot.fileSize, slot.filename);
+      return hasWork();
+   }
+   return false;
+}
+
+bool PrefetchCache::hasNewWanted() const
+{
+   return wantedGeneration.load(std::memory_order_acquire) != slotsGeneration.load(std::memory_order_relaxed);
+}
+
+bool PrefetchCache::hasWork() const
+{
+   if (hasNewWanted()) return true;
+   for (const auto& slot: slots)
+   {
+      if (!slot.loaded && slot.filename[0] != '\0' && slot.data) return true;
+   }
+   return false;
+}
+
+const PrefetchCache::Slot* PrefetchCache::find(const char* filename) const
+{
+   for (const auto& slot: slots)
+   {
+      if (slot.loaded && strcmp(slot.filename, filename) == 0) return &slot;
+   }
+   return nullptr;
+}
+
+void PrefetchCache::invalidate(const char* path)
+{
+   for (auto& slot: slots)
+   {
+      if (slot.filename[0] != '\0' && isInPath(slot.filename, path)) slot.loaded = false;
+   }
+}
+
+bool PrefetchSource::open(const PrefetchCache::Slot* slot, AudioFileSource* file)
+{
+   this->slot = slot;
+   this->file = file;
+   pos = 0;
+   return true;
+}
+
+uint32_t PrefetchSource::read(void* data, uint32_t len)
+{
+   if (!slot) return 0;
+   auto* dest = static_cast<uint8_t*>(data);
+   uint32_t done = 0;
+   if (pos < slot->length)
+   {
+      done = min(len, slot->length - pos);
+      memcpy(dest, slot->data + pos, done);
+      pos += done;
+   }
+
+   // Rest comes from the file. It is opened by openFile() before decoding, here only for a header that is longer
+   // than the prefetched part (while the generator starts).
+   if (done < len && pos < slot->fileSize)
+   {
+      if (!file->isOpen() && !openFile()) return done;
+      if (file->getPos() != pos && !file->seek((int32_t)pos, SEEK_SET)) return done;
+      uint32_t n = file->read(dest + done, len - done);
+      pos += n;
+      done += n;
+   }
+   return done;
+}
+
+bool PrefetchSource::needsFile()
+{
+   return slot && slot->length < slot->fileSize && !file->isOpen();
+}
+
+bool PrefetchSource::openFile()
+{
+   if (!slot) return false;
+   if (file->isOpen()) return true;
+   if (file->open(slot->filename)) return true;
+   ESP_LOGW(TAG, "Failed to open %s after its prefetched part", slot->filename);
+   return false;
+}
+
+bool PrefetchSource::seek(int32_t newPos, int dir)
+{
+   if (!slot) return false;
+   int64_t target = newPos;
+   if (dir == SEEK_CUR) target += pos;
+   else if (dir == SEEK_END) target += slot->fileSize;
+   if (target < 0 || target > slot->fileSize) return false;
+   pos = (uint32_t)target;
+   return true;
+}
+
+bool PrefetchSource::close()
+{
+   if (file && file->isOpen()) file->close();
+   slot = nullptr;
+   return true;
+}
@@ -0,0 +1,118 @@
+/*
+ * Prefetch cache for the visible soundboard page
+ * The soundboard tells which sounds are visible, the playback task loads the first few kB of each (header and
+ * start of the audio) into RAM while it has nothing else to do. A press on one of them starts from RAM right away:
+ * the first PREFETCH_FIRST_FRAMES are decoded and sent to I2S, only then the file on SD is opened for the rest.
+ */
+
+#ifndef ESP32_BUZZER_PREFETCHCACHE_H
+#define ESP32_BUZZER_PREFETCHCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <Arduino.h>
+#include "AudioFileSource.h"
+#include "soundTrim.h"
+
+#define PREFETCH_SLOTS 6 // Wanted sounds, there is one more slot for a playing sound that is not wanted anymore
+#define PREFETCH_BYTES 4096
+#define PREFETCH_NAME_LEN 128
+#define PREFETCH_FIRST_FRAMES 768 // Played before the file is opened, 3 kB of 16 bit stereo at the output rate
+
+class PrefetchCache
+{
+public:
+   struct Slot
+   {
+      char filename[PREFETCH_NAME_LEN];
+      uint8_t* data;
+      uint32_t length;
+      uint32_t fileSize; // Trimmed size if the sound is trimmed
+      bool loaded;
+   };
+
+private:
+   Slot slots[PREFETCH_SLOTS + 1]{};
+   const TrimIndex* trims = nullptr;
+
+   // Set by the UI task, taken over by the playback task. The generations are compared without the mutex.
+   SemaphoreHandle_t mutex = nullptr;
+   char wanted[PREFETCH_SLOTS][PREFETCH_NAME_LEN]{};
+   std::atomic<uint32_t> wantedGeneration{ 0 };
+   std::atomic<uint32_t> slotsGeneration{ 0 };
+
+   bool hasNewWanted() const;
+   void takeOverWanted(const char* playing);
+
+public:
+   /**
+    * \param trims Trimmed sounds are prefetched without their leading silence
+    */
+   void begin(const TrimIndex* trims);
+
+   /**
+    * \brief Replace the set of sounds to prefetch, sounds that are not in the new set are dropped (UI task)
+    * \param filenames Filenames, empty strings are ignored
+    * \param count Number of filenames (max PREFETCH_SLOTS)
+    */
+   void request(const char* const filenames[], int count);
+
+   /**
+    * \brief Load the next sound that is not prefetched yet (playback task)
+    * \param playing Filename of the current playback, its slot is kept even if it is not wanted anymore
+    * \return true if there is more to load
+    */
+   bool loadNext(const char* playing);
+
+   bool hasWork() const;
+
+   /**
+    * \brief Find a prefetched sound (playback task)
+    * \return Slot or nullptr if the sound is not prefetched
+    */
+   const Slot* find(const char* filename) const;
+
+   /**
+    * \brief Load sounds again whose files have changed (playback task, not while one of them is playing)
+    * \param path File or directory
+    */
+   void invalidate(const char* path);
+};
+
+/**
+ * \brief Source that reads the start of a file from a prefetch slot and the rest from a file source
+ *    (a TrimmedSource for trimmed sounds, as the slot holds the trimmed start)
+ */
+class PrefetchSource : public AudioFileSource
+{
+private:
+   const PrefetchCache::Slot* slot = nullptr;
+   AudioFileSource* file = nullptr;
+   uint32_t pos = 0;
+
+public:
+   /**
+    * \param slot Prefetched start of the file
+    * \param file Source for the rest, opened with the filename of the slot by openFile()
+    */
+   bool open(const PrefetchCache::Slot* slot, AudioFileSource* file);
+
+   /**
+    * \brief The file has more than the prefetched part and is not open yet
+    */
+   bool needsFile();
+
+   /**
+    * \brief Open the file for the rest. Opening allocates, so the playback task calls this before it decodes
+    *    (outside of the NO_ALLOC_SCOPE).
+    */
+   bool openFile();
+   uint32_t read(void* data, uint32_t len) override;
+   bool seek(int32_t pos, int dir) override;
+   bool close() override;
+   bool isOpen() override { return slot != nullptr; }
+   uint32_t getSize() override { return slot ? slot->fileSize : 0; }
+   uint32_t getPos() override { return pos; }
+};
+
+#endif //ESP32_BUZZER_PREFETCHCACHE_H
@@ -0,0 +1,111 @@
+/*
+ * Resampling audio output
+ */
+
+#include "resampleOutput.h"
+#include <Arduino.h>
+
+static const char* TAG = "resample";
+
+ResampleOutput::ResampleOutput(AudioOutput* sink, int outputRate) : sink(sink), outputRate(outputRate)
+{
+   hertz = outputRate;
+   bps = 16;
+   channels = 2;
+   gainF2P6 = 1 << 6;
+}
+
+bool ResampleOutput::SetRate(int hz)
+{
+   if (hz <= 0) return false;
+   hertz = hz;
+   step = (uint32_t)(((uint64_t)hz << 16) / outputRate);
+   return true;
+}
+
+bool ResampleOutput::begin()
+{
+   // Only reset the interpolator, the sink keeps running at its fixed rate
+   phase = PHASE_ONE;
+   primed = false;
+   cycles = 0;
+   samplesOut = 0;
+   return true;
+}
+
+/**
+ * \brief Push interpolated samples between prev and cur to the sink until the next input sample is needed
+ * \return false if the sink is full and there are still samples pending
+ */
+bool ResampleOutput::drain()
+{
+   while (phase < PHASE_ONE)
+   {
+      uint32_t start = ESP.getCycleCount();
+      int32_t frac = (int32_t)(phase >> 1); // Q15 so the product fits into 32 bits
+      int16_t out[2];
+      out[LEFTCHANNEL] = (int16_t)(prev[LEFTCHANNEL] + (((cur[LEFTCHANNEL] - prev[LEFTCHANNEL]) * frac) >> 15));
+      out[RIGHTCHANNEL] = (int16_t)(prev[RIGHTCHANNEL] + (((cur[RIGHTCHANNEL] - prev[RIGHTCHANNEL]) * frac) >> 15));
+      cycles += ESP.getCycleCount() - start;
+
+      if (!sink->ConsumeSample(out)) return false;
+      samplesOut++;
+      phase += step;
+   }
+   return true;
+}
+
+bool ResampleOutput::ConsumeSample(int16_t sample[2])
+{
+   int16_t s[2] = { sample[LEFTCHANNEL], sample[RIGHTCHANNEL] };
+   MakeSampleStereo16(s);
+   s[LEFTCHANNEL] = Amplify(s[LEFTCHANNEL]);
+   s[RIGHTCHANNEL] = Amplify(s[RIGHTCHANNEL]);
+
+   if (hertz == outputRate)
+   {
+      if (!sink->ConsumeSample(s)) return false;
+      samplesOut++;
+      return true;
+   }
+
+   // Samples of the previous input that did not fit into the sink yet have to go first
+   if (!drain()) return false;
+
+   if (!primed)
+   {
+      prev[LEFTCHANNEL] = s[LEFTCHANNEL];
+      prev[RIGHTCHANNEL] = s[RIGHTCHANNEL];
+      primed = true;
+   }
+   else
+   {
+      prev[LEFTCHANNEL] = cur[LEFTCHANNEL];
+      prev[RIGHTCHANNEL] = cur[RIGHTCHANNEL];
+   }
+   cur[LEFTCHANNEL] = s[LEFTCHANNEL];
+   cur[RIGHTCHANNEL] = s[RIGHTCHANNEL];
+   phase -= PHASE_ONE;
+
+   // Input is accepted even if the sink fills up, the rest is sent with the next sample
+   drain();
+   return true;
+}
+
+bool ResampleOutput::stop()
+{
+   // Don't stop the sink, AudioOutputI2S plays silence on underflow
+   if (hertz != outputRate && samplesOut > 0)
+   {
+      ESP_LOGD(TAG, "%u Hz -> %i Hz: %.2fs audio, %luus CPU per second of audio", hertz, outputRate,
+               (float)samplesOut / (float)outputRate, (unsigned long)getCpuUsPerSecond());
+   }
+   return true;
+}
+
+uint32_t ResampleOutput::getCpuUsPerSecond() const
+{
+   if (samplesOut == 0) return 0;
+   uint64_t cpuUs = cycles / ESP.getCpuFreqMHz();
+   return (uint32_t)(cpuUs * outputRate / samplesOut);
+}
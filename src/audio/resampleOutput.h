@@ -0,0 +1,49 @@
+/*
+ * Resampling audio output
+ * Sits between a generator and the I2S output. The I2S output runs at one fixed rate, files with a different rate
+ * are converted on the fly by linear interpolation (Q16 fixed-point phase), so starting a file never touches the
+ * I2S clock. The volume of the file (SetGain) is applied here as well, so the I2S output can mix other voices in
+ * at their own volume.
+ */
+
+#ifndef ESP32_BUZZER_RESAMPLEOUTPUT_H
+#define ESP32_BUZZER_RESAMPLEOUTPUT_H
+
+#include <cstdint>
+#include "AudioOutput.h"
+
+class ResampleOutput : public AudioOutput
+{
+private:
+   static constexpr uint32_t PHASE_ONE = 1 << 16;
+
+   AudioOutput* sink;
+   int outputRate;
+   uint32_t step = PHASE_ONE; // Input samples per output sample (Q16)
+   uint32_t phase = PHASE_ONE; // Position between prev (0) and cur (PHASE_ONE)
+   bool primed = false;
+   int16_t prev[2] = { 0, 0 };
+   int16_t cur[2] = { 0, 0 };
+
+   // CPU usage statistics of the current file
+   uint32_t cycles = 0;
+   uint32_t samplesOut = 0;
+
+   bool drain();
+
+public:
+   ResampleOutput(AudioOutput* sink, int outputRate);
+
+   bool SetRate(int hz) override;
+   bool begin() override;
+   bool ConsumeSample(int16_t sample[2]) override;
+   bool stop() override;
+
+   /**
+    * \brief CPU time spent resampling per second of output audio since the last begin()
+    * \return Microseconds of CPU time per second of audio, 0 if nothing was resampled
+    */
+   uint32_t getCpuUsPerSecond() const;
+};
+
+#endif //ESP32_BUZZER_RESAMPLEOUTPUT_H
@@ -0,0 +1,79 @@
+/*
+ * Sound bank in flash
+ */
+
+#include "soundBank.h"
+#include <Arduino.h>
+#include <esp_partition.h>
+
+static const char* TAG = "soundbank";
+
+bool SoundBank::begin()
+{
+   const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                               SOUNDBANK_PARTITION);
+   if (!partition)
+   {
+      ESP_LOGW(TAG, "No " SOUNDBANK_PARTITION " partition, all sounds are read from SD");
+      return false;
+   }
+
+   SoundBankHeader header{};
+   if (esp_partition_read(partition, 0, &header, sizeof header) != ESP_OK
+       || memcmp(header.magic, SOUNDBANK_MAGIC, sizeof header.magic) != 0 || header.version != SOUNDBANK_VERSION
+       || header.totalSize > partition->size
+       || sizeof header + (uint32_t)header.count * sizeof(SoundBankEntry) > header.totalSize)
+   {
+      ESP_LOGW(TAG, "No valid sound bank in flash, all sounds are read from SD");
+      return false;
+   }
+
+   // Only map what is used, the data address space is shared with the app
+   const void* mapped;
+   spi_flash_mmap_handle_t handle;
+   esp_err_t rc = esp_partition_mmap(partition, 0, header.totalSize, SPI_FLASH_MMAP_DATA, &mapped, &handle);
+   if (rc != ESP_OK)
+   {
+      ESP_LOGE(TAG, "Failed to map sound bank: %s", esp_err_to_name(rc));
+      return false;
+   }
+
+   // The table of contents is checked once, find() relies on it. A bad entry makes the whole bank unusable, it
+   // was not written by soundbank_pack.py.
+   auto* toc = reinterpret_cast<const SoundBankEntry*>(static_cast<const uint8_t*>(mapped) + sizeof header);
+   uint32_t dataStart = sizeof header + header.count * sizeof(SoundBankEntry);
+   for (int i = 0; i < header.count; i++)
+   {
+      const SoundBankEntry& entry = toc[i];
+      if (!memchr(entry.name, '\0', SOUNDBANK_NAME_LEN) || entry.offset < dataStart
+          || entry.offset > header.totalSize || entry.length > header.totalSize - entry.offset)
+      {
+         ESP_LOGE(TAG, "Entry %d of the sound bank is invalid, all sounds are read from SD", i);
+         spi_flash_munmap(handle);
+         return false;
+      }
+   }
+
+   base = static_cast<const uint8_t*>(mapped);
+   entries = toc;
+   count = header.count;
+   ESP_LOGI(TAG, "Mapped sound bank with %u sounds (%u bytes)", count, header.totalSize);
+   for (int i = 0; i < count; i++)
+   {
+      ESP_LOGD(TAG, "%s: %u bytes", entries[i].name, entries[i].length);
+   }
+   return true;
+}
+
+const uint8_t* SoundBank::find(const char* name, uint32_t& length) const
+{
+   for (int i = 0; i < count; i++)
+   {
+      if (strncmp(entries[i].name, name, SOUNDBANK_NAME_LEN) == 0)
+      {
+         length = entries[i].length;
+         return base + entries[i].offset;
+      }
+   }
+   return nullptr;
+}
@@ -0,0 +1,57 @@
+/*
+ * Sound bank in flash
+ * Fixed sounds (buzzer, random sounds) are packed by scripts/soundbank_pack.py into the "soundbank" data partition.
+ * The partition is memory-mapped at boot, so these sounds are played straight from flash without file system or
+ * SD card access.
+ */
+
+#ifndef ESP32_BUZZER_SOUNDBANK_H
+#define ESP32_BUZZER_SOUNDBANK_H
+
+#include <cstdint>
+
+#define SOUNDBANK_PARTITION "soundbank"
+#define SOUNDBANK_MAGIC "SBNK"
+#define SOUNDBANK_VERSION 1
+#define SOUNDBANK_NAME_LEN 56
+
+// Layout in flash (little endian), keep in sync with scripts/soundbank_pack.py
+struct SoundBankHeader
+{
+   char magic[4];
+   uint16_t version;
+   uint16_t count;
+   uint32_t totalSize; // Header, table of contents and data
+};
+
+struct SoundBankEntry
+{
+   char name[SOUNDBANK_NAME_LEN]; // Path like on the SD card, e.g. "/buzzer/ding.wav"
+   uint32_t offset; // From the start of the bank
+   uint32_t length;
+};
+
+class SoundBank
+{
+private:
+   const uint8_t* base = nullptr;
+   const SoundBankEntry* entries = nullptr;
+   uint16_t count = 0;
+
+public:
+   /**
+    * \brief Map the sound bank partition into the address space
+    * \return true if a valid bank was found
+    */
+   bool begin();
+
+   /**
+    * \brief Look up a sound in the bank
+    * \param name Path of the sound like on the SD card
+    * \param length Length of the sound data
+    * \return Pointer to the mapped sound data or nullptr if the sound is not in the bank
+    */
+   const uint8_t* find(const char* name, uint32_t& length) const;
+};
+
+#endif //ESP32_BUZZER_SOUNDBANK_H
@@ -0,0 +1,152 @@
+/*
+ * RAM cache for whole sounds
+ */
+
+#include "soundCache.h"
+#include "storage/storage.h"
+
+static const char* TAG = "soundCache";
+
+void SoundCache::begin(const TrimIndex* trims)
+{
+   this->trims = trims;
+   mutex = xSemaphoreCreateMutex();
+}
+
+void SoundCache::request(const char* const filenames[], int count)
+{
+   xSemaphoreTake(mutex, portMAX_DELAY);
+   for (int i = 0; i < SOUND_CACHE_SLOTS; i++)
+   {
+      wanted[i][0] = '\0';
+      if (i < count && filenames[i]) strlcpy(wanted[i], filenames[i], SOUND_CACHE_NAME_LEN);
+   }
+   wantedGeneration.fetch_add(1, std::memory_order_release);
+   xSemaphoreGive(mutex);
+}
+
+/**
+ * \brief Free sounds that are not wanted anymore and put the wanted ones into the entries in their order
+ */
+void SoundCache::takeOverWanted()
+{
+   char names[SOUND_CACHE_SLOTS][SOUND_CACHE_NAME_LEN];
+   xSemaphoreTake(mutex, portMAX_DELAY);
+   memcpy(names, wanted, sizeof names);
+   entriesGeneration.store(wantedGeneration.load(std::memory_order_relaxed), std::memory_order_relaxed);
+   xSemaphoreGive(mutex);
+
+   Entry previous[SOUND_CACHE_SLOTS];
+   memcpy(previous, entries, sizeof entries);
+   memset(entries, 0, sizeof entries);
+
+   // Keep the data of sounds that are still wanted
+   for (int i = 0; i < SOUND_CACHE_SLOTS; i++)
+   {
+      strlcpy(entries[i].filename, names[i], SOUND_CACHE_NAME_LEN);
+      for (auto& prev: previous)
+      {
+         if (prev.data && names[i][0] != '\0' && strcmp(prev.filename, names[i]) == 0)
+         {
+            entries[i] = prev;
+            prev.data = nullptr;
+            break;
+         }
+      }
+   }
+
+   // Free what is not wanted anymore
+   for (auto& prev: previous)
+   {
+      if (!prev.data) continue;
+      usedBytes -= prev.size;
+      free(prev.data);
+   }
+}
+
+bool SoundCache::loadNext(const char* playing)
+{
+   if (hasNewWanted())
+   {
+      // Data of a cached sound must stay until it has finished playing
+      uint32_t size;
+      if (playing && find(playing, size)) return true;
+      takeOverWanted();
+   }
+
+   for (auto& entry: entries)
+   {
+      if (entry.tried || entry.filename[0] == '\0') continue;
+      entry.tried = true;
+
+      StorageFilePtr f = storage.open(entry.filename);
+      if (!f)
+      {
+         ESP_LOGW(TAG, "Failed to open %s", entry.filename);
+         return hasWork();
+      }
+      const SoundTrim* trim = trims ? trims->find(entry.filename) : nullptr;
+      uint32_t size = trimmedSize(trim, f->size());
+      if (usedBytes + size > SOUND_CACHE_BYTES)
+      {
+         ESP_LOGD(TAG, "%s does not fit (%u bytes, %u used)", entry.filename, size, usedBytes);
+         return hasWork();
+      }
+      entry.data = (uint8_t*)malloc(size);
+      if (!entry.data || readTrimmed(*f, trim, entry.data, size) != size)
+      {
+         ESP_LOGW(TAG, "Failed to load %s", entry.filename);
+         free(entry.data);
+         entry.data = nullptr;
+         return hasWork();
+      }
+      entry.size = size;
+      usedBytes += size;
+      ESP_LOGI(TAG, "Cached %s (%u bytes, %u of %u used)", entry.filename, size, usedBytes, SOUND_CACHE_BYTES);
+      return hasWork();
+   }
+   return false;
+}
+
+bool SoundCache::hasNewWanted() const
+{
+   return wantedGeneration.load(std::memory_order_acquire) != entriesGeneration.load(std::memory_order_relaxed);
+}
+
+bool SoundCache::hasWork() const
+{
+   if (hasNewWanted()) return true;
+   for (const auto& entry: entries)
+   {
+      if (!entry.tried && entry.filename[0] != '\0') return true;
+   }
+   return false;
+}
+
+const uint8_t* SoundCache::find(const char* filename, uint32_t& size) const
+{
+   for (const auto& entry: entries)
+   {
+      if (entry.data && strcmp(entry.filename, filename) == 0)
+      {
+         size = entry.size;
+         return entry.data;
+      }
+   }
+   return nullptr;
+}
+
+void SoundCache::invalidate(const char* path)
+{
+   for (auto& entry: entries)
+   {
+      if (entry.filename[0] == '\0' || !isInPath(entry.filename, path)) continue;
+      if (entry.data)
+      {
+         usedBytes -= entry.size;
+         free(entry.data);
+         entry.data = nullptr;
+      }
+      entry.tried = false;
+   }
+}
@@ -0,0 +1,78 @@
+/*
+ * RAM cache for whole sounds
+ * Holds the most played soundboard sounds (see playStats) completely in RAM. Like the prefetch cache, the set is
+ * given by the UI task and loaded by the playback task while it is idle. IMA-ADPCM files fit four times better.
+ */
+
+#ifndef ESP32_BUZZER_SOUNDCACHE_H
+#define ESP32_BUZZER_SOUNDCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <Arduino.h>
+#include "soundTrim.h"
+
+#define SOUND_CACHE_SLOTS 8
+#define SOUND_CACHE_BYTES (64 * 1024)
+#define SOUND_CACHE_NAME_LEN 128
+
+class SoundCache
+{
+private:
+   struct Entry
+   {
+      char filename[SOUND_CACHE_NAME_LEN];
+      uint8_t* data;
+      uint32_t size;
+      bool tried; // Loaded or failed/too large, don't try again
+   };
+
+   Entry entries[SOUND_CACHE_SLOTS]{};
+   uint32_t usedBytes = 0;
+   const TrimIndex* trims = nullptr;
+
+   // Set by the UI task, taken over by the playback task. The generations are compared without the mutex.
+   SemaphoreHandle_t mutex = nullptr;
+   char wanted[SOUND_CACHE_SLOTS][SOUND_CACHE_NAME_LEN]{};
+   std::atomic<uint32_t> wantedGeneration{ 0 };
+   std::atomic<uint32_t> entriesGeneration{ 0 };
+
+   bool hasNewWanted() const;
+   void takeOverWanted();
+
+public:
+   /**
+    * \param trims Trimmed sounds are cached without their silence
+    */
+   void begin(const TrimIndex* trims);
+
+   /**
+    * \brief Replace the set of cached sounds, most important first (UI task)
+    * \param filenames Filenames
+    * \param count Number of filenames (max SOUND_CACHE_SLOTS)
+    */
+   void request(const char* const filenames[], int count);
+
+   /**
+    * \brief Load the next wanted sound (playback task)
+    * \param playing Filename of the current playback, a new set is only taken over when it is not cached
+    * \return true if there is more to load
+    */
+   bool loadNext(const char* playing);
+
+   bool hasWork() const;
+
+   /**
+    * \brief Find a cached sound (playback task)
+    * \return Pointer to the file data (already trimmed) or nullptr if the sound is not cached
+    */
+   const uint8_t* find(const char* filename, uint32_t& size) const;
+
+   /**
+    * \brief Load sounds again whose files have changed (playback task, not while one of them is playing)
+    * \param path File or directory
+    */
+   void invalidate(const char* path);
+};
+
+#endif //ESP32_BUZZER_SOUNDCACHE_H
@@ -0,0 +1,152 @@
+/*
+ * Packed sound library on SD
+ */
+
+#include "soundPack.h"
+#include "filenameHash.h"
+#include <Arduino.h>
+#include <algorithm>
+
+static const char* TAG = "soundPack";
+
+/**
+ * \brief Open the pack and check its header
+ * \return Opened file or nullptr if the pack is missing or invalid
+ */
+static StorageFilePtr openPack(const char* path, SoundPackHeader& header)
+{
+   StorageFilePtr f = storage.open(path);
+   if (!f) return f;
+   if (f->read((uint8_t*)&header, sizeof header) != sizeof header || memcmp(header.magic, SOUND_PACK_MAGIC, 4) != 0 ||
+       header.version != SOUND_PACK_VERSION ||
+       header.dataStart < sizeof header + header.count * sizeof(SoundPackEntry))
+   {
+      ESP_LOGE(TAG, "%s is no valid sound pack", path);
+      f.reset();
+   }
+   return f;
+}
+
+bool SoundPack::begin(const char* packPath)
+{
+   entries.clear();
+   names.clear();
+   path = packPath;
+   SoundPackHeader header{};
+   StorageFilePtr f = openPack(packPath, header);
+   if (!f)
+   {
+      ESP_LOGI(TAG, "No sound pack, sounds are read from their directories");
+      return false;
+   }
+
+   uint32_t fileSize = f->size();
+   entries.reserve(header.count);
+   for (int i = 0; i < header.count; i++)
+   {
+      SoundPackEntry entry{};
+      if (f->read((uint8_t*)&entry, sizeof entry) != sizeof entry) break;
+      entry.name[SOUND_PACK_NAME_LEN - 1] = '\0';
+      if (entry.offset < header.dataStart || entry.offset + entry.length > fileSize)
+      {
+         ESP_LOGW(TAG, "%s is outside of the pack", entry.name);
+         continue;
+      }
+      entries.push_back({ hashFilename(entry.name), (uint32_t)names.size(), entry.offset, entry.length, false });
+      names.insert(names.end(), entry.name, entry.name + strlen(entry.name) + 1);
+   }
+   f.reset();
+
+   names.shrink_to_fit();
+   std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+   ESP_LOGI(TAG, "Sound pack %s with %d sounds (%u bytes)", packPath, (int)entries.size(), (unsigned)fileSize);
+   return isLoaded();
+}
+
+bool SoundPack::find(const char* filename, uint32_t& offset, uint32_t& length) const
+{
+   uint32_t h = hashFilename(filename);
+   auto it = std::lower_bound(entries.begin(), entries.end(), h,
+                              [](const Entry& e, uint32_t value) { return e.hash < value; });
+   // Names with the same hash are next to each other
+   for (; it != entries.end() && it->hash == h; ++it)
+   {
+      if (strcmp(&names[it->name], filename) != 0) continue;
+      if (it->removed) return false;
+      offset = it->offset;
+      length = it->length;
+      return true;
+   }
+   return false;
+}
+
+void SoundPack::remove(const char* path)
+{
+   // The entries are only marked, like the trims
+   for (auto& entry: entries)
+   {
+      if (!entry.removed && isInPath(&names[entry.name], path))
+      {
+         ESP_LOGI(TAG, "%s has changed, it is read from storage instead of the pack", &names[entry.name]);
+         entry.removed = true;
+      }
+   }
+}
+
+bool SoundPack::list(const char* prefix, std::vector<std::string>& filenames) const
+{
+   if (!isLoaded()) return false;
+   SoundPackHeader header{};
+   StorageFilePtr f = openPack(path.c_str(), header);
+   if (!f) return false;
+
+   size_t prefixLen = strlen(prefix);
+   for (int i = 0; i < header.count; i++)
+   {
+      SoundPackEntry entry{};
+      if (f->read((uint8_t*)&entry, sizeof entry) != sizeof entry) break;
+      entry.name[SOUND_PACK_NAME_LEN - 1] = '\0';
+      if (strncmp(entry.name, prefix, prefixLen) == 0) filenames.emplace_back(entry.name);
+   }
+   return true;
+}
+
+bool PackSource::open(const char* filename)
+{
+   opened = false;
+   if (!pack || !pack->find(filename, start, length)) return false;
+   if (!file) file = storage.open(pack->getPath());
+   if (!file || !file->seek(start)) return false;
+   pos = 0;
+   opened = true;
+   return true;
+}
+
+uint32_t PackSource::read(void* data, uint32_t len)
+{
+   if (!opened) return 0;
+   len = min(len, length - pos);
+   // Reads continue where the last one stopped, the SD card only needs a seek after seek()
+   if (file->position() != start + pos && !file->seek(start + pos)) return 0;
+   uint32_t n = file->read(static_cast<uint8_t*>(data), len);
+   pos += n;
+   return n;
+}
+
+bool PackSource::seek(int32_t newPos, int dir)
+{
+   if (!opened) return false;
+   int64_t target = newPos;
+   if (dir == SEEK_CUR) target += pos;
+   else if (dir == SEEK_END) target += length;
+   if (target < 0 || target > length) return false;
+   pos = (uint32_t)target;
+   return true;
+}
+
+bool PackSource::close()
+{
+   // The pack file stays open for the next sound
+   opened = false;
+   return true;
+}
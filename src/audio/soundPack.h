@@ -0,0 +1,113 @@
+/*
+ * Packed sound library on SD
+ * scripts/soundboard_pack.py puts all soundboard sounds into one file in the SD card root, with a table of contents
+ * in front. Playing a sound from it is a seek in an already opened file instead of opening a path through the FAT
+ * directories, which gets slower the more files there are. The pack is optional; if it exists, it replaces the
+ * soundboard directory (also for the soundboard pages). Files that are changed later (FTP) are removed from it, they
+ * are played from their directories then.
+ */
+
+#ifndef ESP32_BUZZER_SOUNDPACK_H
+#define ESP32_BUZZER_SOUNDPACK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AudioFileSource.h"
+#include "storage/storage.h"
+
+#define SOUND_PACK_FILE "/soundboard.pak"
+#define SOUND_PACK_MAGIC "SPAK"
+#define SOUND_PACK_VERSION 1
+#define SOUND_PACK_NAME_LEN 120
+
+// Layout on SD (little endian), keep in sync with scripts/soundboard_pack.py
+struct SoundPackHeader
+{
+   char magic[4];
+   uint16_t version;
+   uint16_t count;
+   uint32_t dataStart; // End of the table of contents
+} __attribute__((packed));
+
+struct SoundPackEntry
+{
+   char name[SOUND_PACK_NAME_LEN]; // Full path like on the SD card, e.g. "/soundboard/1_Foo/1_bar.wav"
+   uint32_t offset; // Sector (512 byte) aligned
+   uint32_t length;
+} __attribute__((packed));
+
+class SoundPack
+{
+private:
+   struct Entry
+   {
+      uint32_t hash;
+      uint32_t name; // Offset in names
+      uint32_t offset;
+      uint32_t length;
+      bool removed;
+   };
+   std::vector<Entry> entries; // Sorted by hash
+   std::vector<char> names; // Null-terminated names of the entries, to tell apart names with the same hash
+   std::string path;
+
+public:
+   /**
+    * \brief Read the table of contents of the pack, if there is one
+    * \return true if the pack can be used
+    */
+   bool begin(const char* path = SOUND_PACK_FILE);
+
+   bool isLoaded() const { return !entries.empty(); }
+
+   /**
+    * \brief Find a sound in the pack
+    * \param[out] offset Offset of the file in the pack
+    * \param[out] length Length of the file
+    * \return false if the sound is not in the pack
+    */
+   bool find(const char* filename, uint32_t& offset, uint32_t& length) const;
+
+   /**
+    * \brief Leave out sounds whose files have changed, they are read from storage from now on
+    * \param path File or directory
+    */
+   void remove(const char* path);
+
+   /**
+    * \brief List the sounds in the pack (reads the table of contents again, for its order)
+    * \param prefix Only names starting with this
+    * \param[out] filenames Names are appended
+    * \return false if there is no pack
+    */
+   bool list(const char* prefix, std::vector<std::string>& filenames) const;
+
+   const char* getPath() const { return path.c_str(); }
+};
+
+/**
+ * \brief Source for a file in the pack. The pack file stays open between sounds.
+ */
+class PackSource : public AudioFileSource
+{
+private:
+   const SoundPack* pack = nullptr;
+   StorageFilePtr file;
+   uint32_t start = 0;
+   uint32_t length = 0;
+   uint32_t pos = 0;
+   bool opened = false;
+
+public:
+   void setPack(const SoundPack* soundPack) { pack = soundPack; }
+   bool open(const char* filename) override;
+   uint32_t read(void* data, uint32_t len) override;
+   bool seek(int32_t pos, int dir) override;
+   bool close() override;
+   bool isOpen() override { return opened; }
+   uint32_t getSize() override { return length; }
+   uint32_t getPos() override { return pos; }
+};
+
+#endif //ESP32_BUZZER_SOUNDPACK_H
@@ -0,0 +1,174 @@
+/*
+ * Silence trimming of sounds
+ */
+
+#include "soundTrim.h"
+#include "filenameHash.h"
+#include <Arduino.h>
+#include <algorithm>
+
+static const char* TAG = "soundTrim";
+
+int TrimIndex::load(const char* path)
+{
+   entries.clear();
+   names.clear();
+   StorageFilePtr f = storage.open(path);
+   if (!f)
+   {
+      ESP_LOGI(TAG, "No trim index %s, sounds are played untrimmed", path);
+      return 0;
+   }
+   std::vector<char> text(f->size() + 1);
+   text.resize(f->read((uint8_t*)text.data(), f->size()) + 1);
+   text.back() = '\0';
+   f.reset();
+
+   char* savePtr;
+   for (char* line = strtok_r(text.data(), "\r\n", &savePtr); line; line = strtok_r(nullptr, "\r\n", &savePtr))
+   {
+      if (line[0] == '#') continue;
+
+      // Filename;dataStart;start;end
+      char* sep = strchr(line, ';');
+      if (!sep) continue;
+      *sep = '\0';
+      char* next;
+      SoundTrim trim{};
+      trim.dataStart = strtoul(sep + 1, &next, 10);
+      if (*next != ';') continue;
+      trim.start = strtoul(next + 1, &next, 10);
+      if (*next != ';') continue;
+      trim.end = strtoul(next + 1, &next, 10);
+      if (trim.start < trim.dataStart || trim.end <= trim.start)
+      {
+         ESP_LOGW(TAG, "Invalid trim for %s", line);
+         continue;
+      }
+      entries.push_back({ hashFilename(line), (uint32_t)names.size(), trim, false });
+      names.insert(names.end(), line, sep + 1);
+   }
+
+   names.shrink_to_fit();
+   std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+   ESP_LOGI(TAG, "Loaded trim index with %d sounds", (int)entries.size());
+   return (int)entries.size();
+}
+
+const SoundTrim* TrimIndex::find(const char* filename) const
+{
+   uint32_t h = hashFilename(filename);
+   auto it = std::lower_bound(entries.begin(), entries.end(), h,
+                              [](const Entry& e, uint32_t value) { return e.hash < value; });
+   // Names with the same hash are next to each other
+   for (; it != entries.end() && it->hash == h; ++it)
+   {
+      if (strcmp(&names[it->name], filename) == 0) return it->removed ? nullptr : &it->trim;
+   }
+   return nullptr;
+}
+
+void TrimIndex::remove(const char* path)
+{
+   // Files change rarely, a scan over all names also covers directories. The entries are only marked, they must
+   // not move while a trimmed sound is playing.
+   for (auto& entry: entries)
+   {
+      if (isInPath(&names[entry.name], path)) entry.removed = true;
+   }
+}
+
+uint32_t trimmedSize(const SoundTrim* trim, uint32_t fileSize)
+{
+   if (!trim) return fileSize;
+   return trim->dataStart + min(trim->end, fileSize) - min(trim->start, fileSize);
+}
+
+/**
+ * \brief Map a position in the trimmed file to the position in the whole file
+ * \param[out] segmentEnd End of the contiguous part of the trimmed file that pos is in
+ */
+static uint32_t toFilePos(const SoundTrim* trim, uint32_t pos, uint32_t size, uint32_t& segmentEnd)
+{
+   if (pos < trim->dataStart)
+   {
+      segmentEnd = trim->dataStart;
+      return pos;
+   }
+   segmentEnd = size;
+   return pos - trim->dataStart + trim->start;
+}
+
+uint32_t readTrimmed(StorageFile& file, const SoundTrim* trim, uint8_t* data, uint32_t len)
+{
+   if (!trim) return file.read(data, len);
+
+   uint32_t size = trimmedSize(trim, file.size());
+   uint32_t pos = 0;
+   while (pos < len && pos < size)
+   {
+      uint32_t segmentEnd;
+      uint32_t filePos = toFilePos(trim, pos, size, segmentEnd);
+      uint32_t n = min(len, segmentEnd) - pos;
+      if (!file.seek(filePos)) break;
+      uint32_t read = file.read(data + pos, n);
+      pos += read;
+      if (read < n) break;
+   }
+   return pos;
+}
+
+void TrimmedSource::wrap(AudioFileSource* source, const SoundTrim* trim)
+{
+   this->source = source;
+   this->trim = trim;
+   pos = 0;
+}
+
+bool TrimmedSource::open(const char* filename)
+{
+   pos = 0;
+   return source && source->open(filename);
+}
+
+uint32_t TrimmedSource::getSize()
+{
+   return source ? trimmedSize(trim, source->getSize()) : 0;
+}
+
+uint32_t TrimmedSource::read(void* data, uint32_t len)
+{
+   if (!isOpen()) return 0;
+   auto* dest = static_cast<uint8_t*>(data);
+   uint32_t size = getSize();
+   uint32_t done = 0;
+   while (done < len && pos < size)
+   {
+      uint32_t segmentEnd;
+      uint32_t filePos = toFilePos(trim, pos, size, segmentEnd);
+      uint32_t n = min(len - done, segmentEnd - pos);
+      if (source->getPos() != filePos && !source->seek((int32_t)filePos, SEEK_SET)) break;
+      uint32_t read = source->read(dest + done, n);
+      pos += read;
+      done += read;
+      if (read < n) break;
+   }
+   return done;
+}
+
+bool TrimmedSource::seek(int32_t newPos, int dir)
+{
+   if (!isOpen()) return false;
+   int64_t target = newPos;
+   if (dir == SEEK_CUR) target += pos;
+   else if (dir == SEEK_END) target += getSize();
+   if (target < 0 || target > getSize()) return false;
+   pos = (uint32_t)target;
+   return true;
+}
+
+bool TrimmedSource::close()
+{
+   pos = 0;
+   return source ? source->close() : true;
+}
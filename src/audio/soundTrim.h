@@ -0,0 +1,96 @@
+/*
+ * Silence trimming of sounds
+ * Many sounds start with some silence, which just adds latency. scripts/trim_silence.py finds where the audio
+ * starts (and optionally ends) and writes the offsets to a trim index on the SD card. Sounds with an entry there
+ * are played through TrimmedSource, which skips the silence but keeps the WAV header, so the generators don't
+ * notice anything.
+ */
+
+#ifndef ESP32_BUZZER_SOUNDTRIM_H
+#define ESP32_BUZZER_SOUNDTRIM_H
+
+#include <cstdint>
+#include <vector>
+#include "AudioFileSource.h"
+#include "storage/storage.h"
+
+#define SOUND_TRIM_INDEX "/trim.txt"
+
+// Byte offsets in the file, keep in sync with scripts/trim_silence.py
+struct SoundTrim
+{
+   uint32_t dataStart; // Start of the data chunk, everything before is header
+   uint32_t start; // First byte that is played (block aligned)
+   uint32_t end; // Byte after the last one that is played
+};
+
+class TrimIndex
+{
+private:
+   struct Entry
+   {
+      uint32_t hash;
+      uint32_t name; // Offset in names
+      SoundTrim trim;
+      bool removed;
+   };
+   std::vector<Entry> entries; // Sorted by hash
+   std::vector<char> names; // Null-terminated names of the entries, to tell apart names with the same hash
+
+public:
+   /**
+    * \brief Load the trim index, lines are "filename;dataStart;start;end"
+    * \return Number of trimmed sounds
+    */
+   int load(const char* path = SOUND_TRIM_INDEX);
+
+   /**
+    * \return Trim of the sound or nullptr if it is played as it is
+    */
+   const SoundTrim* find(const char* filename) const;
+
+   /**
+    * \brief Forget the trims of sounds whose files have changed, they are played untrimmed until the index is rebuilt
+    * \param path File or directory
+    */
+   void remove(const char* path);
+};
+
+/**
+ * \brief Size of a trimmed file: header plus the played part
+ */
+uint32_t trimmedSize(const SoundTrim* trim, uint32_t fileSize);
+
+/**
+ * \brief Read the start of the trimmed file (header plus played part) from an open file, for the caches
+ * \param trim Trim or nullptr to read the file as it is
+ * \return Number of bytes read
+ */
+uint32_t readTrimmed(StorageFile& file, const SoundTrim* trim, uint8_t* data, uint32_t len);
+
+/**
+ * \brief Source that presents a file as header plus the played part, leaving out the silence
+ */
+class TrimmedSource : public AudioFileSource
+{
+private:
+   AudioFileSource* source = nullptr;
+   const SoundTrim* trim = nullptr;
+   uint32_t pos = 0;
+
+public:
+   /**
+    * \param source Source of the whole file, may be opened later with open(filename)
+    * \param trim Trim of the file, not nullptr
+    */
+   void wrap(AudioFileSource* source, const SoundTrim* trim);
+   bool open(const char* filename) override;
+   uint32_t read(void* data, uint32_t len) override;
+   bool seek(int32_t pos, int dir) override;
+   bool close() override;
+   bool isOpen() override { return source && source->isOpen(); }
+   uint32_t getSize() override;
+   uint32_t getPos() override { return pos; }
+};
+
+#endif //ESP32_BUZZER_SOUNDTRIM_H
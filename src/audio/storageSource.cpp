@@ -0,0 +1,36 @@
+/*
+ * Audio source for files of the storage layer
+ */
+
+#include "storageSource.h"
+#include <Arduino.h>
+
+static const char* TAG = "storageSource";
+
+bool StorageSource::open(const char* filename)
+{
+   file = storage.open(filename);
+   if (!file) ESP_LOGE(TAG, "Failed to open %s", filename);
+   return file != nullptr;
+}
+
+uint32_t StorageSource::read(void* data, uint32_t len)
+{
+   return file ? file->read(static_cast<uint8_t*>(data), len) : 0;
+}
+
+bool StorageSource::seek(int32_t pos, int dir)
+{
+   if (!file) return false;
+   int64_t target = pos;
+   if (dir == SEEK_CUR) target += file->position();
+   else if (dir == SEEK_END) target += file->size();
+   if (target < 0) return false;
+   return file->seek((uint32_t)target);
+}
+
+bool StorageSource::close()
+{
+   file.reset();
+   return true;
+}
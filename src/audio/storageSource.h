@@ -0,0 +1,26 @@
+/*
+ * Audio source for files of the storage layer (SD, internal flash, RAM disk)
+ */
+
+#ifndef ESP32_BUZZER_STORAGESOURCE_H
+#define ESP32_BUZZER_STORAGESOURCE_H
+
+#include "AudioFileSource.h"
+#include "storage/storage.h"
+
+class StorageSource : public AudioFileSource
+{
+private:
+   StorageFilePtr file;
+
+public:
+   bool open(const char* filename) override;
+   uint32_t read(void* data, uint32_t len) override;
+   bool seek(int32_t pos, int dir) override;
+   bool close() override;
+   bool isOpen() override { return file != nullptr; }
+   uint32_t getSize() override { return file ? file->size() : 0; }
+   uint32_t getPos() override { return file ? file->position() : 0; }
+};
+
+#endif //ESP32_BUZZER_STORAGESOURCE_H
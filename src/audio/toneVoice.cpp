@@ -0,0 +1,66 @@
+/*
+ * Tone synthesizer voice
+ */
+
+#include "toneVoice.h"
+#include <Arduino.h>
+
+static int16_t sineTable[256];
+
+ToneVoice::ToneVoice(int sampleRate) : sampleRate(sampleRate)
+{
+   for (int i = 0; i < 256; i++)
+   {
+      sineTable[i] = (int16_t)(32767.0f * sinf(2.0f * (float)M_PI * (float)i / 256.0f));
+   }
+}
+
+bool ToneVoice::schedule(const Tone& tone, uint64_t start, uint8_t volume)
+{
+   if (!isActive()) cancel(); // All slots are free again
+   if (count == MAX_SCHEDULED || volume == 0) return false;
+
+   ScheduledTone& t = scheduled[count++];
+   t.start = start;
+   t.length = max((uint32_t)1, (uint32_t)tone.durationMs * sampleRate / 1000);
+   t.attack = (uint32_t)tone.attackMs * sampleRate / 1000;
+   t.release = (uint32_t)tone.releaseMs * sampleRate / 1000;
+   t.phaseStep = (uint32_t)(((uint64_t)tone.frequency << 32) / sampleRate);
+   t.gain = (int32_t)min((int)volume, 100) * 32767 / 100;
+   return true;
+}
+
+void ToneVoice::cancel()
+{
+   first = 0;
+   count = 0;
+}
+
+void ToneVoice::mix(int16_t sample[2], uint64_t clock)
+{
+   int32_t value = 0;
+   for (int i = first; i < count && scheduled[i].start <= clock; i++)
+   {
+      ScheduledTone& t = scheduled[i];
+      auto pos = (uint32_t)(clock - t.start);
+      if (pos >= t.length)
+      {
+         if (i == first) first++;
+         continue;
+      }
+
+      int32_t env = 32767;
+      if (pos < t.attack) env = (int32_t)((uint64_t)pos * 32767 / t.attack);
+      else if (t.length - pos < t.release) env = (int32_t)((uint64_t)(t.length - pos) * 32767 / t.release);
+
+      int32_t v = sineTable[(pos * t.phaseStep) >> 24];
+      value += (((v * env) >> 15) * t.gain) >> 15;
+   }
+   if (value == 0) return;
+
+   for (int c = 0; c < 2; c++)
+   {
+      int32_t mixed = sample[c] + value;
+      sample[c] = (int16_t)max(-32768, min(32767, (int)mixed));
+   }
+}
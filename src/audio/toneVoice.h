@@ -0,0 +1,66 @@
+/*
+ * Tone synthesizer voice
+ * Renders sine beeps with a linear attack/release envelope. Beeps are scheduled at absolute positions of the output
+ * sample clock and mixed into the samples on their way to I2S, so their spacing does not depend on loop timing and
+ * no sound file has to be read.
+ */
+
+#ifndef ESP32_BUZZER_TONEVOICE_H
+#define ESP32_BUZZER_TONEVOICE_H
+
+#include <cstdint>
+
+struct Tone
+{
+   uint16_t frequency; // Hz
+   uint16_t durationMs;
+   uint16_t attackMs;
+   uint16_t releaseMs;
+};
+
+class ToneVoice
+{
+private:
+   static constexpr int MAX_SCHEDULED = 24; // Longest answer time has 20 beeps + end tone
+
+   struct ScheduledTone
+   {
+      uint64_t start; // Sample clock
+      uint32_t length;
+      uint32_t attack;
+      uint32_t release;
+      uint32_t phaseStep; // Phase is derived from the position, so mixing the same position twice is harmless
+      int32_t gain; // Q15
+   };
+
+   int sampleRate;
+   ScheduledTone scheduled[MAX_SCHEDULED];
+   int first = 0; // First tone that is not finished yet, tones are sorted by start
+   int count = 0;
+
+public:
+   explicit ToneVoice(int sampleRate);
+
+   /**
+    * \brief Schedule a tone
+    * \param tone Tone parameters
+    * \param start Sample clock position where the tone starts, must not be before the previously scheduled tone
+    * \param volume Volume in percent
+    * \return false if there is no free slot
+    */
+   bool schedule(const Tone& tone, uint64_t start, uint8_t volume);
+
+   /**
+    * \brief Drop all tones, including one that is currently playing
+    */
+   void cancel();
+
+   bool isActive() const { return first < count; }
+
+   /**
+    * \brief Add the tones of one sample clock position to a stereo sample
+    */
+   void mix(int16_t sample[2], uint64_t clock);
+};
+
+#endif //ESP32_BUZZER_TONEVOICE_H
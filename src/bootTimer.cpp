@@ -0,0 +1,66 @@
+/*
+ * Boot phases
+ */
+
+#include "bootTimer.h"
+#include <esp_timer.h>
+
+static const char* TAG = "boot";
+BootTimer bootTimer;
+
+int BootTimer::begin(const char* name)
+{
+   int phase = phaseCount.fetch_add(1, std::memory_order_relaxed);
+   if (phase >= BOOT_PHASES)
+   {
+      ESP_LOGW(TAG, "Too many boot phases, %s is not timed", name);
+      return -1;
+   }
+   phases[phase].name = name;
+   phases[phase].task = pcTaskGetTaskName(xTaskGetCurrentTaskHandle());
+   phases[phase].startUs = esp_timer_get_time();
+   started[phase].store(true, std::memory_order_release);
+   return phase;
+}
+
+void BootTimer::end(int phase)
+{
+   if (phase < 0) return;
+   phases[phase].endUs.store(esp_timer_get_time(), std::memory_order_release);
+}
+
+void BootTimer::markBuzzersReady()
+{
+   buzzersReadyUs = esp_timer_get_time();
+}
+
+void BootTimer::report()
+{
+   ESP_LOGI(TAG, "Boot phases (start, duration in ms):");
+   for (int i = 0; i < min((int)phaseCount.load(std::memory_order_relaxed), BOOT_PHASES); i++)
+   {
+      if (!started[i].load(std::memory_order_acquire)) continue;
+      const BootPhase& phase = phases[i];
+      int64_t endUs = phase.endUs.load(std::memory_order_acquire);
+      if (endUs)
+      {
+         ESP_LOGI(TAG, "  %-12s %-14s %8.1f %8.1f", phase.name, phase.task, phase.startUs / 1000.0,
+                  (endUs - phase.startUs) / 1000.0);
+      }
+      else
+      {
+         ESP_LOGI(TAG, "  %-12s %-14s %8.1f  running", phase.name, phase.task, phase.startUs / 1000.0);
+      }
+   }
+   double readyMs = buzzersReadyUs / 1000.0;
+   if (readyMs <= BOOT_BUZZERS_READY_TARGET_MS)
+   {
+      ESP_LOGI(TAG, "Buzzers ready after %.1f ms (target %d ms), boot done after %.1f ms", readyMs,
+               BOOT_BUZZERS_READY_TARGET_MS, esp_timer_get_time() / 1000.0);
+   }
+   else
+   {
+      ESP_LOGW(TAG, "Buzzers ready after %.1f ms, slower than the target of %d ms", readyMs,
+               BOOT_BUZZERS_READY_TARGET_MS);
+   }
+}
@@ -0,0 +1,63 @@
+/*
+ * Boot phases
+ * The boot is split into phases that run where they are needed first: setup() only starts what the buzzers need
+ * (config, inputs and LEDs, the playback task and the displays), so the loop reads the buzzers right away. The SD card,
+ * the sound index and the soundboard are read by a boot task on the other core meanwhile, the playback task sets up
+ * I2S on its own, and the loop starts the logs and the FTP server once the card is there. Every phase is timed with
+ * esp_timer (since the start of the app) and reported on Serial when the boot is done, together with the time until
+ * the buzzers were ready and whether it met BOOT_BUZZERS_READY_TARGET_MS.
+ */
+
+#ifndef ESP32_BUZZER_BOOTTIMER_H
+#define ESP32_BUZZER_BOOTTIMER_H
+
+#include <atomic>
+#include <cstdint>
+#include <Arduino.h>
+
+#define BOOT_PHASES 16
+#define BOOT_BUZZERS_READY_TARGET_MS 250 // From the start of the app until the loop reads the buzzers
+
+struct BootPhase
+{
+   const char* name;
+   const char* task;
+   int64_t startUs; // esp_timer_get_time()
+   std::atomic<int64_t> endUs; // 0 while it runs
+};
+
+class BootTimer
+{
+private:
+   BootPhase phases[BOOT_PHASES]{};
+   std::atomic<int> phaseCount{ 0 };
+   std::atomic<bool> started[BOOT_PHASES]{}; // Slot is filled
+   int64_t buzzersReadyUs = 0;
+
+public:
+   /**
+    * \brief Start a phase, may be called from any task
+    * \param name Phase name, must stay valid (a literal)
+    * \return Handle for end(), -1 if there are more than BOOT_PHASES
+    */
+   int begin(const char* name);
+
+   /**
+    * \brief End a phase started with begin()
+    */
+   void end(int phase);
+
+   /**
+    * \brief Note the time when setup() is done and the loop takes over the buzzers
+    */
+   void markBuzzersReady();
+
+   /**
+    * \brief Log all phases (still running ones as such) and the time until the buzzers were ready
+    */
+   void report();
+};
+
+extern BootTimer bootTimer;
+
+#endif //ESP32_BUZZER_BOOTTIMER_H
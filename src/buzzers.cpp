@@ -0,0 +1,109 @@
+/*
+ * Buzzers of the teams
+ */
+
+#include "buzzers.h"
+#include "pins.h"
+#include <soc/soc.h>
+#include <soc/gpio_reg.h>
+
+static const char* TAG = "buzzers";
+static const BuzzerPins buzzerPins[] = BUZZER_TABLE;
+static constexpr int BUZZER_COUNT = sizeof buzzerPins / sizeof buzzerPins[0];
+static_assert(BUZZER_COUNT <= MAX_BUZZERS, "Too many buzzers in BUZZER_TABLE");
+
+BuzzerArbiter buzzers;
+
+static int bankOf(gpio_num_t pin)
+{
+   return pin < 32 ? 0 : 1;
+}
+
+static uint32_t bitOf(gpio_num_t pin)
+{
+   return 1u << (pin % 32);
+}
+
+void BuzzerArbiter::begin()
+{
+   for (const BuzzerPins& pins: buzzerPins)
+   {
+      pinMode(pins.input, INPUT);
+      pinMode(pins.led, OUTPUT);
+      inputBankMask[bankOf(pins.input)] |= bitOf(pins.input);
+      ledBankMask[bankOf(pins.led)] |= bitOf(pins.led);
+   }
+   setLeds(0);
+   ESP_LOGI(TAG, "%d buzzers, inputs in %s", BUZZER_COUNT,
+            inputBankMask[0] && inputBankMask[1] ? "both GPIO banks (two register reads)" : "one GPIO bank");
+}
+
+BuzzerMask BuzzerArbiter::readPressed() const
+{
+   uint32_t levels[2] = { 0, 0 };
+   if (inputBankMask[0]) levels[0] = REG_READ(GPIO_IN_REG);
+   if (inputBankMask[1]) levels[1] = REG_READ(GPIO_IN1_REG);
+
+   BuzzerMask pressed = 0;
+   for (int i = 0; i < BUZZER_COUNT; i++)
+   {
+      gpio_num_t input = buzzerPins[i].input;
+      if (!(levels[bankOf(input)] & bitOf(input))) pressed |= (BuzzerMask)(1u << i);
+   }
+   return pressed;
+}
+
+void BuzzerArbiter::setLeds(BuzzerMask on)
+{
+   uint32_t set[2] = { 0, 0 };
+   for (int i = 0; i < BUZZER_COUNT; i++)
+   {
+      if (on & (1u << i)) set[bankOf(buzzerPins[i].led)] |= bitOf(buzzerPins[i].led);
+   }
+   // Only the LED pins are touched, the set and clear registers leave the other outputs alone
+   if (ledBankMask[0])
+   {
+      REG_WRITE(GPIO_OUT_W1TC_REG, ledBankMask[0] & ~set[0]);
+      REG_WRITE(GPIO_OUT_W1TS_REG, set[0]);
+   }
+   if (ledBankMask[1])
+   {
+      REG_WRITE(GPIO_OUT1_W1TC_REG, ledBankMask[1] & ~set[1]);
+      REG_WRITE(GPIO_OUT1_W1TS_REG, set[1]);
+   }
+   leds = on;
+}
+
+int BuzzerArbiter::update(BuzzerMask pressed, uint32_t timeUs)
+{
+   BuzzerMask newPresses = pressed & ~ranked;
+   if (!newPresses) return 0;
+   bool tie = (newPresses & (newPresses - 1)) != 0;
+   int added = 0;
+   for (int n = 0; n < BUZZER_COUNT; n++)
+   {
+      int i = (tieBreakStart + n) % BUZZER_COUNT;
+      if (!(newPresses & (1u << i))) continue;
+      ranking[rankingCount++] = { (uint8_t)i, timeUs };
+      added++;
+   }
+   if (tie) tieBreakStart = (uint8_t)((tieBreakStart + 1) % BUZZER_COUNT);
+   ranked |= newPresses;
+   return added;
+}
+
+void BuzzerArbiter::reset()
+{
+   rankingCount = 0;
+   ranked = 0;
+}
+
+int BuzzerArbiter::getCount()
+{
+   return BUZZER_COUNT;
+}
+
+const char* BuzzerArbiter::getName(int buzzer)
+{
+   return buzzer >= 0 && buzzer < BUZZER_COUNT ? buzzerPins[buzzer].name : "?";
+}
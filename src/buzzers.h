@@ -0,0 +1,93 @@
+/*
+ * Buzzers of the teams
+ * The buzzers are described by a table (BUZZER_TABLE in pins.h): input, LED and team name, in the order of the team
+ * numbers. All inputs are sampled at once with one read of the GPIO input register (two if they are spread over
+ * both banks, GPIO 0-31 and 32-39), all LEDs are switched at once with the set/clear registers. So presses in the
+ * same sample are really simultaneous, and the arbitration does not depend on the order of the pins.
+ * The arbitration ranks every team by its first press, with the time, until it is reset: if the first team answers
+ * wrong, the next one is known already.
+ */
+
+#ifndef ESP32_BUZZER_BUZZERS_H
+#define ESP32_BUZZER_BUZZERS_H
+
+#include <cstdint>
+#include <Arduino.h>
+
+// Every buzzer takes an input and an LED pin, more do not fit on the free GPIOs anyway
+#define MAX_BUZZERS 16
+
+typedef uint16_t BuzzerMask; // Bit n = buzzer n
+
+struct BuzzerPins
+{
+   gpio_num_t input; // Active low
+   gpio_num_t led;
+   const char* name;
+};
+
+struct BuzzerPress
+{
+   uint8_t buzzer;
+   uint32_t timeUs; // micros() of the sample the press was first seen in
+};
+
+class BuzzerArbiter
+{
+private:
+   uint32_t inputBankMask[2]{}; // GPIO 0-31, 32-39
+   uint32_t ledBankMask[2]{};
+   BuzzerMask leds = 0;
+
+   BuzzerPress ranking[MAX_BUZZERS]{};
+   int rankingCount = 0;
+   BuzzerMask ranked = 0;
+   uint8_t tieBreakStart = 0; // Buzzer that wins the next tie, moves on with every tie
+
+public:
+   /**
+    * \brief Set up the pins of the buzzer table
+    */
+   void begin();
+
+   /**
+    * \brief Sample all buzzer inputs at once
+    * \return Pressed buzzers
+    */
+   BuzzerMask readPressed() const;
+
+   /**
+    * \brief Switch the LEDs of the given buzzers on and all others off, in one write per bank
+    */
+   void setLeds(BuzzerMask on);
+   BuzzerMask getLeds() const { return leds; }
+
+   /**
+    * \brief Rank the buzzers that are pressed and were not ranked yet
+    * Presses in the same sample have the same time, they are ranked in turn starting at a buzzer that moves on
+    * with every tie, so no team is favoured.
+    * \param pressed Pressed buzzers of the sample
+    * \param timeUs micros() of the sample
+    * \return Number of buzzers ranked now
+    */
+   int update(BuzzerMask pressed, uint32_t timeUs);
+
+   /**
+    * \brief Clear the ranking for the next question
+    */
+   void reset();
+
+   int getRankingCount() const { return rankingCount; }
+
+   /**
+    * \brief Buzzer at a place of the ranking, 0 is the first one
+    */
+   const BuzzerPress& getRanking(int place) const { return ranking[place]; }
+
+   static int getCount();
+   static const char* getName(int buzzer);
+};
+
+extern BuzzerArbiter buzzers;
+
+#endif //ESP32_BUZZER_BUZZERS_H
@@ -17,6 +17,8 @@ const ConfigDefinition configDef[CFG_COUNT] = {
    { .value = CFG_SOUND_RANDOM_VOLUME, .type = CFG_TYPE_INT, .key = "rs-vol", .defaultValue = 100, .min = 0, .max = 100, .unit = "%", .name = "RandSnd vol" },
    { .value = CFG_SOUND_RANDOM_ENABLE, .type = CFG_TYPE_BOOL, .key = "rs-en", .defaultValue = 1, .min = 0, .max = 1, .unit = "", .name = "RandSnd en" },
    { .value = CFG_SOUND_RANDOM_SELECTION, .type = CFG_TYPE_INT, .key = "rs-select", .defaultValue = 0, .min = 0, .max = SOUNDS_RANDOM_COUNT - 1, .unit = "", .name = "RandSnd select" },
+   { .value = CFG_INPUT_TRACE, .type = CFG_TYPE_BOOL, .key = "input-trace", .defaultValue = 0, .min = 0, .max = 1, .unit = "", .name = "Input trace" },
+   { .value = CFG_GAME_LOG, .type = CFG_TYPE_BOOL, .key = "game-log", .defaultValue = 1, .min = 0, .max = 1, .unit = "", .name = "Game log" },
 };
 
 
@@ -8,6 +8,7 @@
 
 #include <cstdint>
 #include <Arduino.h>
+#include "gameLog.h"
 
 enum ConfigValue
 {
@@ -21,6 +22,8 @@ enum ConfigValue
    CFG_SOUND_RANDOM_VOLUME,
    CFG_SOUND_RANDOM_ENABLE,
    CFG_SOUND_RANDOM_SELECTION,
+   CFG_INPUT_TRACE,
+   CFG_GAME_LOG,
    CFG_COUNT
 };
 
@@ -62,6 +65,7 @@ public:
       {
          valuesChanged[cfg] = true;
          values[cfg] = max(min(configDef[cfg].max, value), configDef[cfg].min);
+         gameLog.add(GAME_EVENT_CONFIG, (uint8_t)cfg, 0, (uint32_t)values[cfg]);
          save();
       }
    }
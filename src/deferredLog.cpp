@@ -0,0 +1,244 @@
+/*
+ * Deferred logging
+ */
+
+#include "deferredLog.h"
+#include "resourceMonitor.h"
+#include <Arduino.h>
+#include <cstring>
+
+static const char* TAG = "deferredLog";
+DeferredLog deferredLog;
+
+DeferredLog::Ring::Ring()
+{
+   for (uint32_t i = 0; i < DEFERRED_LOG_RING_RECORDS; i++) records[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+DeferredLogRecord* DeferredLog::reserve()
+{
+   Ring& ring = rings[xPortGetCoreID() % DEFERRED_LOG_CORES];
+   uint32_t pos = ring.addPos.load(std::memory_order_relaxed);
+   while (true)
+   {
+      DeferredLogRecord& rec = ring.records[pos % DEFERRED_LOG_RING_RECORDS];
+      auto diff = (int32_t)(rec.sequence.load(std::memory_order_acquire) - pos);
+      if (diff == 0)
+      {
+         if (ring.addPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return &rec;
+      }
+      else if (diff < 0)
+      {
+         // The formatter has not taken out the record of the previous round yet
+         dropped.fetch_add(1, std::memory_order_relaxed);
+         return nullptr;
+      }
+      else
+      {
+         pos = ring.addPos.load(std::memory_order_relaxed);
+      }
+   }
+}
+
+void DeferredLog::commit(DeferredLogRecord* rec)
+{
+   rec->sequence.store(rec->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void DeferredLog::storeString(DeferredLogRecord& rec, DeferredLogValue& value, size_t& stringPos, const char* s)
+{
+   if (!s) s = "(null)";
+   // Without space left it is an empty string at the end
+   size_t pos = min(stringPos, (size_t)DEFERRED_LOG_STRINGS_LEN - 1);
+   size_t len = min(strlen(s), DEFERRED_LOG_STRINGS_LEN - 1 - pos);
+   memcpy(&rec.strings[pos], s, len);
+   rec.strings[pos + len] = '\0';
+   value.i = (int64_t)pos;
+   stringPos = pos + len + 1;
+}
+
+void DeferredLog::format(const DeferredLogRecord& rec, char* out, size_t size)
+{
+   size_t len = 0;
+   int arg = 0;
+   const char* f = rec.format;
+   while (*f && len < size - 1)
+   {
+      if (*f != '%' || f[1] == '%')
+      {
+         out[len++] = *f;
+         f += *f == '%' ? 2 : 1;
+         continue;
+      }
+
+      // Flags, width and precision are kept, the length modifier is replaced by the one of the stored value
+      char spec[16];
+      size_t specLen = 0;
+      spec[specLen++] = *f++;
+      while (*f && strchr("-+ #0123456789.", *f) && specLen < sizeof spec - 4) spec[specLen++] = *f++;
+      int longs = 0, shorts = 0;
+      for (; *f && strchr("hlLqjzt", *f); f++)
+      {
+         if (*f == 'h') shorts++;
+         else if (*f != 'z' && *f != 't') longs++;
+      }
+      char conversion = *f;
+      if (!conversion) break;
+      f++;
+      DeferredLogValue value{};
+      if (arg < rec.argCount) value = rec.args[arg++];
+      // The value is cut to the size the format says, like the varargs of printf would be
+      bool is64 = longs >= 2 || (longs == 1 && sizeof(long) == 8);
+
+      int n = 0;
+      char* end = out + len;
+      size_t left = size - len;
+      switch (conversion)
+      {
+         case 'd':
+         case 'i':
+         {
+            auto v = (long long)value.i;
+            if (shorts == 1) v = (int16_t)v;
+            else if (shorts >= 2) v = (int8_t)v;
+            else if (!is64) v = (int32_t)v;
+            memcpy(&spec[specLen], "lld", 4);
+            n = snprintf(end, left, spec, v);
+            break;
+         }
+         case 'u':
+         case 'x':
+         case 'X':
+         case 'o':
+         {
+            auto v = (unsigned long long)value.i;
+            if (shorts == 1) v = (uint16_t)v;
+            else if (shorts >= 2) v = (uint8_t)v;
+            else if (!is64) v = (uint32_t)v;
+            spec[specLen++] = 'l';
+            spec[specLen++] = 'l';
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            n = snprintf(end, left, spec, v);
+            break;
+         }
+         case 'c':
+            memcpy(&spec[specLen], "c", 2);
+            n = snprintf(end, left, spec, (int)value.i);
+            break;
+         case 'f':
+         case 'F':
+         case 'e':
+         case 'E':
+         case 'g':
+         case 'G':
+         case 'a':
+         case 'A':
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            n = snprintf(end, left, spec, value.d);
+            break;
+         case 's':
+            memcpy(&spec[specLen], "s", 2);
+            n = snprintf(end, left, spec, rec.strings + min(value.i, (int64_t)DEFERRED_LOG_STRINGS_LEN - 1));
+            break;
+         case 'p':
+            memcpy(&spec[specLen], "p", 2);
+            n = snprintf(end, left, spec, (void*)(uintptr_t)value.i);
+            break;
+         default:
+            n = snprintf(end, left, "%%%c", conversion);
+            break;
+      }
+      if (n > 0) len = min(len + n, size - 1);
+   }
+   out[len] = '\0';
+}
+
+#if defined(CONFIG_ARDUHAL_ESP_LOG) && !defined(USE_ESP_IDF_LOG)
+// ARDUHAL_LOG_FORMAT appends the time and the place where it is used, they are replaced by those of the record
+static void writeArduinoLine(const DeferredLogRecord& rec, const char* text, const char* format, unsigned long,
+                             const char*, int, const char*)
+{
+   log_printf(format, (unsigned long)rec.timeMs, pathToFileName(rec.file), rec.line, rec.function, text);
+}
+#define DEFERRED_LOG_ARDUINO_LINE(letter) writeArduinoLine(rec, text, ARDUHAL_LOG_FORMAT(letter, "%s"))
+#endif
+
+void DeferredLog::writeLine(const DeferredLogRecord& rec, const char* text)
+{
+   auto level = (esp_log_level_t)rec.level;
+#if defined(CONFIG_ARDUHAL_ESP_LOG) && !defined(USE_ESP_IDF_LOG)
+   // ESP_LOGx are log_x of the Arduino core here, the lines look the same
+   switch (level)
+   {
+      case ESP_LOG_ERROR: DEFERRED_LOG_ARDUINO_LINE(E); break;
+      case ESP_LOG_WARN: DEFERRED_LOG_ARDUINO_LINE(W); break;
+      case ESP_LOG_INFO: DEFERRED_LOG_ARDUINO_LINE(I); break;
+      case ESP_LOG_DEBUG: DEFERRED_LOG_ARDUINO_LINE(D); break;
+      default: DEFERRED_LOG_ARDUINO_LINE(V); break;
+   }
+#else
+   static const char letters[] = "NEWIDV";
+   esp_log_write(level, rec.tag, "%c (%u) %s: %s\n", letters[level], (unsigned)rec.timeMs, rec.tag, text);
+#endif
+}
+
+bool DeferredLog::writeNext()
+{
+   // The oldest of the first records of the rings, so the cores' messages come out in order
+   Ring* next = nullptr;
+   for (Ring& ring: rings)
+   {
+      DeferredLogRecord& rec = ring.records[ring.takePos % DEFERRED_LOG_RING_RECORDS];
+      if (rec.sequence.load(std::memory_order_acquire) != ring.takePos + 1) continue;
+      if (!next || (int32_t)(rec.timeMs - next->records[next->takePos % DEFERRED_LOG_RING_RECORDS].timeMs) < 0)
+      {
+         next = &ring;
+      }
+   }
+   if (!next) return false;
+
+   DeferredLogRecord& rec = next->records[next->takePos % DEFERRED_LOG_RING_RECORDS];
+   char text[DEFERRED_LOG_LINE_LEN];
+   format(rec, text, sizeof text);
+   writeLine(rec, text);
+   rec.sequence.store(next->takePos + DEFERRED_LOG_RING_RECORDS, std::memory_order_release);
+   next->takePos++;
+   return true;
+}
+
+void DeferredLog::begin()
+{
+#if DEFERRED_LOG
+   // Lowest priority on the core of the playback, it only runs when the real-time tasks wait
+   TaskHandle_t task = nullptr;
+   ownTask = xTaskCreatePinnedToCore(formatterTask, "LogTask", DEFERRED_LOG_TASK_STACK, this, 1, &task, 0) == pdPASS;
+   if (ownTask) resourceMonitor.addTask(task, DEFERRED_LOG_TASK_STACK);
+   else ESP_LOGW(TAG, "No formatter task, deferred messages are written from the loop");
+#endif
+}
+
+void DeferredLog::writePending()
+{
+   while (writeNext());
+   uint32_t count = dropped.exchange(0, std::memory_order_relaxed);
+   if (count) ESP_LOGW(TAG, "%u messages dropped, the ring of a core was full", (unsigned)count);
+}
+
+void DeferredLog::loop()
+{
+#if DEFERRED_LOG
+   if (!ownTask) writePending();
+#endif
+}
+
+[[noreturn]] void DeferredLog::formatterTask(void* param)
+{
+   auto* self = static_cast<DeferredLog*>(param);
+   while (true)
+   {
+      self->writePending();
+      delay(DEFERRED_LOG_POLL_MS);
+   }
+}
@@ -0,0 +1,177 @@
+/*
+ * Deferred logging
+ * DLOGI/DLOGD take the place of ESP_LOGI/ESP_LOGD on the real-time paths (playback task, input handling, buzzer
+ * logic). With DEFERRED_LOG=1 they don't format anything: the format string (its address is its ID, it stays in
+ * flash), the time and the raw arguments are copied into a lock-free ring of the calling core, strings into the
+ * record. A low priority task formats them later and writes them in the line format of ESP_LOGx (the log_x format of
+ * the Arduino core on the target, the ESP-IDF one in the simulation), with the time and the place of the call.
+ * Without DEFERRED_LOG they are plain ESP_LOGx. Messages are dropped (and counted) if a ring is full.
+ */
+
+#ifndef ESP32_BUZZER_DEFERREDLOG_H
+#define ESP32_BUZZER_DEFERREDLOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <esp_log.h>
+
+#ifndef DEFERRED_LOG
+#define DEFERRED_LOG 0
+#endif
+
+#ifdef CORE_DEBUG_LEVEL
+#define DEFERRED_LOG_LEVEL CORE_DEBUG_LEVEL // Like ESP_LOGx, messages above the level are not compiled in
+#else
+#define DEFERRED_LOG_LEVEL ESP_LOG_VERBOSE
+#endif
+
+#define DEFERRED_LOG_CORES 2
+#define DEFERRED_LOG_RING_RECORDS 32 // Per core, power of two
+#define DEFERRED_LOG_MAX_ARGS 6
+#define DEFERRED_LOG_STRINGS_LEN 48 // All string arguments of a message together, longer ones are cut off
+#define DEFERRED_LOG_LINE_LEN 192
+#define DEFERRED_LOG_POLL_MS 20
+#define DEFERRED_LOG_TASK_STACK 3072 // Bytes, formats one line on the stack
+
+#if DEFERRED_LOG
+// Never called, lets the compiler check the arguments against the format
+static inline void deferredLogCheckFormat(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static inline void deferredLogCheckFormat(const char* format, ...) {}
+
+#define DLOG_LEVEL(level, tag, format, ...) do { \
+      if (0) deferredLogCheckFormat(format, ##__VA_ARGS__); \
+      if ((level) <= DEFERRED_LOG_LEVEL) deferredLog.add(level, tag, __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__); \
+   } while (0)
+#define DLOGI(tag, format, ...) DLOG_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define DLOGD(tag, format, ...) DLOG_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#define DLOGI(tag, format, ...) ESP_LOGI(tag, format, ##__VA_ARGS__)
+#define DLOGD(tag, format, ...) ESP_LOGD(tag, format, ##__VA_ARGS__)
+#endif
+
+union DeferredLogValue
+{
+   int64_t i; // Integers, pointers, offset of a string in DeferredLogRecord::strings
+   double d;
+};
+
+struct DeferredLogRecord
+{
+   std::atomic<uint32_t> sequence; // Ring position it is free for, +1 when it is filled
+   uint32_t timeMs;
+   const char* tag;
+   const char* file; // Place of the call, for the Arduino line format
+   const char* function;
+   uint16_t line;
+   const char* format;
+   uint8_t level;
+   uint8_t argCount;
+   DeferredLogValue args[DEFERRED_LOG_MAX_ARGS];
+   char strings[DEFERRED_LOG_STRINGS_LEN];
+};
+
+class DeferredLog
+{
+private:
+   // Bounded queue after D. Vyukov: any task of the core can add (compare and swap on the position), only the
+   // formatter takes out
+   struct Ring
+   {
+      DeferredLogRecord records[DEFERRED_LOG_RING_RECORDS];
+      std::atomic<uint32_t> addPos{ 0 };
+      uint32_t takePos = 0;
+
+      Ring();
+   };
+
+   Ring rings[DEFERRED_LOG_CORES];
+   std::atomic<uint32_t> dropped{ 0 };
+   bool ownTask = false;
+
+   DeferredLogRecord* reserve();
+   static void commit(DeferredLogRecord* rec);
+
+   static void storeString(DeferredLogRecord& rec, DeferredLogValue& value, size_t& stringPos, const char* s);
+   static void store(DeferredLogRecord& rec, DeferredLogValue& value, size_t& stringPos, const char* s)
+   {
+      storeString(rec, value, stringPos, s);
+   }
+   static void store(DeferredLogRecord& rec, DeferredLogValue& value, size_t& stringPos, char* s)
+   {
+      storeString(rec, value, stringPos, s);
+   }
+   template<typename T>
+   static void store(DeferredLogRecord& rec, DeferredLogValue& value, size_t& stringPos, const T* p)
+   {
+      value.i = (int64_t)(uintptr_t)p;
+   }
+   template<typename T>
+   static typename std::enable_if<std::is_floating_point<T>::value>::type
+   store(DeferredLogRecord& rec, DeferredLogValue& value, size_t& stringPos, T v)
+   {
+      value.d = v;
+   }
+   template<typename T>
+   static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+   store(DeferredLogRecord& rec, DeferredLogValue& value, size_t& stringPos, T v)
+   {
+      value.i = (int64_t)v;
+   }
+
+   static void put(DeferredLogRecord& rec, size_t& stringPos)
+   {
+   }
+   template<typename T, typename... Rest>
+   static void put(DeferredLogRecord& rec, size_t& stringPos, T value, Rest... rest)
+   {
+      store(rec, rec.args[rec.argCount++], stringPos, value);
+      put(rec, stringPos, rest...);
+   }
+
+   static void format(const DeferredLogRecord& rec, char* out, size_t size);
+   static void writeLine(const DeferredLogRecord& rec, const char* text);
+   bool writeNext();
+   void writePending();
+
+   [[noreturn]] static void formatterTask(void* param);
+
+public:
+   /**
+    * \brief Start the formatter task, call before anything is logged
+    */
+   void begin();
+
+   /**
+    * \brief Writes the messages if the formatter task could not be started, call once per loop
+    */
+   void loop();
+
+   /**
+    * \brief Copy a message into the ring of the calling core, use DLOGI/DLOGD
+    */
+   template<typename... Args>
+   void add(esp_log_level_t level, const char* tag, const char* file, int line, const char* function,
+            const char* format, Args... args)
+   {
+      static_assert(sizeof...(Args) <= DEFERRED_LOG_MAX_ARGS, "Too many arguments for a deferred log message");
+      DeferredLogRecord* rec = reserve();
+      if (!rec) return;
+      rec->timeMs = esp_log_timestamp();
+      rec->tag = tag;
+      rec->file = file;
+      rec->function = function;
+      rec->line = (uint16_t)line;
+      rec->format = format;
+      rec->level = (uint8_t)level;
+      rec->argCount = 0;
+      size_t stringPos = 0;
+      put(*rec, stringPos, args...);
+      commit(rec);
+   }
+};
+
+extern DeferredLog deferredLog;
+
+#endif //ESP32_BUZZER_DEFERREDLOG_H
@@ -0,0 +1,133 @@
+/*
+ * Binary game event log
+ */
+
+#include "gameLog.h"
+#include "config.h"
+#include "audio/filenameHash.h"
+#include "storage/busArbiter.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <cstring>
+
+static const char* TAG = "gameLog";
+GameLog gameLog;
+
+bool GameLog::push(uint8_t type, uint8_t arg8, uint16_t arg16, uint32_t arg32)
+{
+   GameLogRecord* rec = ring.reserve();
+   if (!rec) return false;
+   rec->timeUs = (uint64_t)esp_timer_get_time();
+   rec->type = type;
+   rec->arg8 = arg8;
+   rec->arg16 = arg16;
+   rec->arg32 = arg32;
+   ring.commit();
+   return true;
+}
+
+void GameLog::addSound(const char* filename, int prio, uint8_t volume, bool accepted, bool playlist)
+{
+   if (!active) return;
+   uint16_t flags = (accepted ? 0 : GAME_LOG_SOUND_DROPPED) | (playlist ? GAME_LOG_SOUND_PLAYLIST : 0);
+   add(GAME_EVENT_SOUND, (uint8_t)prio, (uint16_t)(volume | flags), hashFilename(filename));
+}
+
+void GameLog::begin(fs::FS& fs)
+{
+   if (!config.getValue(CFG_GAME_LOG)) return;
+
+   fs.mkdir(GAME_LOG_DIR);
+   char path[32];
+   int index = 0;
+   for (; index < GAME_LOG_MAX_FILES; index++)
+   {
+      snprintf(path, sizeof path, GAME_LOG_DIR "/game_%03d.bin", index);
+      if (!fs.exists(path)) break;
+   }
+   if (index == GAME_LOG_MAX_FILES)
+   {
+      ESP_LOGE(TAG, "No free log file name in %s", GAME_LOG_DIR);
+      return;
+   }
+   file = fs.open(path, "w", true);
+   if (!file)
+   {
+      ESP_LOGE(TAG, "Failed to create %s", path);
+      return;
+   }
+   ESP_LOGI(TAG, "Logging the game to %s", path);
+
+   // The file has no header, its first record tells what it is
+   active = true;
+   add(GAME_EVENT_START, 0, GAME_LOG_VERSION, GAME_LOG_MAGIC);
+
+   auto write = [](void* param)
+   {
+      auto* self = static_cast<GameLog*>(param);
+      self->writePending(self->flushRequested.exchange(false));
+   };
+   if (!writer.start("GameLogTask", GAME_LOG_TASK_STACK, GAME_LOG_POLL_MS, write, this))
+   {
+      ESP_LOGW(TAG, "No writer task, the log is written from the loop");
+   }
+}
+
+void GameLog::loop()
+{
+   if (active && !writer.isRunning()) writePending(flushRequested.exchange(false));
+}
+
+void GameLog::flush()
+{
+   if (!active) return;
+   if (writer.isRunning()) flushRequested = true;
+   else writePending(true);
+}
+
+void GameLog::writePending(bool force)
+{
+   while (active)
+   {
+      uint32_t pending = ring.getPending();
+      if (pending == 0) return;
+
+      // Full batches wait while a sound is playing, unless the ring fills up. Events don't wait longer than the
+      // maximum delay in any case.
+      bool overdue = (uint64_t)esp_timer_get_time() - ring.front().timeUs >= GAME_LOG_MAX_DELAY_MS * 1000ULL;
+      if (!force && !overdue)
+      {
+         if (pending < BATCH_RECORDS) return;
+         if (sdBus.isPlaying() && pending < GAME_LOG_RING_RECORDS / 2) return;
+      }
+      if (!writeBatch(pending < BATCH_RECORDS ? pending : BATCH_RECORDS)) return;
+   }
+}
+
+bool GameLog::writeBatch(uint32_t count)
+{
+   for (uint32_t copied = 0; copied < count;)
+   {
+      uint32_t n = count - copied;
+      const GameLogRecord* records = ring.peek(n);
+      memcpy(&batch[copied], records, n * sizeof(GameLogRecord));
+      ring.consume(n);
+      copied += n;
+   }
+
+   // Padding keeps every write on sector boundaries, the file always ends with a whole sector
+   uint32_t padded = (count + SECTOR_RECORDS - 1) / SECTOR_RECORDS * SECTOR_RECORDS;
+   memset(&batch[count], 0, (padded - count) * sizeof(GameLogRecord));
+   size_t size = padded * sizeof(GameLogRecord);
+   if (file.write((const uint8_t*)batch, size) != size)
+   {
+      ESP_LOGE(TAG, "Failed to write the game log after %u bytes, logging stopped", writtenBytes);
+      active = false;
+      file.close();
+      return false;
+   }
+   // Flushing every batch keeps the log readable if the power is cut
+   file.flush();
+   writtenBytes += size;
+   return true;
+}
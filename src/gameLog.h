@@ -0,0 +1,117 @@
+/*
+ * Binary game event log
+ * Buzzer presses, winners, timeouts, sound requests and config changes are logged as fixed 16 byte records. Logging
+ * only copies the record into a RAM ring buffer, so it can be called from the hot paths of the loop. A background
+ * task appends the ring to a file on the SD card in sector-aligned batches (whole 512 byte sectors), and holds them
+ * back while a sound is playing so the playback keeps the bus. One file per boot, scripts/game_log_to_csv.py turns
+ * it into CSV.
+ */
+
+#ifndef ESP32_BUZZER_GAMELOG_H
+#define ESP32_BUZZER_GAMELOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <FS.h>
+#include "recordRing.h"
+
+#define GAME_LOG_DIR "/logs"
+#define GAME_LOG_MAGIC 0x474f4c47 // "GLOG"
+#define GAME_LOG_VERSION 1
+#define GAME_LOG_MAX_FILES 1000
+#define GAME_LOG_SECTOR_SIZE 512
+#define GAME_LOG_RING_RECORDS 256 // 4kB, power of two
+#define GAME_LOG_BATCH_SECTORS 4 // Largest single write
+#define GAME_LOG_MAX_DELAY_MS 10000 // A partial batch is written (padded to a sector) this long after its first event
+#define GAME_LOG_POLL_MS 200
+#define GAME_LOG_TASK_STACK 3072 // Bytes
+
+enum GameEvent
+{
+   GAME_EVENT_PADDING, // Fills up a sector of a partial batch, no event
+   GAME_EVENT_START, // First record of a file: arg16 version, arg32 GAME_LOG_MAGIC
+   GAME_EVENT_BUZZERS_OPEN, // "Buzzer offen!"
+   GAME_EVENT_BUZZER_PRESS, // arg8 buzzer, arg16 place, arg32 us since the buzzers were opened (0 if unknown)
+   GAME_EVENT_ANSWERING, // arg8 buzzer that answers
+   GAME_EVENT_TIMEOUT, // The time to answer ran out, arg8 buzzer that answered
+   GAME_EVENT_ROUND_CLOSED, // The round was closed before the timeout, arg8 buzzer that answered
+   GAME_EVENT_SOUND, // arg8 prio, arg16 volume and GAME_LOG_SOUND_* flags, arg32 hashFilename()
+   GAME_EVENT_CONFIG, // arg8 ConfigValue, arg32 new value
+   GAME_EVENT_LOST, // arg32 events dropped before this one because the ring was full
+   GAME_EVENT_COUNT
+};
+
+#define GAME_LOG_SOUND_DROPPED (1u << 8) // The request queue was full
+#define GAME_LOG_SOUND_PLAYLIST (1u << 9)
+
+struct GameLogRecord
+{
+   uint64_t timeUs; // esp_timer_get_time()
+   uint8_t type; // GameEvent
+   uint8_t arg8;
+   uint16_t arg16;
+   uint32_t arg32;
+} __attribute__((packed));
+
+static_assert(GAME_LOG_SECTOR_SIZE % sizeof(GameLogRecord) == 0, "Records must fill sectors");
+
+class GameLog
+{
+private:
+   static const uint32_t SECTOR_RECORDS = GAME_LOG_SECTOR_SIZE / sizeof(GameLogRecord);
+   static const uint32_t BATCH_RECORDS = GAME_LOG_BATCH_SECTORS * SECTOR_RECORDS;
+
+   // Single producer (the loop task) and single consumer (the writer)
+   RecordRing<GameLogRecord, GAME_LOG_RING_RECORDS> ring;
+   uint32_t lost = 0; // Producer only
+   std::atomic<bool> flushRequested{ false };
+
+   std::atomic<bool> active{ false }; // Cleared by the writer if the card fails
+   WriterTask writer;
+   File file;
+   GameLogRecord batch[BATCH_RECORDS]{};
+   uint32_t writtenBytes = 0;
+
+   bool push(uint8_t type, uint8_t arg8, uint16_t arg16, uint32_t arg32);
+   void writePending(bool force);
+   bool writeBatch(uint32_t count);
+
+public:
+   /**
+    * \brief Create the log file of this boot and start the writer, if the game log is enabled in the config
+    * \param fs File system of the logs (SD card)
+    */
+   void begin(fs::FS& fs);
+
+   /**
+    * \brief Writes the batches if the writer task could not be started, call once per loop
+    */
+   void loop();
+
+   /**
+    * \brief Log an event, only copies it into the ring. Call from the loop task only.
+    */
+   void add(GameEvent type, uint8_t arg8 = 0, uint16_t arg16 = 0, uint32_t arg32 = 0)
+   {
+      if (!active) return;
+      if (lost && push(GAME_EVENT_LOST, 0, 0, lost)) lost = 0;
+      if (!push((uint8_t)type, arg8, arg16, arg32)) lost++;
+   }
+
+   /**
+    * \brief Log a sound request
+    * \param accepted false if it was dropped
+    */
+   void addSound(const char* filename, int prio, uint8_t volume, bool accepted, bool playlist);
+
+   /**
+    * \brief Write everything logged so far, padded to a whole sector. Asynchronous if the writer task runs.
+    */
+   void flush();
+
+   bool isActive() const { return active; }
+};
+
+extern GameLog gameLog;
+
+#endif //ESP32_BUZZER_GAMELOG_H
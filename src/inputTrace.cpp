@@ -0,0 +1,279 @@
+/*
+ * Input trace recording and replay
+ */
+
+#include "inputTrace.h"
+#include "config.h"
+#include "pins.h"
+#include "sounds.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <cstring>
+
+static const char* TAG = "inputTrace";
+InputTrace inputTrace;
+
+#define DATA_LCD_SHIFT 0
+#define DATA_PUSH_SHIFT 12
+#define DATA_READING_MASK 0xfffu
+#define DATA_RED_LED (1u << 24)
+#define DATA_SOUNDS_SHIFT 25
+#define DATA_SOUNDS_MAX 7u
+#define DATA_OUTPUTS_SHIFT 24
+#define DATA_OUTPUTS_MASK (~0u << DATA_OUTPUTS_SHIFT)
+
+uint32_t InputTrace::captureOutputs()
+{
+   uint32_t data = 0;
+   if (digitalRead(RED_LED_PIN)) data |= DATA_RED_LED;
+   uint32_t requests = soundPlayer.getRequestCount();
+   data |= min(requests - soundRequests, DATA_SOUNDS_MAX) << DATA_SOUNDS_SHIFT;
+   soundRequests = requests;
+   return data;
+}
+
+void InputTrace::begin(fs::FS& fs)
+{
+   fileSystem = &fs;
+   if (fs.exists(INPUT_TRACE_REPLAY_FILE))
+   {
+      startReplay(INPUT_TRACE_REPLAY_FILE);
+      return;
+   }
+   config.resetHasChanged(CFG_INPUT_TRACE);
+   if (config.getValue(CFG_INPUT_TRACE)) setRecording(true);
+}
+
+void InputTrace::loop()
+{
+   if (!replaying && fileSystem && config.hasChanged(CFG_INPUT_TRACE)) setRecording(config.getValue(CFG_INPUT_TRACE));
+   if (writerStarted && !writer.isRunning()) writePending();
+}
+
+void InputTrace::setRecording(bool on)
+{
+   // Records are taken right away, the ring holds them until the writer has opened the file
+   if (on && !recordingOn) soundRequests = soundPlayer.getRequestCount();
+   recordingOn = on;
+   recordingWanted.store(on, std::memory_order_release);
+   if (!on || writerStarted) return;
+
+   // Started with the first recording, lowest priority on the core of the playback like the game log
+   writerStarted = true;
+   auto write = [](void* param) { static_cast<InputTrace*>(param)->writePending(); };
+   if (!writer.start("TraceTask", INPUT_TRACE_TASK_STACK, INPUT_TRACE_POLL_MS, write, this))
+   {
+      ESP_LOGW(TAG, "No writer task, the trace is written from the loop");
+   }
+}
+
+/**
+ * \brief Open or close the file as wanted and write full batches (writer task)
+ */
+void InputTrace::writePending()
+{
+   bool wanted = recordingWanted.load(std::memory_order_acquire);
+   if (writeFailed)
+   {
+      // Nothing is written until the loop task has stopped the recording
+      ring.dropPending();
+      if (!wanted) writeFailed = false;
+      return;
+   }
+   if (wanted && !fileOpen && !openRecording())
+   {
+      writeFailed = true;
+      return;
+   }
+   if (!fileOpen) return;
+
+   uint32_t lost = dropped.load(std::memory_order_relaxed);
+   if (lost != reportedDropped)
+   {
+      ESP_LOGW(TAG, "%u records dropped, the card was too slow", (unsigned)(lost - reportedDropped));
+      reportedDropped = lost;
+   }
+
+   // Once the recording is stopped, the loop task does not add records anymore and the rest is written
+   uint32_t pending = ring.getPending();
+   if (wanted && pending < INPUT_TRACE_BATCH_RECORDS) return;
+   if (!writeRecords(pending))
+   {
+      ESP_LOGE(TAG, "Failed to write trace, recording stopped");
+      closeRecording();
+      writeFailed = true;
+      return;
+   }
+   if (!wanted) closeRecording();
+}
+
+/**
+ * \brief Write records from the ring and flush, which keeps the trace readable if the power is cut (writer task)
+ */
+bool InputTrace::writeRecords(uint32_t count)
+{
+   while (count > 0)
+   {
+      // Up to the end of the ring at once
+      uint32_t n = count;
+      const InputTraceRecord* records = ring.peek(n);
+      size_t size = n * sizeof(InputTraceRecord);
+      if (recordFile.write((const uint8_t*)records, size) != size) return false;
+      ring.consume(n);
+      count -= n;
+   }
+   recordFile.flush();
+   return true;
+}
+
+bool InputTrace::openRecording()
+{
+   fileSystem->mkdir(INPUT_TRACE_DIR);
+   char path[32];
+   int index = 0;
+   for (; index < INPUT_TRACE_MAX_FILES; index++)
+   {
+      snprintf(path, sizeof path, INPUT_TRACE_DIR "/trace_%03d.bin", index);
+      if (!fileSystem->exists(path)) break;
+   }
+   if (index == INPUT_TRACE_MAX_FILES)
+   {
+      ESP_LOGE(TAG, "No free trace file name in %s", INPUT_TRACE_DIR);
+      return false;
+   }
+
+   recordFile = fileSystem->open(path, "w", true);
+   InputTraceHeader header{};
+   memcpy(header.magic, INPUT_TRACE_MAGIC, sizeof header.magic);
+   header.version = INPUT_TRACE_VERSION;
+   header.recordSize = sizeof(InputTraceRecord);
+   if (!recordFile || recordFile.write((const uint8_t*)&header, sizeof header) != sizeof header)
+   {
+      ESP_LOGE(TAG, "Failed to create %s", path);
+      recordFile.close();
+      return false;
+   }
+   ESP_LOGI(TAG, "Recording inputs to %s", path);
+   fileOpen = true;
+   return true;
+}
+
+void InputTrace::closeRecording()
+{
+   recordFile.close();
+   fileOpen = false;
+   ESP_LOGI(TAG, "Recording stopped");
+}
+
+void InputTrace::record(const RawInputs& raw)
+{
+   if (!recordingOn) return;
+   if (writeFailed)
+   {
+      setRecording(false);
+      return;
+   }
+   InputTraceRecord* rec = ring.reserve();
+   if (!rec)
+   {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+   }
+   rec->timeUs = micros();
+   rec->data = (raw.readingLcdButtons & DATA_READING_MASK) << DATA_LCD_SHIFT
+               | (raw.readingPushButtons & DATA_READING_MASK) << DATA_PUSH_SHIFT
+               | captureOutputs();
+   rec->buzzersPressed = raw.buzzersPressed;
+   rec->buzzerLeds = buzzers.getLeds();
+   ring.commit();
+}
+
+bool InputTrace::startReplay(const char* path)
+{
+   replayFile = fileSystem->open(path, "r");
+   InputTraceHeader header{};
+   if (!replayFile || replayFile.read((uint8_t*)&header, sizeof header) != sizeof header
+       || memcmp(header.magic, INPUT_TRACE_MAGIC, sizeof header.magic) != 0
+       || header.version != INPUT_TRACE_VERSION || header.recordSize != sizeof(InputTraceRecord))
+   {
+      ESP_LOGE(TAG, "%s is no valid input trace", path);
+      replayFile.close();
+      return false;
+   }
+   ESP_LOGW(TAG, "Replaying inputs from %s, the buttons and buzzers are ignored until it has finished", path);
+   bufferCount = 0;
+   bufferPos = 0;
+   result = {};
+   traceUs = 0;
+   soundRequests = soundPlayer.getRequestCount();
+   replaying = true;
+   return true;
+}
+
+bool InputTrace::nextReplayRecord(InputTraceRecord& rec)
+{
+   if (bufferPos == bufferCount)
+   {
+      size_t n = replayFile.read((uint8_t*)buffer, sizeof buffer);
+      bufferCount = (int)(n / sizeof(InputTraceRecord));
+      bufferPos = 0;
+      if (bufferCount == 0) return false;
+   }
+   rec = buffer[bufferPos++];
+   return true;
+}
+
+bool InputTrace::replay(RawInputs& raw)
+{
+   if (!replaying) return false;
+   InputTraceRecord rec{};
+   if (!nextReplayRecord(rec))
+   {
+      replayFile.close();
+      replaying = false;
+      ESP_LOGW(TAG, "Replay finished: %u records, %u with different outputs%s", result.records, result.mismatches,
+               result.mismatches ? "" : " (identical)");
+      if (result.mismatches) ESP_LOGW(TAG, "First difference at %ums", result.firstMismatchMs);
+      return false;
+   }
+
+   // Wait until the time the inputs were read in the recording, relative to the start of the replay
+   if (result.records == 0)
+   {
+      int64_t nowUs = esp_timer_get_time();
+      replayStartUs = nowUs - nowUs % 1000 + rec.timeUs % 1000;
+      if (replayStartUs < nowUs) replayStartUs += 1000;
+   }
+   else
+   {
+      traceUs += (uint32_t)(rec.timeUs - lastRecordUs);
+   }
+   lastRecordUs = rec.timeUs;
+   int64_t atUs = replayStartUs + (int64_t)traceUs;
+   int64_t waitUs = atUs - esp_timer_get_time();
+   if (waitUs >= 1000) delay((uint32_t)(waitUs / 1000));
+   if (waitUs > 0) delayMicroseconds((uint32_t)(waitUs % 1000));
+
+   raw.timeMs = (uint32_t)(atUs / 1000);
+   raw.readingLcdButtons = (rec.data >> DATA_LCD_SHIFT) & DATA_READING_MASK;
+   raw.readingPushButtons = (rec.data >> DATA_PUSH_SHIFT) & DATA_READING_MASK;
+   raw.buzzersPressed = rec.buzzersPressed;
+   raw.buzzersTimeUs = (uint32_t)atUs;
+
+   // The outputs are those of the previous loop, in the recording as well as now
+   uint32_t outputs = captureOutputs();
+   if (outputs != (rec.data & DATA_OUTPUTS_MASK) || buzzers.getLeds() != rec.buzzerLeds)
+   {
+      uint32_t atMs = (uint32_t)(traceUs / 1000);
+      if (result.mismatches == 0) result.firstMismatchMs = atMs;
+      if (result.mismatches < INPUT_TRACE_LOGGED_MISMATCHES)
+      {
+         ESP_LOGW(TAG, "Outputs differ at %ums: recorded 0x%02x/LEDs 0x%04x, now 0x%02x/LEDs 0x%04x", atMs,
+                  (rec.data & DATA_OUTPUTS_MASK) >> DATA_OUTPUTS_SHIFT, rec.buzzerLeds, outputs >> DATA_OUTPUTS_SHIFT,
+                  buzzers.getLeds());
+      }
+      result.mismatches++;
+   }
+   result.records++;
+   return true;
+}
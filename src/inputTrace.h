@@ -0,0 +1,129 @@
+/*
+ * Input trace recording and replay
+ * Records the raw inputs of every loop (ADC readings of the button ladders, buzzer levels) with their time, together
+ * with the outputs at that moment (LEDs, sound requests). The loop only puts the records into a RAM ring, a low
+ * priority writer task owns the file and writes them to the SD card in batches, so a slow card never holds up the
+ * buzzers. Records that don't fit into the ring are dropped and counted. A trace put on the card as
+ * INPUT_TRACE_REPLAY_FILE is fed back through the button filters, the buzzer logic and the screens instead of the real
+ * inputs, and the outputs are compared with the recorded ones. The host simulation (native environment) replays the
+ * same way, on its virtual clock.
+ */
+
+#ifndef ESP32_BUZZER_INPUTTRACE_H
+#define ESP32_BUZZER_INPUTTRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <FS.h>
+#include "inputs.h"
+#include "recordRing.h"
+
+#define INPUT_TRACE_DIR "/traces"
+#define INPUT_TRACE_REPLAY_FILE "/traces/replay.bin"
+#define INPUT_TRACE_MAGIC "ITRC"
+#define INPUT_TRACE_VERSION 2
+#define INPUT_TRACE_RING_RECORDS 512 // 6kB, about 3s of loops, power of two
+#define INPUT_TRACE_BATCH_RECORDS 128 // Written at once
+#define INPUT_TRACE_REPLAY_RECORDS 128 // Read at once during a replay
+#define INPUT_TRACE_POLL_MS 200
+#define INPUT_TRACE_TASK_STACK 3072 // Bytes
+#define INPUT_TRACE_MAX_FILES 1000
+#define INPUT_TRACE_LOGGED_MISMATCHES 10
+
+// File layout (little endian): header, then one record per loop
+struct InputTraceHeader
+{
+   char magic[4];
+   uint16_t version;
+   uint16_t recordSize;
+} __attribute__((packed));
+
+struct InputTraceRecord
+{
+   uint32_t timeUs; // micros() when the inputs were read, wraps after 71 minutes
+   uint32_t data; // Bits 0-11 LCD buttons reading, 12-23 push buttons reading, 24 red LED,
+                  // 25-27 sound requests since the last record (max 7)
+   uint16_t buzzersPressed; // Bit per buzzer of the buzzer table
+   uint16_t buzzerLeds;
+} __attribute__((packed));
+
+struct InputTraceReplayResult
+{
+   uint32_t records;
+   uint32_t mismatches; // Records whose outputs differ from the recorded ones
+   uint32_t firstMismatchMs; // Time of the first mismatch since the start of the trace
+};
+
+class InputTrace
+{
+private:
+   fs::FS* fileSystem = nullptr;
+
+   // Recording: single producer (the loop task) and single consumer (the writer)
+   RecordRing<InputTraceRecord, INPUT_TRACE_RING_RECORDS> ring;
+   std::atomic<uint32_t> dropped{ 0 }; // Records lost because the ring was full
+   bool recordingOn = false; // Loop task only, records are taken from the next loop on
+   std::atomic<bool> recordingWanted{ false }; // Set by the loop task, the writer opens or closes the file
+   std::atomic<bool> writeFailed{ false }; // Set by the writer, the loop task stops the recording
+   bool writerStarted = false;
+   WriterTask writer;
+   uint32_t soundRequests = 0; // Sound request count at the last record
+   File recordFile; // Writer only
+   bool fileOpen = false; // Writer only
+   uint32_t reportedDropped = 0; // Writer only
+
+   // Replay, loop task only
+   bool replaying = false;
+   File replayFile;
+   InputTraceRecord buffer[INPUT_TRACE_REPLAY_RECORDS]{};
+   int bufferCount = 0;
+   int bufferPos = 0;
+
+   // Replay timing: the trace is replayed at the recorded pace, time is counted from the first record. The start is
+   // placed at the same point within a millisecond, so millis() steps between the same records as in the recording.
+   uint32_t lastRecordUs = 0;
+   uint64_t traceUs = 0;
+   int64_t replayStartUs = 0;
+   InputTraceReplayResult result{};
+
+   uint32_t captureOutputs();
+   void setRecording(bool on);
+   void writePending();
+   bool writeRecords(uint32_t count);
+   bool openRecording();
+   void closeRecording();
+   bool startReplay(const char* path);
+   bool nextReplayRecord(InputTraceRecord& record);
+
+public:
+   /**
+    * \brief Start a replay if INPUT_TRACE_REPLAY_FILE exists, otherwise a recording if it is enabled in the config
+    * \param fs File system of the traces (SD card)
+    */
+   void begin(fs::FS& fs);
+
+   /**
+    * \brief Start or stop the recording when the config changes, call once per loop. Without the writer task (host
+    *    simulation) the records are written from here.
+    */
+   void loop();
+
+   /**
+    * \brief Record the inputs of this loop, does nothing if no recording is running. Never waits for the card.
+    */
+   void record(const RawInputs& raw);
+
+   /**
+    * \brief Get the inputs of this loop from the replayed trace. Waits until the recorded time of the inputs.
+    * \return false if no replay is running (anymore), the real inputs have to be read then
+    */
+   bool replay(RawInputs& raw);
+
+   bool isRecording() const { return recordingOn; }
+   bool isReplaying() const { return replaying; }
+   const InputTraceReplayResult& getReplayResult() const { return result; }
+};
+
+extern InputTrace inputTrace;
+
+#endif //ESP32_BUZZER_INPUTTRACE_H
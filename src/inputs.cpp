@@ -4,6 +4,9 @@
 
 #include "inputs.h"
 #include "pins.h"
+#include "inputTrace.h"
+#include "deferredLog.h"
+#include "allocCounter.h"
 #include <Arduino.h>
 
 struct ButtonReading
@@ -59,6 +62,16 @@ static ButtonType getButtonFromReading(uint16_t reading, const ButtonReading* bu
    return BUTTON_NONE;
 }
 
+ButtonType getPushButtonFromReading(uint16_t reading)
+{
+   return getButtonFromReading(reading, pushButtons, sizeof pushButtons / sizeof pushButtons[0]);
+}
+
+ButtonType getLcdButtonFromReading(uint16_t reading)
+{
+   return getButtonFromReading(reading, lcdButtons, sizeof lcdButtons / sizeof lcdButtons[0]);
+}
+
 
 /**
  * @class ButtonFilter
@@ -79,19 +92,19 @@ private:
 
 public:
    ButtonFilter(const ButtonReading* buttons, int buttonsLen, int acceptAfter);
-   void inputValue(uint16_t value);
+   void inputValue(uint16_t value, uint32_t nowMs);
    ButtonType getButton();
 };
 
-void ButtonFilter::inputValue(uint16_t value)
+void ButtonFilter::inputValue(uint16_t value, uint32_t nowMs)
 {
    ButtonType btn = getButtonFromReading(value, buttons, buttonsLen);
    if (currentButton != btn)
    {
-      buttonPressedSince = millis();
+      buttonPressedSince = nowMs;
    }
    currentButton = btn;
-   if (millis() - buttonPressedSince > acceptAfterMs) acceptedButton = currentButton;
+   if (nowMs - buttonPressedSince > acceptAfterMs) acceptedButton = currentButton;
 }
 
 ButtonType ButtonFilter::getButton()
@@ -105,39 +118,61 @@ ButtonFilter::ButtonFilter(const ButtonReading* buttons, int buttonsLen, int acc
 }
 
 
-void getInputValues(InputValues& values)
+void readRawInputs(RawInputs& raw)
+{
+   raw.readingLcdButtons = analogRead(LCD_BUTTONS_ANALOG_PIN);
+   raw.readingPushButtons = analogRead(PUSH_BUTTONS_ANALOG_PIN);
+   raw.buzzersPressed = buzzers.readPressed();
+   raw.buzzersTimeUs = micros();
+   // After the readings, an input trace records the time at this point
+   raw.timeMs = millis();
+}
+
+void processInputs(const RawInputs& raw, InputValues& values)
 {
-   values.readingLcdButtons = analogRead(LCD_BUTTONS_ANALOG_PIN);
-   values.readingPushButtons = analogRead(PUSH_BUTTONS_ANALOG_PIN);
-   values.isRedBuzzerPressed = !digitalRead(RED_BUZZER_INPUT);
-   values.isBlueBuzzerPressed = !digitalRead(BLUE_BUZZER_INPUT);
+   values.readingLcdButtons = raw.readingLcdButtons;
+   values.readingPushButtons = raw.readingPushButtons;
+   values.buzzersPressed = raw.buzzersPressed;
+   values.buzzersTimeUs = raw.buzzersTimeUs;
 
    static ButtonFilter pushBtnFilter = ButtonFilter(pushButtons, sizeof pushButtons / sizeof pushButtons[0]);
-   pushBtnFilter.inputValue(values.readingPushButtons);
+   pushBtnFilter.inputValue(values.readingPushButtons, raw.timeMs);
    ButtonType pushBtn = pushBtnFilter.getButton();
    values.pushBtnChanged = values.pushBtn != pushBtn;
    if (values.pushBtnChanged)
    {
-      ESP_LOGD(TAG, "%s -> %s", ButtonTypeStr[values.pushBtn], ButtonTypeStr[pushBtn]);
+      DLOGD(TAG, "%s -> %s", ButtonTypeStr[values.pushBtn], ButtonTypeStr[pushBtn]);
    }
    values.pushBtn = pushBtn;
 
    static ButtonFilter lcdBtnFilter = ButtonFilter(lcdButtons, sizeof lcdButtons / sizeof lcdButtons[0]);
-   lcdBtnFilter.inputValue(values.readingLcdButtons);
+   lcdBtnFilter.inputValue(values.readingLcdButtons, raw.timeMs);
    ButtonType lcdBtn = lcdBtnFilter.getButton();
    values.lcdBtnChanged = values.lcdBtn != lcdBtn;
    if (values.lcdBtnChanged)
    {
-      ESP_LOGD(TAG, "%s -> %s", ButtonTypeStr[values.lcdBtn], ButtonTypeStr[lcdBtn]);
+      DLOGD(TAG, "%s -> %s", ButtonTypeStr[values.lcdBtn], ButtonTypeStr[lcdBtn]);
    }
    values.lcdBtn = lcdBtn;
 }
 
+void getInputValues(InputValues& values)
+{
+   NO_ALLOC_SCOPE("inputs");
+   RawInputs raw{};
+   // A replayed trace takes the place of the hardware, so the rest of the loop runs exactly as when it was recorded
+   if (!inputTrace.replay(raw))
+   {
+      readRawInputs(raw);
+      inputTrace.record(raw);
+   }
+   processInputs(raw, values);
+}
+
 void inputsInit()
 {
    pinMode(LCD_BUTTONS_ANALOG_PIN, ANALOG);
    pinMode(PUSH_BUTTONS_ANALOG_PIN, ANALOG);
-   pinMode(BLUE_BUZZER_INPUT, INPUT);
-   pinMode(RED_BUZZER_INPUT, INPUT);
+   buzzers.begin();
    analogSetAttenuation(ADC_6db);
 }
@@ -6,6 +6,7 @@
 #define ESP32_BUZZER_INPUTS_H
 
 #include <cstdint>
+#include "buzzers.h"
 
 #define PUSH_BUTTON_COUNT 6
 
@@ -31,12 +32,22 @@ enum ButtonType
    BUTTON_TYPES_COUNT,
 };
 
+// Inputs as read from the hardware (or an input trace), before filtering
+struct RawInputs
+{
+   uint32_t timeMs;
+   uint16_t readingLcdButtons;
+   uint16_t readingPushButtons;
+   BuzzerMask buzzersPressed;
+   uint32_t buzzersTimeUs; // micros() when the buzzers were sampled
+};
+
 struct InputValues
 {
    uint16_t readingLcdButtons;
    uint16_t readingPushButtons;
-   bool isRedBuzzerPressed;
-   bool isBlueBuzzerPressed;
+   BuzzerMask buzzersPressed;
+   uint32_t buzzersTimeUs;
    ButtonType pushBtn;
    bool pushBtnChanged;
    ButtonType lcdBtn;
@@ -52,6 +63,22 @@ extern const char* ButtonTypeStr[BUTTON_TYPES_COUNT];
  */
 void getInputValues(InputValues& values);
 
+/**
+ * @brief Reads the raw input values from the hardware.
+ */
+void readRawInputs(RawInputs& raw);
+
+/**
+ * @brief Filters raw input values and updates the InputValues struct, the time of the raw values is used for debouncing.
+ */
+void processInputs(const RawInputs& raw, InputValues& values);
+
+/**
+ * @brief Gets the button of a single ADC reading of the push button or LCD button ladder, without debouncing.
+ */
+ButtonType getPushButtonFromReading(uint16_t reading);
+ButtonType getLcdButtonFromReading(uint16_t reading);
+
 void inputsInit();
 
 #endif //ESP32_BUZZER_INPUTS_H
@@ -6,13 +6,30 @@
 #include <hd44780.h>                       // main hd44780 header
 #include <hd44780ioClass/hd44780_I2Cexp.h> // i2c expander i/o class header
 #include <SD.h>
+#include <LittleFS.h>
 
 #include "pins.h"
 #include "sounds.h"
 
 #include "inputs.h"
+#include "buzzers.h"
 #include "config.h"
+#include "playStats.h"
+#include "reactionStats.h"
+#include "inputTrace.h"
+#include "gameLog.h"
+#include "deferredLog.h"
+#include "tracePoints.h"
+#include "resourceMonitor.h"
+#include "allocCounter.h"
+#include "bootTimer.h"
+#include "soundboard.h"
 #include "screens/screens.h"
+#include "storage/storage.h"
+#include "storage/fsStorage.h"
+#include "storage/busArbiter.h"
+#include "storage/fsWatch.h"
+#include <atomic>
 
 #if RUN_FTP
 #include <WiFi.h>
@@ -20,6 +37,7 @@
 #include "credentials.h"
 
 FTPServer ftp;
+#define FTP_TASK_STACK 8192
 #endif
 
 static const char* TAG = "main";
@@ -31,46 +49,190 @@ enum LastDisplayFunction {
    DISPLAY_INIT
 };
 static LastDisplayFunction lastDisplayFunction = DISPLAY_INIT;
-static bool ftpIsInit = false;
+static FsStorage sdStorage(SD, &sdBus);
+static FsStorage flashStorage(LittleFS);
 
-void setup()
+#define BOOT_TASK_STACK 6144 // Bytes, reads the soundboard directories
+static std::atomic<bool> storageReady{ false }; // Set by the boot task
+static bool bootDone = false;
+
+#if RUN_FTP
+/**
+ * \brief FTP server task, runs with low priority so uploads don't stall the buzzers or the playback
+ */
+[[noreturn]] static void ftpTask(void* param)
 {
-   Serial.begin(115200);
+   while (WiFi.status() != WL_CONNECTED) delay(500);
+   ESP_LOGI(TAG, "Connected to Wifi + init FTP");
+   ftp.addUser(FTP_USER, FTP_PASSWORD);
+   for (int i = 0; i < storage.getMountCount(); i++)
+   {
+      fs::FS* fileSystem = storage.getBackend(i)->getFS();
+      // Changes on the SD card are reported to the soundboard, so uploads show up without a rescan
+      if (fileSystem == &SD) fileSystem = sdWatch.getFS();
+      if (fileSystem) ftp.addFilesystem(storage.getMountName(i), fileSystem);
+   }
+   ftp.begin();
+
+   uint32_t lastStatsLog = millis();
+   while (true)
+   {
+      // The file accesses of the SD card are throttled while a sound plays (see busArbiter.h)
+      TRACE_BEGIN("ftp");
+      ftp.handle();
+      TRACE_END("ftp");
+      delay(1);
+
+      if (millis() - lastStatsLog > 30000)
+      {
+         BusStats stats = sdBus.getStats();
+         ESP_LOGD(TAG, "SD bus: player %u bytes in %ums, FTP %u bytes in %ums, FTP throttled %u times for %ums",
+                  (unsigned)stats.bytes[BUS_CLIENT_PLAYER], (unsigned)(stats.busyUs[BUS_CLIENT_PLAYER] / 1000),
+                  (unsigned)stats.bytes[BUS_CLIENT_FTP], (unsigned)(stats.busyUs[BUS_CLIENT_FTP] / 1000),
+                  (unsigned)stats.throttleCount, (unsigned)(stats.throttleUs / 1000));
+         lastStatsLog = millis();
+      }
+   }
+}
+#endif
 
+/**
+ * \brief Mount the SD card and the internal flash, then read the sound index and the soundboard
+ */
+static void bootStorage()
+{
+   int phase = bootTimer.begin("sd");
    while (!SD.begin(SS))
    {
       ESP_LOGE(TAG, "Failed to initialize SD card");
       delay(100);
    }
    ESP_LOGI(TAG, "SD card initialized successfully");
+   storage.mount("SD", "/", &sdStorage);
+   // Internal flash (spiffs partition) for sounds that should not depend on the SD card, paths start with /flash
+   if (LittleFS.begin(false)) storage.mount("Flash", "/flash", &flashStorage);
+   else ESP_LOGW(TAG, "No LittleFS in internal flash, /flash is not available");
+   bootTimer.end(phase);
 
-   pinMode(RED_LED_PIN, OUTPUT);
-   pinMode(RED_BUZZER_LED, OUTPUT);
-   pinMode(BLUE_BUZZER_LED, OUTPUT);
+   phase = bootTimer.begin("sound index");
+   soundPlayer.loadIndex();
+   bootTimer.end(phase);
 
-   // Load settings
-   config.load();
+   phase = bootTimer.begin("soundboard");
+   screens.loadSoundBoard();
+   bootTimer.end(phase);
 
-   soundPlayer.begin();
+   storageReady.store(true, std::memory_order_release);
+}
 
+/**
+ * \brief Boot task, reads the storage next to the loop and ends. It is not monitored, its handle goes away.
+ */
+static void bootTask(void* param)
+{
+   bootStorage();
+   vTaskDelete(nullptr);
+}
+
+/**
+ * \brief Last part of the boot, in the loop once the storage is there: the logs (they are fed by the loop task) and
+ * the FTP server
+ */
+static void finishBoot()
+{
+   int phase = bootTimer.begin("logs");
+   inputTrace.begin(SD);
+   gameLog.begin(SD);
+   bootTimer.end(phase);
+
+#if RUN_FTP
+   // The FTP task starts the server once WiFi is connected
+   sdWatch.begin("/sd", SOUNDBOARD_DIR);
+   TaskHandle_t ftpTaskHandle = nullptr;
+   xTaskCreatePinnedToCore(ftpTask, "FtpTask", FTP_TASK_STACK, nullptr, 1, &ftpTaskHandle, 0);
+   resourceMonitor.addTask(ftpTaskHandle, FTP_TASK_STACK);
+#endif
+
+   bootDone = true;
+   bootTimer.report();
+#if ALLOC_COUNTER
+   allocCounter.markSteady();
+#endif
+}
+
+void setup()
+{
+   // Only what the buzzers need is done here, the storage is read in the background (see bootTimer.h)
+   int phase = bootTimer.begin("core");
+   Serial.begin(115200);
+#if ALLOC_COUNTER
+   allocCounter.begin();
+#endif
+   resourceMonitor.begin();
+   deferredLog.begin();
+   bootTimer.end(phase);
+
+   // Settings are in NVS, not on the SD card
+   phase = bootTimer.begin("config");
+   config.load();
+   playStats.begin();
+   reactionStats.begin();
+   bootTimer.end(phase);
+
+   phase = bootTimer.begin("inputs");
+   pinMode(RED_LED_PIN, OUTPUT);
    inputsInit();
+   bootTimer.end(phase);
 
-   screens.init();
+   // The playback task sets up I2S on its own
+   phase = bootTimer.begin("player");
+   soundPlayer.begin();
+   bootTimer.end(phase);
+
+   // On the other core, next to the displays and the loop. Without the task (host simulation) it is done right here.
+   if (xTaskCreatePinnedToCore(bootTask, "BootTask", BOOT_TASK_STACK, nullptr, 1, nullptr, 0) != pdPASS)
+   {
+      bootStorage();
+   }
 
 #if RUN_FTP
-   // login into WiFi
+   // Connecting takes a while, it runs in the background until the FTP task needs it
    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 #endif
 
+   phase = bootTimer.begin("displays");
+   screens.init();
    lcd16_2.begin(16, 2);
    lcd16_2.setCursor(2, 0);
    lcd16_2.print("Myje stinkt");
    lcd16_2.setCursor(5, 1);
    lcd16_2.print("LOL");
+   bootTimer.end(phase);
+
+   bootTimer.markBuzzersReady();
+   if (storageReady) finishBoot();
 }
 
 
-void lightFirstBuzzer(bool red, bool blue, bool reset)
+/**
+ * \brief Log the ranked presses to the game log, and those after the first one with their delay to the serial log
+ * \param from First place to log
+ * \param openedUs Time the buzzers were opened, 0 if unknown
+ */
+static void logRanking(int from, uint32_t openedUs)
+{
+   const BuzzerPress& first = buzzers.getRanking(0);
+   for (int place = from; place < buzzers.getRankingCount(); place++)
+   {
+      const BuzzerPress& press = buzzers.getRanking(place);
+      gameLog.add(GAME_EVENT_BUZZER_PRESS, press.buzzer, (uint16_t)place, openedUs ? press.timeUs - openedUs : 0);
+      if (place == 0) continue;
+      DLOGI(TAG, "%d. %s +%.1fms", place + 1, BuzzerArbiter::getName(press.buzzer),
+            (press.timeUs - first.timeUs) / 1000.0);
+   }
+}
+
+void lightFirstBuzzer(BuzzerMask pressed, uint32_t pressedTimeUs, bool reset)
 {
    enum State
    {
@@ -80,45 +242,36 @@ void lightFirstBuzzer(bool red, bool blue, bool reset)
    static uint32_t lastChange = 0;
    static State state = STATE_WAITING;
    static State prevState = STATE_WAITING;
-   static bool lastChoiceSameTime = false;
+   static bool opened = false; // The first round after boot has no start, it is not measured
+   static uint32_t openedUs = 0;
+   NO_ALLOC_SCOPE("buzzers");
    int timeToAnswerMs = config.getValue(CFG_TIME_TO_ANSWER) * 1000;
-   static uint32_t lastBeepAtTimeLeft = 0;
 
    switch (state)
    {
       case STATE_WAITING:
-         if (red || blue)
+         // The ranking keeps everyone who buzzed after the first one, ties in a sample are taken in turn
+         if (buzzers.update(pressed, pressedTimeUs))
          {
+            TRACE_INSTANT("buzzer pressed");
             state = STATE_ANSWERING;
 
-            // take the one that was pressed, but if both are pressed take the one
-            bool chooseRed = red;
-            if (red && blue)
-            {
-               chooseRed = !lastChoiceSameTime;
-               lastChoiceSameTime = chooseRed;
-            }
+            int first = buzzers.getRanking(0).buzzer;
+            buzzers.setLeds((BuzzerMask)(1u << first));
+            digitalWrite(RED_LED_PIN, first == 0 ? HIGH : LOW);
             lastDisplayFunction = DISPLAY_BUZZER;
             lcd16_2.clear();
             lcd16_2.setCursor(0, 0);
-            if (chooseRed)
-            {
-               lcd16_2.print("ROT antwortet");
-               digitalWrite(RED_BUZZER_LED, HIGH);
-               digitalWrite(RED_LED_PIN, HIGH);
-               digitalWrite(BLUE_BUZZER_LED, LOW);
-            }
-            else
-            {
-               lcd16_2.print("BLAU antwortet");
-               digitalWrite(RED_BUZZER_LED, LOW);
-               digitalWrite(RED_LED_PIN, LOW);
-               digitalWrite(BLUE_BUZZER_LED, HIGH);
-            }
+            lcd16_2.print(BuzzerArbiter::getName(first));
+            lcd16_2.print(" antwortet");
+            logRanking(0, opened ? openedUs : 0);
+            gameLog.add(GAME_EVENT_ANSWERING, (uint8_t)first);
 
 
             soundPlayer.requestPlayback(SOUND_TIMER_START, SOUND_PRIO_BUZZER_START, config.getValue(CFG_BUZZER_START_VOLUME));
-            lastBeepAtTimeLeft = timeToAnswerMs;
+            // Beeps and end tone are placed on the audio sample clock, not timed from here
+            soundPlayer.startCountdown(timeToAnswerMs, config.getValue(CFG_BUZZER_BEEP_VOLUME),
+                                       config.getValue(CFG_BUZZER_END_VOLUME));
          }
          else
          {
@@ -132,13 +285,11 @@ void lightFirstBuzzer(bool red, bool blue, bool reset)
          break;
       case STATE_ANSWERING:
       {
+         int ranked = buzzers.getRankingCount();
+         if (buzzers.update(pressed, pressedTimeUs)) logRanking(ranked, opened ? openedUs : 0);
+
          uint32_t blockedSinceMs = millis() - lastChange;
          auto timeLeft = (int32_t)(timeToAnswerMs - blockedSinceMs);
-         if (lastBeepAtTimeLeft - timeLeft > 1000 && timeLeft >= 800)
-         {
-            soundPlayer.requestPlayback(SOUND_TIMER_BEEP, SOUND_PRIO_BUZZER_BEEP, config.getValue(CFG_BUZZER_BEEP_VOLUME));
-            lastBeepAtTimeLeft -= 1000;
-         }
 
          lastDisplayFunction = DISPLAY_BUZZER;
          lcd16_2.setCursor(1, 1);
@@ -149,15 +300,22 @@ void lightFirstBuzzer(bool red, bool blue, bool reset)
          if (reset || timeLeft <= 0)
          {
             state = STATE_WAITING;
-            digitalWrite(RED_BUZZER_LED, LOW);
-            digitalWrite(BLUE_BUZZER_LED, LOW);
+            buzzers.setLeds(0);
+            gameLog.add(timeLeft <= 0 ? GAME_EVENT_TIMEOUT : GAME_EVENT_ROUND_CLOSED, buzzers.getRanking(0).buzzer);
+            // The reaction times are taken from the ranking here, after the round, not while arbitrating
+            if (opened) reactionStats.recordRound(buzzers, openedUs);
+            buzzers.reset();
 
-            soundPlayer.requestPlayback(SOUND_TIMER_END, SOUND_PRIO_BUZZER_END, config.getValue(CFG_BUZZER_END_VOLUME));
+            // On timeout the end tone is already scheduled
+            if (timeLeft > 0) soundPlayer.stopCountdown(config.getValue(CFG_BUZZER_END_VOLUME));
 
             lastDisplayFunction = DISPLAY_BUZZER;
             lcd16_2.clear();
             lcd16_2.setCursor(1, 0);
             lcd16_2.print("Buzzer offen!");
+            opened = true;
+            openedUs = micros();
+            gameLog.add(GAME_EVENT_BUZZERS_OPEN);
          }
          break;
       }
@@ -179,7 +337,7 @@ void randomSound() {
    if (config.hasChanged(CFG_SOUND_RANDOM_PERIOD) || config.hasChanged(CFG_SOUND_RANDOM_ADD)
        || config.hasChanged(CFG_SOUND_RANDOM_ENABLE))
    {
-      ESP_LOGI(TAG, "Reinit random sounds due to config change");
+      DLOGI(TAG, "Reinit random sounds due to config change");
       config.resetHasChanged(CFG_SOUND_RANDOM_PERIOD);
       config.resetHasChanged(CFG_SOUND_RANDOM_ADD);
       config.resetHasChanged(CFG_SOUND_RANDOM_ENABLE);
@@ -189,7 +347,7 @@ void randomSound() {
    if (millis() >= nextPlay && config.getValue(CFG_SOUND_RANDOM_ENABLE))
    {
       if (nextPlay != 0) {
-         ESP_LOGI(TAG, "Play random sound");
+         DLOGI(TAG, "Play random sound");
          soundPlayer.requestPlayback(randomSounds[config.getValue(CFG_SOUND_RANDOM_SELECTION) % numberOfSounds], SOUND_PRIO_RANDOM,
                                      config.getValue(CFG_SOUND_RANDOM_VOLUME));
 
@@ -205,8 +363,8 @@ void randomSound() {
       int32_t randomOffsetMs = random(0, config.getValue(CFG_SOUND_RANDOM_ADD) * 60 * 1000L);
       int32_t nextOffset = max(5000, periodMs + randomOffsetMs);
       nextPlay = millis() + nextOffset;
-      ESP_LOGI(TAG, "Next random sound in %.2fs (%.2fs + %.2fs)", nextOffset / 1000.0, periodMs / 1000.0,
-                    randomOffsetMs / 1000.0);
+      DLOGI(TAG, "Next random sound in %.2fs (%.2fs + %.2fs)", nextOffset / 1000.0, periodMs / 1000.0,
+            randomOffsetMs / 1000.0);
    }
 
    if (clearDisplayAt != 0 && millis() > clearDisplayAt)
@@ -227,31 +385,47 @@ void randomSound() {
 
 void loop()
 {
-#if RUN_FTP
-   if (!ftpIsInit && WiFi.status() == WL_CONNECTED)
-   {
-      ESP_LOGI(TAG, "Connected to Wifi + init FTP");
-      ftp.addUser(FTP_USER, FTP_PASSWORD);
-      ftp.addFilesystem("SD", &SD);
-      ftp.begin();
-      ftpIsInit = true;
-   }
-
-   if (ftpIsInit)
-   {
-      ftp.handle();
-   }
-#endif
-
+   TRACE_BEGIN("loop");
    static InputValues values = {};
+   TRACE_BEGIN("inputs");
    getInputValues(values);
+   TRACE_END("inputs");
 
+   TRACE_BEGIN("screens");
    screens.loop(values);
+   TRACE_END("screens");
 
-   lightFirstBuzzer(values.isRedBuzzerPressed, values.isBlueBuzzerPressed, false);
+   TRACE_BEGIN("buzzers");
+   lightFirstBuzzer(values.buzzersPressed, values.buzzersTimeUs, false);
+   TRACE_END("buzzers");
 
    randomSound();
 
+   TRACE_BEGIN("background");
+   if (!bootDone && storageReady.load(std::memory_order_acquire)) finishBoot();
+
+   playStats.loop();
+
+   reactionStats.loop();
+
+   inputTrace.loop();
+
+   gameLog.loop();
+
+   deferredLog.loop();
+
+   resourceMonitor.loop();
+
+#if ALLOC_COUNTER
+   allocCounter.loop();
+#endif
+   TRACE_END("background");
+
+#if TRACE_POINTS
+   tracePoints.loop();
+#endif
+   TRACE_END("loop");
+
    delay(5);
 }
 
@@ -40,6 +40,13 @@
 #define RED_BUZZER_LED GPIO_NUM_12
 #define BLUE_BUZZER_LED GPIO_NUM_13
 
+// Buzzers of the teams: input, LED, name (see buzzers.h), up to MAX_BUZZERS. Inputs in the same GPIO bank (0-31 or
+// 32-39) are read with a single register read.
+#define BUZZER_TABLE { \
+   { RED_BUZZER_INPUT, RED_BUZZER_LED, "ROT" }, \
+   { BLUE_BUZZER_INPUT, BLUE_BUZZER_LED, "BLAU" }, \
+}
+
 // I2S amplifier
 #define I2S_LRC GPIO_NUM_16
 #define I2S_BCLK GPIO_NUM_15
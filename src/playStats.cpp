@@ -0,0 +1,92 @@
+/*
+ * Play statistics of soundboard sounds
+ */
+
+#include "playStats.h"
+#include "audio/filenameHash.h"
+#include <Arduino.h>
+#include <Preferences.h>
+
+static const char* TAG = "playStats";
+static Preferences preferences;
+PlayStats playStats;
+
+uint32_t PlayStats::hash(const char* filename)
+{
+   // 0 is reserved for free entries
+   uint32_t h = hashFilename(filename);
+   return h ? h : 1;
+}
+
+void PlayStats::begin()
+{
+   preferences.begin("playstats", false);
+   if (preferences.getBytesLength("scores") == sizeof entries)
+   {
+      preferences.getBytes("scores", entries, sizeof entries);
+   }
+   preferences.end();
+
+   int used = 0;
+   for (auto& entry: entries)
+   {
+      entry.score -= entry.score >> 3;
+      if (entry.score == 0) entry.hash = 0;
+      if (entry.hash) used++;
+   }
+   ESP_LOGI(TAG, "Loaded play statistics of %d sounds", used);
+}
+
+void PlayStats::recordPlay(const char* filename)
+{
+   uint32_t h = hash(filename);
+   Entry* target = nullptr;
+   Entry* lowest = &entries[0];
+   for (auto& entry: entries)
+   {
+      if (entry.hash == h)
+      {
+         target = &entry;
+         break;
+      }
+      if (entry.score < lowest->score) lowest = &entry;
+   }
+   // New sounds replace the least played one when the table is full
+   if (!target)
+   {
+      target = lowest;
+      target->hash = h;
+      target->score = 0;
+   }
+   target->score = min(target->score + 16, 0xffff);
+
+   if (unsavedPlays++ == 0) firstUnsavedPlayMs = millis();
+}
+
+uint16_t PlayStats::getScore(const char* filename) const
+{
+   uint32_t h = hash(filename);
+   for (const auto& entry: entries)
+   {
+      if (entry.hash == h) return entry.score;
+   }
+   return 0;
+}
+
+void PlayStats::loop()
+{
+   if (unsavedPlays >= PLAY_STATS_FLUSH_PLAYS
+       || (unsavedPlays > 0 && millis() - firstUnsavedPlayMs > PLAY_STATS_FLUSH_MS))
+   {
+      save();
+   }
+}
+
+void PlayStats::save()
+{
+   ESP_LOGI(TAG, "Save play statistics (%d new plays)", unsavedPlays);
+   preferences.begin("playstats", false);
+   preferences.putBytes("scores", entries, sizeof entries);
+   preferences.end();
+   unsavedPlays = 0;
+}
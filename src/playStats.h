@@ -0,0 +1,58 @@
+/*
+ * Play statistics of soundboard sounds
+ * Counts plays per sound in RAM and saves them to flash in batches (every few plays or minutes, not on each play).
+ * Scores decay with every boot so old favorites age out. Used to preload the most played sounds into RAM and to
+ * build the favorites page.
+ */
+
+#ifndef ESP32_BUZZER_PLAYSTATS_H
+#define ESP32_BUZZER_PLAYSTATS_H
+
+#include <cstdint>
+
+#define PLAY_STATS_ENTRIES 128
+#define PLAY_STATS_FLUSH_PLAYS 10 // Save after this many plays...
+#define PLAY_STATS_FLUSH_MS (10 * 60 * 1000) // ...or this long after the first unsaved play
+
+class PlayStats
+{
+private:
+   struct Entry
+   {
+      uint32_t hash; // Hash of the filename, 0 = free
+      uint16_t score; // 16 per play, decays by 1/8 per boot
+   } __attribute__((packed));
+
+   Entry entries[PLAY_STATS_ENTRIES]{};
+   int unsavedPlays = 0;
+   uint32_t firstUnsavedPlayMs = 0;
+
+   static uint32_t hash(const char* filename);
+
+public:
+   /**
+    * \brief Load statistics from flash and let them decay
+    */
+   void begin();
+
+   /**
+    * \brief Count a play of a sound
+    */
+   void recordPlay(const char* filename);
+
+   /**
+    * \brief Get the score of a sound (16 per play, decays over time)
+    */
+   uint16_t getScore(const char* filename) const;
+
+   /**
+    * \brief Save to flash if enough plays have accumulated, call periodically
+    */
+   void loop();
+
+   void save();
+};
+
+extern PlayStats playStats;
+
+#endif //ESP32_BUZZER_PLAYSTATS_H
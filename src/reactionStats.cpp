@@ -0,0 +1,166 @@
+/*
+ * Reaction time statistics of the teams
+ */
+
+#include "reactionStats.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <cmath>
+
+static const char* TAG = "reactionStats";
+static Preferences preferences;
+ReactionStats reactionStats;
+
+void P2Quantile::begin(float quantile)
+{
+   p = quantile;
+   count = 0;
+}
+
+float P2Quantile::parabolic(int i, int d) const
+{
+   float n = (float)positions[i], nUp = (float)positions[i + 1], nDown = (float)positions[i - 1];
+   return heights[i] + d / (nUp - nDown) * ((n - nDown + d) * (heights[i + 1] - heights[i]) / (nUp - n)
+                                            + (nUp - n - d) * (heights[i] - heights[i - 1]) / (n - nDown));
+}
+
+float P2Quantile::linear(int i, int d) const
+{
+   return heights[i] + d * (heights[i + d] - heights[i]) / (float)(positions[i + d] - positions[i]);
+}
+
+void P2Quantile::add(float value)
+{
+   // The first five values are kept sorted, they are the initial markers
+   if (count < 5)
+   {
+      int i = (int)count++;
+      for (; i > 0 && heights[i - 1] > value; i--) heights[i] = heights[i - 1];
+      heights[i] = value;
+      if (count == 5)
+      {
+         for (int m = 0; m < 5; m++) positions[m] = m;
+         desired[0] = 0;
+         desired[1] = 2 * p;
+         desired[2] = 4 * p;
+         desired[3] = 2 + 2 * p;
+         desired[4] = 4;
+      }
+      return;
+   }
+   count++;
+
+   int k;
+   if (value < heights[0])
+   {
+      heights[0] = value;
+      k = 0;
+   }
+   else if (value >= heights[4])
+   {
+      heights[4] = value;
+      k = 3;
+   }
+   else
+   {
+      for (k = 0; k < 3 && value >= heights[k + 1]; k++) {}
+   }
+   for (int m = k + 1; m < 5; m++) positions[m]++;
+   const float increments[5] = { 0, p / 2, p, (1 + p) / 2, 1 };
+   for (int m = 0; m < 5; m++) desired[m] += increments[m];
+
+   // Move the middle markers towards their desired positions
+   for (int i = 1; i <= 3; i++)
+   {
+      float delta = desired[i] - (float)positions[i];
+      if ((delta >= 1 && positions[i + 1] - positions[i] > 1) || (delta <= -1 && positions[i - 1] - positions[i] < -1))
+      {
+         int d = delta >= 0 ? 1 : -1;
+         float height = parabolic(i, d);
+         if (heights[i - 1] < height && height < heights[i + 1]) heights[i] = height;
+         else heights[i] = linear(i, d);
+         positions[i] += d;
+      }
+   }
+}
+
+float P2Quantile::get() const
+{
+   if (count == 0) return 0;
+   if (count <= 5) return heights[min((int)(p * count), (int)count - 1)];
+   return heights[2];
+}
+
+float TeamReactionStats::getStdDevMs() const
+{
+   return count > 1 ? sqrtf(m2 / (float)(count - 1)) : 0;
+}
+
+void ReactionStats::begin()
+{
+   preferences.begin("reaction", true);
+   bool loaded = preferences.getBytesLength("teams") == sizeof teams
+                 && preferences.getBytes("teams", teams, sizeof teams) == sizeof teams;
+   preferences.end();
+   if (!loaded) clear();
+   uint32_t rounds = 0;
+   for (int i = 0; i < BuzzerArbiter::getCount(); i++) rounds += teams[i].count;
+   ESP_LOGI(TAG, "Loaded %u reaction times of the current game", (unsigned)rounds);
+}
+
+void ReactionStats::recordRound(const BuzzerArbiter& arbiter, uint32_t openedUs)
+{
+   for (int place = 0; place < arbiter.getRankingCount(); place++)
+   {
+      const BuzzerPress& press = arbiter.getRanking(place);
+      float ms = (float)(press.timeUs - openedUs) / 1000.0f;
+      TeamReactionStats& team = teams[press.buzzer];
+      team.count++;
+      float delta = ms - team.meanMs;
+      team.meanMs += delta / (float)team.count;
+      team.m2 += delta * (ms - team.meanMs);
+      team.minMs = team.count == 1 ? ms : min(team.minMs, ms);
+      team.maxMs = team.count == 1 ? ms : max(team.maxMs, ms);
+      team.p50.add(ms);
+      team.p90.add(ms);
+      ESP_LOGD(TAG, "%s: %.0fms (mean %.0fms, median %.0fms)", BuzzerArbiter::getName(press.buzzer), ms,
+               team.meanMs, team.p50.get());
+   }
+   if (arbiter.getRankingCount() && unsavedRounds++ == 0) firstUnsavedRoundMs = millis();
+}
+
+void ReactionStats::loop()
+{
+   if (unsavedRounds >= REACTION_STATS_FLUSH_ROUNDS
+       || (unsavedRounds > 0 && millis() - firstUnsavedRoundMs > REACTION_STATS_FLUSH_MS))
+   {
+      save();
+   }
+}
+
+void ReactionStats::clear()
+{
+   for (auto& team: teams)
+   {
+      team = {};
+      team.p50.begin(0.5f);
+      team.p90.begin(0.9f);
+   }
+   unsavedRounds = 0;
+}
+
+void ReactionStats::reset()
+{
+   ESP_LOGI(TAG, "New game, reaction statistics cleared");
+   clear();
+   save();
+}
+
+void ReactionStats::save()
+{
+   ESP_LOGI(TAG, "Save reaction statistics");
+   preferences.begin("reaction", false);
+   preferences.putBytes("teams", teams, sizeof teams);
+   preferences.end();
+   unsavedRounds = 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Reaction time statistics of the teams
+ * Every round gives the reaction time of each team that buzzed: from "Buzzer offen!" to its first press. Per team,
+ * count, mean and variance (Welford), min/max and the median and 90th percentile (P² estimators, Jain/Chlamtac) are
+ * updated with every value, in constant memory. The statistics are saved to flash in batches like the play
+ * statistics and loaded at boot, so a game survives a restart. Starting a new game clears them.
+ */
+
+#ifndef ESP32_BUZZER_REACTIONSTATS_H
+#define ESP32_BUZZER_REACTIONSTATS_H
+
+#include <cstdint>
+#include "buzzers.h"
+
+#define REACTION_STATS_FLUSH_ROUNDS 5 // Save after this many rounds...
+#define REACTION_STATS_FLUSH_MS (5 * 60 * 1000) // ...or this long after the first unsaved round
+
+/**
+ * \brief Streaming estimate of a quantile with the P² algorithm: five markers, no stored values
+ */
+class P2Quantile
+{
+private:
+   float p = 0.5f;
+   float heights[5]{};
+   int32_t positions[5]{};
+   float desired[5]{};
+   uint32_t count = 0;
+
+   float parabolic(int i, int d) const;
+   float linear(int i, int d) const;
+
+public:
+   void begin(float quantile);
+   void add(float value);
+
+   /**
+    * \brief Current estimate, exact up to five values
+    */
+   float get() const;
+};
+
+struct TeamReactionStats
+{
+   uint32_t count;
+   float meanMs;
+   float m2; // Sum of the squared differences from the mean
+   float minMs;
+   float maxMs;
+   P2Quantile p50;
+   P2Quantile p90;
+
+   float getStdDevMs() const;
+};
+
+class ReactionStats
+{
+private:
+   TeamReactionStats teams[MAX_BUZZERS]{};
+   int unsavedRounds = 0;
+   uint32_t firstUnsavedRoundMs = 0;
+
+   void clear();
+   void save();
+
+public:
+   /**
+    * \brief Load the statistics of the current game from flash
+    */
+   void begin();
+
+   /**
+    * \brief Add the reaction times of a finished round, from the buzzer ranking
+    * \param openedUs micros() when the buzzers were opened
+    */
+   void recordRound(const BuzzerArbiter& arbiter, uint32_t openedUs);
+
+   /**
+    * \brief Save in batches, call once per loop
+    */
+   void loop();
+
+   /**
+    * \brief Clear the statistics for a new game and save that
+    */
+   void reset();
+
+   const TeamReactionStats& getTeam(int buzzer) const { return teams[buzzer]; }
+};
+
+extern ReactionStats reactionStats;
+
+#endif //ESP32_BUZZER_REACTIONSTATS_H
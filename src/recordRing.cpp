@@ -0,0 +1,28 @@
+/*
+ * Record ring and writer task of the SD card logs
+ */
+
+#include "recordRing.h"
+#include "resourceMonitor.h"
+#include <Arduino.h>
+
+bool WriterTask::start(const char* name, uint32_t stackSize, uint32_t interval, void (*function)(void*), void* arg)
+{
+   write = function;
+   param = arg;
+   pollMs = interval;
+   TaskHandle_t task = nullptr;
+   running = xTaskCreatePinnedToCore(run, name, stackSize, this, 1, &task, 0) == pdPASS;
+   if (running) resourceMonitor.addTask(task, stackSize);
+   return running;
+}
+
+[[noreturn]] void WriterTask::run(void* param)
+{
+   auto* self = static_cast<WriterTask*>(param);
+   while (true)
+   {
+      delay(self->pollMs);
+      self->write(self->param);
+   }
+}
@@ -0,0 +1,96 @@
+/*
+ * Record ring and writer task of the SD card logs
+ * The game log and the input trace take fixed size records in the loop and write them to the card later. The loop
+ * only copies a record into a RecordRing (single producer), a low priority WriterTask takes them out (single
+ * consumer) and owns the file, so a slow card never holds up the loop. Without tasks (host simulation) the owner
+ * calls the writer from its loop instead.
+ */
+
+#ifndef ESP32_BUZZER_RECORDRING_H
+#define ESP32_BUZZER_RECORDRING_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * \tparam Record Fixed size record
+ * \tparam Size Number of records, power of two (the positions count up and wrap around)
+ */
+template<typename Record, uint32_t Size>
+class RecordRing
+{
+   static_assert((Size & (Size - 1)) == 0, "The ring size must be a power of two");
+
+private:
+   Record records[Size]{};
+   std::atomic<uint32_t> head{ 0 }; // Records added, by the producer
+   std::atomic<uint32_t> tail{ 0 }; // Records taken out, by the consumer
+
+public:
+   /**
+    * \brief Slot of the next record (producer), it is added with commit()
+    * \return nullptr if the ring is full
+    */
+   Record* reserve()
+   {
+      uint32_t h = head.load(std::memory_order_relaxed);
+      if (h - tail.load(std::memory_order_acquire) >= Size) return nullptr;
+      return &records[h % Size];
+   }
+
+   void commit() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+   // Consumer side
+   uint32_t getPending() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed); }
+
+   /**
+    * \brief Oldest record, only valid if there are pending ones
+    */
+   const Record& front() const { return records[tail.load(std::memory_order_relaxed) % Size]; }
+
+   /**
+    * \brief Pending records from the oldest on that are in one piece, up to the end of the ring
+    * \param[in,out] count Wanted number of records, reduced to what is in one piece
+    */
+   const Record* peek(uint32_t& count) const
+   {
+      uint32_t index = tail.load(std::memory_order_relaxed) % Size;
+      uint32_t pending = getPending();
+      if (count > pending) count = pending;
+      if (count > Size - index) count = Size - index;
+      return &records[index];
+   }
+
+   /**
+    * \brief Take out records, after they are copied or written
+    */
+   void consume(uint32_t count) { tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release); }
+
+   void dropPending() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+};
+
+/**
+ * \brief Task that calls a write function every poll interval
+ */
+class WriterTask
+{
+private:
+   void (*write)(void* param) = nullptr;
+   void* param = nullptr;
+   uint32_t pollMs = 0;
+   bool running = false;
+
+   [[noreturn]] static void run(void* self);
+
+public:
+   /**
+    * \brief Start the task, lowest priority on the core of the playback (like the FTP server)
+    * \param write Called every pollMs from the task
+    * \return false if there is no task (host simulation), the owner has to call the function from its loop
+    */
+   bool start(const char* name, uint32_t stackSize, uint32_t pollMs, void (*write)(void* param), void* param);
+
+   bool isRunning() const { return running; }
+};
+
+#endif //ESP32_BUZZER_RECORDRING_H
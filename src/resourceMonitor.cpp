@@ -0,0 +1,79 @@
+/*
+ * Stack and heap monitor
+ */
+
+#include "resourceMonitor.h"
+
+static const char* TAG = "resourceMonitor";
+ResourceMonitor resourceMonitor;
+
+void ResourceMonitor::begin()
+{
+   addTask(xTaskGetCurrentTaskHandle(), CONFIG_ARDUINO_LOOP_STACK_SIZE);
+   sample();
+}
+
+void ResourceMonitor::addTask(TaskHandle_t task, uint32_t stackBytes)
+{
+   if (!task) return;
+   if (taskCount >= RESOURCE_MONITOR_TASKS)
+   {
+      ESP_LOGW(TAG, "Too many tasks, %s is not monitored", pcTaskGetTaskName(task));
+      return;
+   }
+   tasks[taskCount++] = { task, pcTaskGetTaskName(task), stackBytes, stackBytes };
+}
+
+void ResourceMonitor::sample()
+{
+   for (int i = 0; i < taskCount; i++)
+   {
+      TaskStackState& task = tasks[i];
+      // In bytes on the ESP32, the stack is an array of uint8_t there
+      task.minFreeBytes = uxTaskGetStackHighWaterMark(task.handle);
+      if (task.isLow() && !warnedStack[i])
+      {
+         ESP_LOGW(TAG, "Stack of %s: only %u of %u bytes were left", task.name, (unsigned)task.minFreeBytes,
+                  (unsigned)task.stackBytes);
+         warnedStack[i] = true;
+      }
+   }
+
+   heap.sizeBytes = ESP.getHeapSize();
+   heap.freeBytes = ESP.getFreeHeap();
+   heap.minFreeBytes = ESP.getMinFreeHeap();
+   heap.largestBlockBytes = ESP.getMaxAllocHeap();
+   heap.fragmentationPercent = heap.freeBytes ? (uint8_t)(100 - (uint64_t)heap.largestBlockBytes * 100 / heap.freeBytes)
+                                              : 0;
+   if (heap.isLow() && !warnedHeap)
+   {
+      ESP_LOGW(TAG, "Heap: only %u of %u bytes were free", (unsigned)heap.minFreeBytes, (unsigned)heap.sizeBytes);
+      warnedHeap = true;
+   }
+   // Fragmentation comes and goes, it is logged again after it went clearly below the threshold
+   if (heap.isFragmented() && !warnedFragmentation)
+   {
+      ESP_LOGW(TAG, "Heap fragmented: largest block %u of %u bytes free", (unsigned)heap.largestBlockBytes,
+               (unsigned)heap.freeBytes);
+      warnedFragmentation = true;
+   }
+   else if (heap.fragmentationPercent < RESOURCE_MONITOR_FRAGMENTATION_WARN_PERCENT - 10)
+   {
+      warnedFragmentation = false;
+   }
+   lastSampleMs = millis();
+}
+
+void ResourceMonitor::loop()
+{
+   if (millis() - lastSampleMs >= RESOURCE_MONITOR_PERIOD_MS) sample();
+}
+
+bool ResourceMonitor::hasWarning() const
+{
+   for (int i = 0; i < taskCount; i++)
+   {
+      if (tasks[i].isLow()) return true;
+   }
+   return heap.isLow() || heap.isFragmented();
+}
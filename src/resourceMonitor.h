@@ -0,0 +1,94 @@
+/*
+ * Stack and heap monitor
+ * The tasks of the firmware register with their stack size when they are created, the loop task registers itself.
+ * Once per second the loop samples the stack high water mark of each task (least free stack since its start) and the
+ * heap: free, least free since boot, largest free block and the fragmentation that follows from them. Values below
+ * the thresholds are logged once as warnings and marked on the debug screen, which shows all of them. That tells how
+ * much room is left to make stacks, buffers and caches bigger or where they have to shrink.
+ */
+
+#ifndef ESP32_BUZZER_RESOURCEMONITOR_H
+#define ESP32_BUZZER_RESOURCEMONITOR_H
+
+#include <cstdint>
+#include <Arduino.h>
+
+#define RESOURCE_MONITOR_TASKS 8
+#define RESOURCE_MONITOR_PERIOD_MS 1000
+#define RESOURCE_MONITOR_STACK_WARN_BYTES 768 // Warn if a task ever had less free stack
+#define RESOURCE_MONITOR_HEAP_WARN_BYTES (24 * 1024) // Warn if the free heap ever was lower
+#define RESOURCE_MONITOR_FRAGMENTATION_WARN_PERCENT 60 // Warn if the largest block is a smaller part of the free heap
+
+#ifndef CONFIG_ARDUINO_LOOP_STACK_SIZE
+#define CONFIG_ARDUINO_LOOP_STACK_SIZE 8192
+#endif
+
+struct TaskStackState
+{
+   TaskHandle_t handle;
+   const char* name;
+   uint32_t stackBytes;
+   uint32_t minFreeBytes; // High water mark, only goes down
+
+   bool isLow() const { return minFreeBytes < RESOURCE_MONITOR_STACK_WARN_BYTES; }
+};
+
+struct HeapState
+{
+   uint32_t sizeBytes; // 0 if the heap is not tracked (host simulation)
+   uint32_t freeBytes;
+   uint32_t minFreeBytes; // Since boot
+   uint32_t largestBlockBytes;
+   uint8_t fragmentationPercent; // Part of the free heap that is not in the largest block
+
+   bool isLow() const { return sizeBytes && minFreeBytes < RESOURCE_MONITOR_HEAP_WARN_BYTES; }
+   bool isFragmented() const
+   {
+      return sizeBytes && fragmentationPercent >= RESOURCE_MONITOR_FRAGMENTATION_WARN_PERCENT;
+   }
+};
+
+class ResourceMonitor
+{
+private:
+   TaskStackState tasks[RESOURCE_MONITOR_TASKS]{};
+   int taskCount = 0;
+   HeapState heap{};
+   uint32_t lastSampleMs = 0;
+   bool warnedStack[RESOURCE_MONITOR_TASKS]{};
+   bool warnedHeap = false;
+   bool warnedFragmentation = false;
+
+   void sample();
+
+public:
+   /**
+    * \brief Register the calling task (the loop task) and take the first sample
+    */
+   void begin();
+
+   /**
+    * \brief Monitor the stack of a task
+    * \param task Handle from xTaskCreate, ignored if nullptr (the task could not be created)
+    * \param stackBytes Stack size it was created with
+    */
+   void addTask(TaskHandle_t task, uint32_t stackBytes);
+
+   /**
+    * \brief Sample every RESOURCE_MONITOR_PERIOD_MS, call once per loop
+    */
+   void loop();
+
+   int getTaskCount() const { return taskCount; }
+   const TaskStackState& getTask(int index) const { return tasks[index]; }
+   const HeapState& getHeap() const { return heap; }
+
+   /**
+    * \brief Whether a value is below its threshold
+    */
+   bool hasWarning() const;
+};
+
+extern ResourceMonitor resourceMonitor;
+
+#endif //ESP32_BUZZER_RESOURCEMONITOR_H
@@ -3,9 +3,91 @@
 //
 
 #include "debugScreen.h"
+#include "reactionStats.h"
+#include "resourceMonitor.h"
 
 #include <Arduino.h>
 
+/**
+ * \brief Print a line cut to the row and clear the rest of it
+ */
+static void printPadded(LiquidCrystal& lcd, const char* line)
+{
+   size_t len = min(strlen(line), (size_t)20);
+   lcd.write((const uint8_t*)line, len);
+   for (size_t i = len; i < 20; i++) lcd.print(' ');
+}
+
+/**
+ * \brief One line of the reaction statistics, the teams and their figures take turns
+ * \param page Counts up, selects team and figures
+ */
+static void printReactionStats(LiquidCrystal& lcd, uint32_t page)
+{
+   char line[21] = "Keine Reaktionszeit";
+   int teams = BuzzerArbiter::getCount();
+   for (int n = 0; n < teams * 3; n++)
+   {
+      uint32_t index = (page + n) % (teams * 3);
+      int buzzer = (int)(index / 3);
+      const TeamReactionStats& team = reactionStats.getTeam(buzzer);
+      if (team.count == 0) continue;
+      const char* name = BuzzerArbiter::getName(buzzer);
+      // All times in ms: count, mean +- standard deviation / median and 90% / range
+      if (index % 3 == 0)
+      {
+         snprintf(line, sizeof line, "%-4.3sn%-4u%5u+-%-4u", name, (unsigned)team.count, (unsigned)team.meanMs,
+                  (unsigned)team.getStdDevMs());
+      }
+      else if (index % 3 == 1)
+      {
+         snprintf(line, sizeof line, "%-4.3s50%%%5u 90%%%4u", name, (unsigned)team.p50.get(), (unsigned)team.p90.get());
+      }
+      else
+      {
+         snprintf(line, sizeof line, "%-4.3s%5u..%-5u ms", name, (unsigned)team.minMs, (unsigned)team.maxMs);
+      }
+      break;
+   }
+   printPadded(lcd, line);
+}
+
+/**
+ * \brief Number of lines of printResources(), the heap is left out if it is not tracked
+ */
+static int getResourceLineCount()
+{
+   return (resourceMonitor.getHeap().sizeBytes ? 2 : 0) + resourceMonitor.getTaskCount();
+}
+
+/**
+ * \brief One line of the stack and heap monitor, '!' marks values below their threshold
+ * \param index Heap, largest block, then the tasks: least free / size of the stack in bytes
+ */
+static void printResources(LiquidCrystal& lcd, int index)
+{
+   char line[32];
+   const HeapState& heap = resourceMonitor.getHeap();
+   if (!heap.sizeBytes) index += 2;
+   if (index == 0)
+   {
+      snprintf(line, sizeof line, "%cHeap %3uk min %3uk", heap.isLow() ? '!' : ' ', (unsigned)(heap.freeBytes / 1024),
+               (unsigned)(heap.minFreeBytes / 1024));
+   }
+   else if (index == 1)
+   {
+      snprintf(line, sizeof line, "%cBlock %3uk frag%3u%%", heap.isFragmented() ? '!' : ' ',
+               (unsigned)(heap.largestBlockBytes / 1024), (unsigned)heap.fragmentationPercent);
+   }
+   else
+   {
+      const TaskStackState& task = resourceMonitor.getTask(index - 2);
+      snprintf(line, sizeof line, "%c%-8.8s%5u/%-5u", task.isLow() ? '!' : ' ', task.name,
+               (unsigned)task.minFreeBytes, (unsigned)task.stackBytes);
+   }
+   printPadded(lcd, line);
+}
+
 Screen debugScreen(const InputValues& values, LiquidCrystal& lcd, bool enter)
 {
    static uint32_t lastChange = millis();
@@ -15,19 +97,17 @@ Screen debugScreen(const InputValues& values, LiquidCrystal& lcd, bool enter)
    {
       lastChange = millis();
       lcd.clear();
-      digitalWrite(RED_BUZZER_LED, HIGH);
-      digitalWrite(BLUE_BUZZER_LED, HIGH);
+      buzzers.setLeds((BuzzerMask)((1u << BuzzerArbiter::getCount()) - 1));
 
    }
 
    if (millis() - lastUpdate > 250)  // updating too fast makes it hard to read
    {
       lcd.setCursor(0, 0);
-      lcd.print("Red: ");
-      lcd.print(values.isRedBuzzerPressed);
-      lcd.print(", ");
-      lcd.print("Blue: ");
-      lcd.print(values.isBlueBuzzerPressed);
+      lcd.print("Buzzer: ");
+      for (int i = 0; i < BuzzerArbiter::getCount(); i++) lcd.print(values.buzzersPressed & (1u << i) ? '1' : '0');
+      lcd.setCursor(16, 0);
+      lcd.print(resourceMonitor.hasWarning() ? "MEM!" : "    ");
 
       static ButtonType prevPushBtn = BUTTON_NONE;
       lcd.setCursor(0, 1);
@@ -46,6 +126,13 @@ Screen debugScreen(const InputValues& values, LiquidCrystal& lcd, bool enter)
       prevLcdBtn = values.lcdBtn;
       lcd.print(ButtonTypeStr[values.lcdBtn]);
       lcd.print("  ");
+
+      // The reaction statistics and the resources take turns
+      lcd.setCursor(0, 3);
+      uint32_t page = millis() / 1500;
+      uint32_t pages = 1 + getResourceLineCount();
+      if (page % pages == 0) printReactionStats(lcd, page / pages);
+      else printResources(lcd, (int)(page % pages) - 1);
       lastUpdate = millis();
    }
 
@@ -54,8 +141,7 @@ Screen debugScreen(const InputValues& values, LiquidCrystal& lcd, bool enter)
    if (changeState)
    {
 
-      digitalWrite(RED_BUZZER_LED, LOW);
-      digitalWrite(BLUE_BUZZER_LED, LOW);
+      buzzers.setLeds(0);
       return SCREEN_MENU;
    }
 
@@ -16,6 +16,7 @@
 #include <ItemList.h>
 #include "soundboardScreen.h"
 #include "sounds.h"
+#include "reactionStats.h"
 #include <LcdMenu.h>
 
 static const char* TAG = "menuScreen";
@@ -34,9 +35,15 @@ static void callbackReset()
    updateMenuValues();
 }
 
+static void callbackNewGame()
+{
+   reactionStats.reset();
+}
+
 static void callbackRefreshSoundboard()
 {
-   soundBoardScreenInit();
+   // During the boot it is still being read by the boot task
+   if (soundBoardScreenIsLoaded()) soundBoardScreenInit();
 }
 
 #define mapFloat(x, in_min, in_max, out_min, out_max) ((x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min)
@@ -90,6 +97,8 @@ MAIN_MENU(
    ITEM_SUBMENU("Buzzer", buzzerMenu),
    ITEM_SUBMENU("Random sounds", randomSoundMenu),
    ITEM_SUBMENU("Soundboard", soundboardMenu),
+   ITEM_CONFIG_TOGGLE("Input trace", CFG_INPUT_TRACE),
+   ITEM_CONFIG_TOGGLE("Spiel-Log", CFG_GAME_LOG),
    ITEM_COMMAND("Reset", callbackReset),
    ITEM_COMMAND("Debug", callbackDebugMenu)
 );
@@ -98,7 +107,8 @@ SUB_MENU(buzzerMenu, mainMenu,
          ITEM_CONFIG_PROGRESS("Beep Vol", CFG_BUZZER_BEEP_VOLUME, 5),
          ITEM_CONFIG_PROGRESS("Start Vol.", CFG_BUZZER_START_VOLUME, 5),
          ITEM_CONFIG_PROGRESS("End Vol.", CFG_BUZZER_END_VOLUME, 5),
-         ITEM_CONFIG_PROGRESS("Antwortzeit", CFG_TIME_TO_ANSWER, 1)
+         ITEM_CONFIG_PROGRESS("Antwortzeit", CFG_TIME_TO_ANSWER, 1),
+         ITEM_COMMAND("Neues Spiel", callbackNewGame)
 );
 
 const String randomSounds[] = SOUNDS_RANDOM_NAMES;
@@ -148,6 +158,8 @@ void updateMenuValues()
    setProgressFromCfg(randomSoundMenu[4], CFG_SOUND_RANDOM_VOLUME);
    randomSoundMenu[5]->setItemIndex(config.getValue(CFG_SOUND_RANDOM_SELECTION));
    setProgressFromCfg(soundboardMenu[1], CFG_SOUNDBOARD_VOLUME);
+   mainMenu[4]->setIsOn(config.getValue(CFG_INPUT_TRACE));
+   mainMenu[5]->setIsOn(config.getValue(CFG_GAME_LOG));
 }
 
 Screen menuScreen(const InputValues& values, LiquidCrystal& lcd, bool enter)
@@ -12,6 +12,10 @@ void ScreenManager::init()
 {
    display.begin(20, 4);
    menuInit();
+}
+
+void ScreenManager::loadSoundBoard()
+{
    soundBoardScreenInit();
 }
 
@@ -25,6 +29,7 @@ void ScreenManager::loop(const InputValues& values)
    };
    static Screen screen = SCREEN_SOUNDBOARD;
    static Screen prevScreen = SCREEN_COUNT;
+   soundBoardScreenUpdate();
    bool changed = prevScreen != screen;
    prevScreen = screen;
    screen = screenFunctions[screen](values, display, changed);
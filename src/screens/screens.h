@@ -27,6 +27,12 @@ private:
 public:
    ScreenManager() : display(LCD_RS, LCD_E, LCD_D4, LCD_D5, LCD_D6, LCD_D7) {}
    void init();
+
+   /**
+    * \brief Read the soundboard, may run in another task while loop() is called (it shows that it is loading)
+    */
+   void loadSoundBoard();
+
    void loop(const InputValues& values);
 };
 
@@ -6,9 +6,13 @@
 #include "soundboard.h"
 #include "sounds.h"
 #include "config.h"
+#include "playStats.h"
+#include "allocCounter.h"
+#include <atomic>
 
 static const char* TAG = "soundboardScreen";
 SoundBoard soundBoard;
+static std::atomic<bool> soundBoardLoaded{ false }; // Read in the background during the boot
 
 enum SoundboardControlMode
 {
@@ -19,16 +23,18 @@ enum SoundboardControlMode
 static inline void displaySoundBoardPage(LiquidCrystal& lcd, int currentPage, int soundBoardPagesCount)
 {
    lcd.clear();
+   char description[21];
    for (int r = 0; r < 3; ++r)
    {
       lcd.setCursor(0, r);
-      lcd.print(soundBoard.getDescription(currentPage, r * 2).c_str());
+      soundBoard.getDescription(currentPage, r * 2, description, sizeof description);
+      lcd.print(description);
 
       lcd.setCursor(9, r);
       lcd.print("|");
-      std::string soundRight = soundBoard.getDescription(currentPage, r * 2 + 1);
-      lcd.setCursor(20 - soundRight.size(), r);
-      lcd.print(soundRight.c_str());
+      size_t len = soundBoard.getDescription(currentPage, r * 2 + 1, description, sizeof description);
+      lcd.setCursor(20 - len, r);
+      lcd.print(description);
    }
    lcd.setCursor(0, 3);
    lcd.print("< ");
@@ -36,9 +42,17 @@ static inline void displaySoundBoardPage(LiquidCrystal& lcd, int currentPage, in
    lcd.print("/");
    lcd.print(soundBoardPagesCount);
    lcd.print(":");
-   lcd.print(soundBoard.getPageName(currentPage).c_str());
+   lcd.print(soundBoard.getPageName(currentPage));
    lcd.setCursor(18, 3);
    lcd.print(" >");
+
+   // The sounds on this page are the only ones that can be played next
+   const char* names[FILES_PER_PAGE];
+   for (int i = 0; i < FILES_PER_PAGE; ++i)
+   {
+      names[i] = soundBoard.getFileName(currentPage, i);
+   }
+   soundPlayer.prefetch(names, FILES_PER_PAGE);
 }
 
 /**
@@ -82,29 +96,32 @@ static inline int getIndexFromPushButton(const InputValues& values)
 /**
  * @brief Get the page description for a given sequence of button presses. (like "Page 1 - 5" or "foobar")
  * @param sequences A pointer to an array of integers representing button presses.
- * @return The page description as a string. Returns an empty string if an error occurs.
+ * @param[out] out The page description, empty if an error occurs.
+ * @return Length of the description
  */
-static std::string getPageDescriptionForSequence(const int* sequences)
+static size_t getPageDescriptionForSequence(const int* sequences, char* out, size_t size)
 {
    int minPage, maxPage;
+   int len;
    if (soundBoard.getPageRangeFromSequence(sequences, minPage, maxPage) < 0)
    {
-      return "";
+      len = 0;
+      out[0] = '\0';
    }
    else if (minPage == maxPage)
    {
       // Button would give a single page
-      return soundBoard.getPageName(minPage);
+      len = snprintf(out, size, "%s", soundBoard.getPageName(minPage));
    }
    else
    {
       // add one to indices since human beings start counting from 1
-      std::string s = "Page" + std::to_string(minPage + 1) + "-" + std::to_string(maxPage + 1);
-      return s;
+      len = snprintf(out, size, "Page%d-%d", minPage + 1, maxPage + 1);
    }
+   return min((size_t)len, size - 1);
 }
 
-static inline void displayPageJump(LiquidCrystal& lcd, const int* pressedSequence)
+static inline void displayPageJump(LiquidCrystal& lcd, const int* pressedSequence, bool hasFavorites)
 {
    lcd.clear();
    int sequences[MAX_QUICKACCESS_LEN];
@@ -114,23 +131,30 @@ static inline void displayPageJump(LiquidCrystal& lcd, const int* pressedSequenc
       sequences[i] = pressedSequence[i];
       if (nextPressIndex == -1 && pressedSequence[i] == -1) nextPressIndex = i;
    }
+   char description[21];
    for (int r = 0; r < 3; ++r)
    {
       lcd.setCursor(0, r);
       sequences[nextPressIndex] = r * 2;
-      lcd.print(getPageDescriptionForSequence(sequences).c_str());
+      getPageDescriptionForSequence(sequences, description, sizeof description);
+      lcd.print(description);
 
       lcd.setCursor(9, r);
       lcd.print("|");
 
       sequences[nextPressIndex] = r * 2 + 1;
-      std::string stringRight = getPageDescriptionForSequence(sequences);
-      lcd.setCursor(20 - stringRight.size(), r);
-      lcd.print(stringRight.c_str());
+      size_t len = getPageDescriptionForSequence(sequences, description, sizeof description);
+      lcd.setCursor(20 - len, r);
+      lcd.print(description);
    }
 
    lcd.setCursor(0, 3);
    lcd.print(" Wait for button");
+   if (hasFavorites)
+   {
+      lcd.setCursor(17, 3);
+      lcd.print("F >");
+   }
 }
 
 /**
@@ -186,13 +210,15 @@ static void jumpToPageBySequence(const int* pressedButtonSequence, int soundBoar
 
 static inline void playSoundOnButtonPress(const InputValues& values, int currentPage)
 {
+   NO_ALLOC_SCOPE("sound button");
    int fileIndex = getIndexFromPushButton(values);
    if (fileIndex != -1)
    {
-      std::string filename = soundBoard.getFileName(currentPage, fileIndex);
-      if (!filename.empty())
+      const char* filename = soundBoard.getFileName(currentPage, fileIndex);
+      if (filename[0])
       {
          soundPlayer.requestPlayback(filename, SOUND_PRIO_SOUNDBOARD, config.getValue(CFG_SOUNDBOARD_VOLUME));
+         playStats.recordPlay(filename);
       }
    }
 }
@@ -214,15 +240,32 @@ Screen soundBoardScreen(const InputValues& values, LiquidCrystal& lcd, bool ente
    static int currentPage = 0;
    static int pressedButtonSequence[MAX_QUICKACCESS_LEN] = { -1 };
    static int displayButtonSequence[MAX_QUICKACCESS_LEN] = { INT32_MAX };
-   if (enter)
+   static int displayRevision = -1;
+   static bool loadingShown = false;
+   if (!soundBoardLoaded.load(std::memory_order_acquire))
+   {
+      if (enter || !loadingShown)
+      {
+         lcd.clear();
+         lcd.setCursor(2, 1);
+         lcd.print("Soundboard laedt");
+         loadingShown = true;
+      }
+      return values.lcdBtnChanged && (values.lcdBtn == BUTTON_UP || values.lcdBtn == BUTTON_DOWN) ? SCREEN_MENU
+                                                                                                 : SCREEN_SOUNDBOARD;
+   }
+   if (enter || displayRevision != soundBoard.getRevision())
    {
       displayPage = -1; // leads to screen update
       displayButtonSequence[0] = INT32_MAX;
-      controlMode = SB_CTRL_SOUNDS;
+      displayRevision = soundBoard.getRevision();
+      if (enter) controlMode = SB_CTRL_SOUNDS;
    }
 
    int soundBoardPagesCount = soundBoard.getPageCount();
    if (soundBoardPagesCount == 0) return SCREEN_MENU;
+   // Pages may be gone after an update
+   if (currentPage >= soundBoardPagesCount) currentPage = 0;
 
    bool modeChanged = prevControlMode != controlMode;
    prevControlMode = controlMode;
@@ -263,10 +306,16 @@ Screen soundBoardScreen(const InputValues& values, LiquidCrystal& lcd, bool ente
          {
             controlMode = SB_CTRL_SOUNDS;
          }
+         else if (values.lcdBtn == BUTTON_RIGHT && soundBoard.getFavoritesPage() >= 0)
+         {
+            // Favorites have no quick access sequence, jump there directly
+            currentPage = soundBoard.getFavoritesPage();
+            controlMode = SB_CTRL_SOUNDS;
+         }
       }
       if (memcmp(pressedButtonSequence, displayButtonSequence, sizeof pressedButtonSequence) != 0 || modeChanged)
       {
-         displayPageJump(lcd, pressedButtonSequence);
+         displayPageJump(lcd, pressedButtonSequence, soundBoard.getFavoritesPage() >= 0);
          memcpy(displayButtonSequence, pressedButtonSequence, sizeof pressedButtonSequence);
       }
 
@@ -281,7 +330,35 @@ Screen soundBoardScreen(const InputValues& values, LiquidCrystal& lcd, bool ente
    return (values.lcdBtnChanged && (values.lcdBtn == BUTTON_UP || values.lcdBtn == BUTTON_DOWN) ? SCREEN_MENU : SCREEN_SOUNDBOARD);
 }
 
+/**
+ * \brief Keep the most played sounds in RAM so they start without touching the SD card
+ */
+static void preloadMostPlayed()
+{
+   std::vector<std::string> favorites = soundBoard.getMostPlayed(SOUND_CACHE_SLOTS);
+   const char* names[SOUND_CACHE_SLOTS];
+   for (size_t i = 0; i < favorites.size(); ++i)
+   {
+      names[i] = favorites[i].c_str();
+   }
+   soundPlayer.preload(names, (int)favorites.size());
+}
+
 void soundBoardScreenInit()
 {
    soundBoard.begin();
+   preloadMostPlayed();
+   soundBoardLoaded.store(true, std::memory_order_release);
+}
+
+bool soundBoardScreenIsLoaded()
+{
+   return soundBoardLoaded.load(std::memory_order_acquire);
+}
+
+void soundBoardScreenUpdate()
+{
+   if (!soundBoardLoaded.load(std::memory_order_acquire)) return;
+   // Uploaded sounds may have taken the place of cached ones
+   if (soundBoard.applyChanges()) preloadMostPlayed();
 }
@@ -9,6 +9,21 @@
 #include <LiquidCrystal.h>
 
 Screen soundBoardScreen(const InputValues& values, LiquidCrystal& lcd, bool enter);
+
+/**
+ * \brief Read the soundboard and preload its most played sounds. During the boot this runs in the boot task, the
+ * screen shows that it is loading until it is done.
+ */
 void soundBoardScreenInit();
 
+/**
+ * \brief Whether soundBoardScreenInit() has finished once
+ */
+bool soundBoardScreenIsLoaded();
+
+/**
+ * \brief Apply changes of the soundboard directory (FTP uploads), the screen is redrawn if it is affected
+ */
+void soundBoardScreenUpdate();
+
 #endif //ESP32_BUZZER_SOUNDBOARDSCREEN_H
@@ -4,12 +4,15 @@
 
 #include "soundboard.h"
 #include "inputs.h"
+#include "sounds.h"
+#include "playStats.h"
+#include "deferredLog.h"
+#include "storage/storage.h"
+#include "storage/fsWatch.h"
 #include <Arduino.h>
-#include <SD.h>
 #include <vector>
 #include <cmath>
-
-#define SOUNDBOARD_DIR "/soundboard"
+#include <algorithm>
 
 static const char* TAG = "soundboard";
 
@@ -23,7 +26,9 @@ static void printSoundBoardPages(const std::vector<SoundBoardPage>& pages)
       {
          auto& file = page.files[j];
          if (file.getFilename() != "") fileCount++;
-         ESP_LOGD(TAG, "%s: (%i) %s", file.getFilename().c_str(), j, file.getDescription().c_str());
+         char description[SOUND_FILENAME_LEN];
+         file.getDescription(description, sizeof description);
+         ESP_LOGD(TAG, "%s: (%i) %s", file.getFilename().c_str(), j, description);
       }
    }
    ESP_LOGI(TAG, "Loaded %d folders with %d files", pages.size(), fileCount);
@@ -38,7 +43,7 @@ static void printSoundBoardPages(const std::vector<SoundBoardPage>& pages)
  * @return Returns 0 if the SoundBoardPage is successfully created,
  *         -1 if there is no underscore in dirname and the name is therefore invalid.
  */
-static int parseDirname(const std::string& dirname, int& index, std::string& name)
+int parseDirname(const std::string& dirname, int& index, std::string& name)
 {
    // Skip part until the first underscore
    size_t firstUnderscore = dirname.find('_');
@@ -84,7 +89,8 @@ int get_sequence_for_page(uint32_t page, uint32_t page_count, uint32_t num_butto
       return buttons_one_press + (num_buttons - buttons_one_press) * std::pow(num_buttons, max_seq_len - 1);
    };
    int buttons_one_press = 0;
-   while (possible_pages(buttons_one_press + 1) >= page_count)
+   // With one press per page, possible_pages() does not depend on buttons_one_press
+   while (buttons_one_press < num_buttons && possible_pages(buttons_one_press + 1) >= page_count)
    {
       buttons_one_press++;
    }
@@ -113,79 +119,292 @@ int get_sequence_for_page(uint32_t page, uint32_t page_count, uint32_t num_butto
 
 
 /**
- * @brief Read files from a directory and create SoundBoardPages.
+ * @brief Get the paths of all files in the soundboard directories, or of the soundboard sounds in the sound pack
+ *        if there is one.
  *
- * @param pages A vector of SoundBoardPage objects to store the created pages.
+ * @param paths Full paths like "/soundboard/1_Foo/1_bar.wav"
+ * @return true if the sounds are from the sound pack
  */
-static void readFiles(std::vector<SoundBoardPage>& pages)
+static bool listSoundFiles(std::vector<std::string>& paths)
 {
-   File root = SD.open(SOUNDBOARD_DIR);
-   if (!root)
+   if (soundPlayer.listPackedSounds(SOUNDBOARD_DIR "/", paths))
+   {
+      ESP_LOGI(TAG, "Using the sound pack");
+      return true;
+   }
+
+   std::vector<StorageEntry> dirs;
+   if (!storage.list(SOUNDBOARD_DIR, dirs))
    {
       ESP_LOGE(TAG, "Failed to open " SOUNDBOARD_DIR " directory");
-      return;
+      return false;
+   }
+   for (const auto& dir: dirs)
+   {
+      if (!dir.isDirectory) continue;
+      std::string dirPath = SOUNDBOARD_DIR "/" + dir.name;
+      std::vector<StorageEntry> files;
+      storage.list(dirPath.c_str(), files);
+      for (const auto& file: files)
+      {
+         if (!file.isDirectory) paths.push_back(dirPath + '/' + file.name);
+      }
+   }
+   return false;
+}
+
+/**
+ * @brief Set the quick access sequences of all pages, they depend on the page count.
+ *
+ * @param pages Soundboard pages without the favorites page
+ */
+static void setQuickAccess(std::vector<SoundBoardPage>& pages)
+{
+   for (size_t i = 0; i < pages.size(); i++)
+   {
+      get_sequence_for_page(i, pages.size(), PUSH_BUTTON_COUNT, pages[i].quickAccess, sizeof pages[i].quickAccess);
    }
+}
+
+/**
+ * @brief Put a sound file into its place on the page.
+ *
+ * @param page The page of the directory the file is in
+ * @param path Full path of the file
+ * @param slash Position of the slash in front of the filename
+ */
+static void addSound(SoundBoardPage& page, std::string path, size_t slash)
+{
+   std::string filename = path.substr(slash + 1);
+   if (!isSupportedSoundFile(filename)) return;
+
+   // Name is like 1_foobar[_somemoretext].wav, find out indices of description
+   size_t firstUnderscore = filename.find('_');
+   if (firstUnderscore == std::string::npos) return;
+   int index = std::stoi(filename.substr(0, firstUnderscore));
+   if (index < 1 || index > FILES_PER_PAGE) return;
+   size_t nameEnd = min(filename.find('_', firstUnderscore + 1), filename.find('.', firstUnderscore + 1));
+   if (nameEnd == std::string::npos) return;
+
+   // Fill in info structure
+   page.files[index - 1] = SoundBoardSound(path, slash + 1 + firstUnderscore + 1, slash + 1 + nameEnd);
+}
+
+/**
+ * @brief Read files from a directory and create SoundBoardPages.
+ *
+ * @param pages A vector of SoundBoardPage objects to store the created pages.
+ * @return true if the sounds are from the sound pack
+ */
+static bool readFiles(std::vector<SoundBoardPage>& pages)
+{
+   std::vector<std::string> paths;
+   bool fromPack = listSoundFiles(paths);
+
+   // Paths are like /soundboard/{page index}_{page name}/{index}_{name}[_ignored].wav
+   const size_t dirStart = strlen(SOUNDBOARD_DIR "/");
+   auto getDirname = [&](const std::string& path, size_t& slash) -> std::string
+   {
+      slash = path.find('/', dirStart);
+      return slash == std::string::npos ? "" : path.substr(dirStart, slash - dirStart);
+   };
 
    // Find highest index
    int highestIndex = 0;
-   while (File file = root.openNextFile())
+   for (const auto& path: paths)
    {
-      if (file.isDirectory())
-      {
-         int index;
-         std::string name;
-         if (parseDirname(file.name(), index, name) == 0) highestIndex = max(highestIndex, index);
-      }
+      size_t slash;
+      int index;
+      std::string name;
+      if (parseDirname(getDirname(path, slash), index, name) == 0) highestIndex = max(highestIndex, index);
    }
+   highestIndex = min(highestIndex, MAX_PAGE_COUNT);
    ESP_LOGD(TAG, "Highest index is %i", highestIndex);
 
-   // Iterate over directories to extract Soundboard sounds
    pages.clear();
    pages.resize(highestIndex);
-   root.rewindDirectory();
-   while (File file = root.openNextFile())
+   setQuickAccess(pages);
+
+   // Sort the sounds into their pages
+   for (auto& path: paths)
+   {
+      size_t slash;
+      int pageIndex;
+      std::string pageName;
+      if (parseDirname(getDirname(path, slash), pageIndex, pageName) != 0) continue;
+      if (pageIndex < 1 || pageIndex > highestIndex) continue;
+      pages[pageIndex - 1].name = pageName;
+      addSound(pages[pageIndex - 1], path, slash);
+   }
+
+   printSoundBoardPages(pages);
+   return fromPack;
+}
+
+/**
+ * @brief Get all sounds with their play score, most played first.
+ *
+ * @param pages Soundboard pages
+ * @param favoritesPage Index of the favorites page, its copies of the sounds are left out (-1 if there is none)
+ * @return Pointers to the sounds that have been played
+ */
+static std::vector<const SoundBoardSound*> getSoundsByScore(const std::vector<SoundBoardPage>& pages,
+                                                            int favoritesPage)
+{
+   std::vector<std::pair<uint16_t, const SoundBoardSound*>> scored;
+   for (size_t p = 0; p < pages.size(); p++)
    {
-      if (file.isDirectory())
+      if ((int)p == favoritesPage) continue;
+      const SoundBoardPage& page = pages[p];
+      for (const auto& file: page.files)
       {
-         SoundBoardPage newPage;
-         int pageIndex;
-         if (parseDirname(file.name(), pageIndex, newPage.name) != 0) continue;
-         if (pageIndex < 1 || pageIndex > MAX_PAGE_COUNT) continue;
-
-         std::string filePath = SOUNDBOARD_DIR "/";
-         filePath.append(file.name());
-
-         File subDir = SD.open(filePath.c_str());
-         while (File subFile = subDir.openNextFile())
-         {
-            std::string filename = subFile.name();
-
-            // Name is like 1_foobar[_somemoretext].wav, find out indices of description
-            size_t firstUnderscore = filename.find('_');
-            if (firstUnderscore == std::string::npos) continue;
-            int index = std::stoi(filename.substr(0, firstUnderscore));
-            if (index < 1 || index > FILES_PER_PAGE) continue;
-            size_t nameEnd = min(filename.find('_', firstUnderscore + 1), filename.find('.', firstUnderscore + 1));
-            if (nameEnd == std::string::npos) continue;
-
-            // Fill in info structure
-            std::string fullFilename = filePath + '/';
-            fullFilename.append(filename);
-            SoundBoardSound fileInfo = SoundBoardSound(fullFilename, filePath.size() + firstUnderscore + 1 + 1,
-                                                       filePath.size() + nameEnd + 1);
-            newPage.files[index - 1] = fileInfo;
-         }
-         get_sequence_for_page(pageIndex - 1, highestIndex, PUSH_BUTTON_COUNT, newPage.quickAccess, sizeof newPage.quickAccess);
-         pages[pageIndex - 1] = newPage;
+         if (file.getFilename().empty()) continue;
+         uint16_t score = playStats.getScore(file.getFilename().c_str());
+         if (score > 0) scored.emplace_back(score, &file);
       }
    }
+   std::stable_sort(scored.begin(), scored.end(),
+                    [](const std::pair<uint16_t, const SoundBoardSound*>& a,
+                       const std::pair<uint16_t, const SoundBoardSound*>& b) { return a.first > b.first; });
 
-   printSoundBoardPages(pages);
+   std::vector<const SoundBoardSound*> sounds;
+   for (const auto& s: scored) sounds.push_back(s.second);
+   return sounds;
+}
+
+/**
+ * @brief Append a page with the most played sounds. It has no quick access sequence so the sequences of the
+ *        other pages stay the same.
+ *
+ * @param pages Soundboard pages without a favorites page
+ * @return Index of the favorites page or -1 if nothing has been played yet
+ */
+static int addFavoritesPage(std::vector<SoundBoardPage>& pages)
+{
+   std::vector<const SoundBoardSound*> sounds = getSoundsByScore(pages, -1);
+   if (sounds.empty()) return -1;
+
+   SoundBoardPage favorites;
+   favorites.name = FAVORITES_PAGE_NAME;
+   std::fill_n(favorites.quickAccess, MAX_QUICKACCESS_LEN, -1);
+   for (size_t i = 0; i < sounds.size() && i < (size_t)FILES_PER_PAGE; i++)
+   {
+      favorites.files[i] = *sounds[i];
+   }
+   pages.push_back(favorites);
+   ESP_LOGI(TAG, "Favorites page with %d sounds", min((int)sounds.size(), FILES_PER_PAGE));
+   return (int)pages.size() - 1;
 }
 
 void SoundBoard::begin()
 {
-   readFiles(pages);
+   fromPack = readFiles(pages);
+   favoritesPage = addFavoritesPage(pages);
+   revision++;
+}
+
+/**
+ * @brief Read the page directory of a changed file or directory again.
+ *
+ * @param path Path of the file or directory in the soundboard directory
+ */
+void SoundBoard::updatePage(const char* path)
+{
+   // Paths are like /soundboard/{page index}_{page name}[/{file}]
+   const size_t dirStart = strlen(SOUNDBOARD_DIR "/");
+   std::string changedPath = path;
+   if (changedPath.size() <= dirStart) return;
+   size_t slash = changedPath.find('/', dirStart);
+   std::string dirname = changedPath.substr(dirStart, slash == std::string::npos ? slash : slash - dirStart);
+   int pageIndex;
+   std::string pageName;
+   if (parseDirname(dirname, pageIndex, pageName) != 0 || pageIndex < 1 || pageIndex > MAX_PAGE_COUNT) return;
+
+   // A directory that is gone (removed or renamed) leaves an empty page, like one without files
+   std::string dirPath = SOUNDBOARD_DIR "/" + dirname;
+   std::vector<StorageEntry> files;
+   storage.list(dirPath.c_str(), files);
+   SoundBoardPage page{};
+   for (const auto& file: files)
+   {
+      if (file.isDirectory) continue;
+      page.name = pageName;
+      addSound(page, dirPath + '/' + file.name, dirPath.size());
+   }
+
+   if (pageIndex > (int)pages.size()) pages.resize(pageIndex);
+   std::copy_n(pages[pageIndex - 1].quickAccess, MAX_QUICKACCESS_LEN, page.quickAccess);
+   pages[pageIndex - 1] = page;
+   ESP_LOGI(TAG, "Page %d (%s) updated from %s", pageIndex, page.name.c_str(), dirPath.c_str());
+
+   // Empty pages at the end are dropped, like readFiles() does
+   auto isEmpty = [](const SoundBoardPage& p)
+   {
+      return p.name.empty() &&
+             std::all_of(p.files, p.files + FILES_PER_PAGE, [](const SoundBoardSound& s) { return s.getFilename().empty(); });
+   };
+   while (!pages.empty() && isEmpty(pages.back())) pages.pop_back();
+}
+
+bool SoundBoard::applyChanges()
+{
+   bool reload = sdWatch.takeOverflow();
+   std::vector<FsChange> changes;
+   FsChange change;
+   while (sdWatch.getChange(change)) changes.push_back(change);
+   if (changes.empty() && !reload) return false;
+
+   // Cached data of the old files is stale, no matter where the pages come from
+   for (const auto& c: changes)
+   {
+      soundPlayer.invalidate(c.path);
+      if (c.type == FS_CHANGE_RENAMED) soundPlayer.invalidate(c.newPath);
+   }
+   if (reload)
+   {
+      ESP_LOGW(TAG, "Changes were lost, reading all pages again");
+      soundPlayer.invalidate(SOUNDBOARD_DIR);
+      begin();
+      return true;
+   }
+   // The pages of the sound pack don't change with the directories. The changed files are played from there now
+   // (the player leaves them out of the pack), but new and removed files only show up when the pack is rebuilt.
+   if (fromPack)
+   {
+      for (const auto& c: changes)
+      {
+         ESP_LOGW(TAG, "%s has changed, the pages stay as in the sound pack until it is packed again", c.path);
+      }
+      return false;
+   }
+
+   if (favoritesPage >= 0) pages.erase(pages.begin() + favoritesPage);
+   size_t pageCount = pages.size();
+   for (const auto& c: changes)
+   {
+      // Renames update the old page first, the new one may have the same index
+      updatePage(c.path);
+      if (c.type == FS_CHANGE_RENAMED) updatePage(c.newPath);
+   }
+   if (pages.size() != pageCount)
+   {
+      setQuickAccess(pages);
+      ESP_LOGI(TAG, "Page count changed from %d to %d", (int)pageCount, (int)pages.size());
+   }
+   favoritesPage = addFavoritesPage(pages);
+   revision++;
+   return true;
+}
+
+std::vector<std::string> SoundBoard::getMostPlayed(int count)
+{
+   std::vector<std::string> filenames;
+   for (const auto* sound: getSoundsByScore(pages, favoritesPage))
+   {
+      if ((int)filenames.size() >= count) break;
+      filenames.push_back(sound->getFilename());
+   }
+   return filenames;
 }
 
 int SoundBoard::getPageCount()
@@ -193,31 +412,32 @@ int SoundBoard::getPageCount()
    return (int)pages.size();
 }
 
-std::string SoundBoard::getPageName(int index)
+const char* SoundBoard::getPageName(int index)
 {
    if (index >= pages.size())
    {
       return "";
    }
-   return pages[index].name;
+   return pages[index].name.c_str();
 }
 
-std::string SoundBoard::getFileName(int pageIndex, int fileIndex)
+const char* SoundBoard::getFileName(int pageIndex, int fileIndex)
 {
    if (pageIndex >= pages.size() || fileIndex >= FILES_PER_PAGE)
    {
       return "";
    }
-   return pages[pageIndex].files[fileIndex].getFilename();
+   return pages[pageIndex].files[fileIndex].getFilename().c_str();
 }
 
-std::string SoundBoard::getDescription(int pageIndex, int fileIndex)
+size_t SoundBoard::getDescription(int pageIndex, int fileIndex, char* out, size_t size)
 {
    if (pageIndex >= pages.size() || fileIndex >= FILES_PER_PAGE)
    {
-      return "";
+      out[0] = '\0';
+      return 0;
    }
-   return pages[pageIndex].files[fileIndex].getDescription();
+   return pages[pageIndex].files[fileIndex].getDescription(out, size);
 }
 
 /**
@@ -230,6 +450,7 @@ int SoundBoard::getPageIndexFromSequence(const int* sequence)
 {
    for (int i = 0; i < pages.size(); ++i)
    {
+      if (pages[i].quickAccess[0] == -1) continue;
       bool matched = true;
       for (int j = 0; j < MAX_QUICKACCESS_LEN; ++j)
       {
@@ -247,6 +468,7 @@ int SoundBoard::getPageRangeFromSequence(const int* sequence, int& minPage, int&
    maxPage = INT32_MIN;
    for (int i = 0; i < pages.size(); ++i)
    {
+      if (pages[i].quickAccess[0] == -1) continue;
       bool matched = true;
       for (int j = 0; j < MAX_QUICKACCESS_LEN; ++j)
       {
@@ -258,6 +480,6 @@ int SoundBoard::getPageRangeFromSequence(const int* sequence, int& minPage, int&
          maxPage = max(maxPage, i);
       }
    }
-   ESP_LOGD(TAG, "Page range for sequence %i, %i is %i - %i, rc=%i", sequence[0], sequence[1], minPage, maxPage, minPage == INT32_MAX ? -1 : 0);
+   DLOGD(TAG, "Page range for sequence %i, %i is %i - %i, rc=%i", sequence[0], sequence[1], minPage, maxPage, minPage == INT32_MAX ? -1 : 0);
    return minPage == INT32_MAX ? -1 : 0;
 }
@@ -5,6 +5,9 @@
 #ifndef ESP32_BUZZER_SOUNDBOARD_H
 #define ESP32_BUZZER_SOUNDBOARD_H
 
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -20,6 +23,13 @@ struct Pow<BASE, 0> {
 };
 constexpr int MAX_PAGE_COUNT = Pow<FILES_PER_PAGE, MAX_QUICKACCESS_LEN>::result;
 
+#define FAVORITES_PAGE_NAME "Favoriten"
+#define SOUNDBOARD_DIR "/soundboard"
+
+// Helpers of the soundboard, see soundboard.cpp
+int parseDirname(const std::string& dirname, int& index, std::string& name);
+int get_sequence_for_page(uint32_t page, uint32_t page_count, uint32_t num_buttons, int* sequence, size_t len);
+
 
 class SoundBoardSound
 {
@@ -35,9 +45,16 @@ public:
    {
    }
 
-   std::string getDescription() const
+   /**
+    * \brief Copy the description (part of the filename) without allocating
+    * \return Its length, cut to size - 1
+    */
+   size_t getDescription(char* out, size_t size) const
    {
-      return filename.substr(descriptionStart, descriptionEnd - descriptionStart);
+      size_t len = std::min(descriptionEnd - descriptionStart, size - 1);
+      filename.copy(out, len, descriptionStart);
+      out[len] = '\0';
+      return len;
    }
 
    // Getter for filename
@@ -48,21 +65,57 @@ struct SoundBoardPage
 {
    std::string name;
    SoundBoardSound files[FILES_PER_PAGE];
-   int quickAccess[MAX_QUICKACCESS_LEN];
+   int quickAccess[MAX_QUICKACCESS_LEN]; // All -1 for pages without quick access (favorites)
 };
 
 class SoundBoard
 {
 private:
    std::vector<SoundBoardPage> pages;
+   int favoritesPage = -1;
+   int revision = 0;
+   bool fromPack = false;
+
+   void updatePage(const char* path);
 public:
    void begin();
    int getPageCount();
-   std::string getPageName(int index);
-   std::string getFileName(int pageIndex, int fileIndex);
-   std::string getDescription(int pageIndex, int fileIndex);
+   // The names stay valid until the pages change (applyChanges()), they are not copied
+   const char* getPageName(int index);
+   const char* getFileName(int pageIndex, int fileIndex);
+
+   /**
+    * \brief Copy the description of a sound, empty if there is none
+    * \return Its length
+    */
+   size_t getDescription(int pageIndex, int fileIndex, char* out, size_t size);
    int getPageIndexFromSequence(const int* sequence);
    int getPageRangeFromSequence(const int* sequence, int& minPage, int& maxPage);
+
+   /**
+    * \brief Index of the page with the most played sounds, -1 if nothing was played yet
+    */
+   int getFavoritesPage() const { return favoritesPage; }
+
+   /**
+    * \brief Get the most played sounds according to the play statistics
+    * \param count Maximum number of sounds
+    * \return Filenames, most played first
+    */
+   std::vector<std::string> getMostPlayed(int count);
+
+   /**
+    * \brief Apply the changes of the soundboard directory reported by the FTP server (see fsWatch.h).
+    *    Only the affected pages are read again, the quick access sequences are only recomputed if the page count
+    *    changes. Cached data of changed sounds is dropped.
+    * \return true if the pages have changed
+    */
+   bool applyChanges();
+
+   /**
+    * \brief Incremented whenever the pages change, so the screen knows when to redraw
+    */
+   int getRevision() const { return revision; }
 };
 
 
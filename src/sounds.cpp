@@ -4,6 +4,23 @@
 
 #include "sounds.h"
 #include "pins.h"
+#include "gameLog.h"
+#include "deferredLog.h"
+#include "tracePoints.h"
+#include "resourceMonitor.h"
+#include "bootTimer.h"
+#include "allocCounter.h"
+#include "audio/resampleOutput.h"
+#include "audio/pcmRingBuffer.h"
+#include "audio/imaAdpcmGenerator.h"
+#include "audio/toneVoice.h"
+#include "audio/prefetchCache.h"
+#include "audio/soundCache.h"
+#include "audio/soundTrim.h"
+#include "audio/soundPack.h"
+#include "audio/storageSource.h"
+#include "storage/storage.h"
+#include "storage/busArbiter.h"
 
 // Tried also ESP32-audioI2S, ESP8266Audio seems to be better, other one has following problems:
 //  - cut off sounds / sounds not even played when too short
@@ -11,92 +28,552 @@
 // Both have some artifacts and different volume levels, but this could be due to HW reasons
 
 #include "AudioOutputI2S.h"
-#include "AudioFileSourceSD.h"
+#include "AudioFileSourcePROGMEM.h"
 #include "AudioGeneratorWAV.h"
+#include "AudioGeneratorMP3.h"
 #include <Arduino.h>
+#include <strings.h>
+#include <utility>
 
 static const char* TAG = "sounds";
 SoundPlayer soundPlayer;
 
+// Decoded samples buffered in front of I2S, ~93ms at 44.1kHz (16kB)
+static constexpr size_t DECODE_AHEAD_FRAMES = 4096;
+
+enum SoundRequestType
+{
+   SOUND_REQUEST_PLAYBACK,
+   SOUND_REQUEST_COUNTDOWN_START,
+   SOUND_REQUEST_COUNTDOWN_STOP,
+   SOUND_REQUEST_PREFETCH, // Only wakes up the playback task, the filenames are in the prefetch / sound cache
+   SOUND_REQUEST_INVALIDATE, // File or directory has changed
+};
+
 struct SoundRequest
 {
-   char filename[128];
+   SoundRequestType type;
+   char filename[SOUND_FILENAME_LEN];
    int prio; // Playback prio, if a higher prio request comes in, lower one is stopped
    uint8_t volume;
+   uint8_t endVolume; // Countdown only
+   uint32_t durationMs; // Countdown only
+   uint32_t requestedAtMs;
+   uint32_t playlistId; // Playback of a playlist, 0 for a single file
 };
 
 
+static bool hasExtension(const char* filename, const char* extension)
+{
+   size_t len = strlen(filename);
+   size_t extLen = strlen(extension);
+   return len >= extLen && strcasecmp(filename + len - extLen, extension) == 0;
+}
+
+bool isSupportedSoundFile(const std::string& filename)
+{
+   return hasExtension(filename.c_str(), ".wav") || hasExtension(filename.c_str(), ".mp3");
+}
+
+/**
+ * \brief Queue a playback request, waits a bit if the playback task is behind
+ * \return false if the queue stayed full and the request was dropped
+ */
+static bool sendPlaybackRequest(xQueueHandle queue, const SoundRequest& request)
+{
+   if (xQueueSend(queue, &request, pdMS_TO_TICKS(10)) == pdTRUE) return true;
+   ESP_LOGW(TAG, "Queue full, playback of %s dropped", request.filename);
+   return false;
+}
+
 void SoundPlayer::playbackHandlerStub(void* param){
    // Needed for C++ compatibility
    auto* self = static_cast<SoundPlayer*>(param);
    self->playbackHandler();
 }
 
-void SoundPlayer::requestPlayback(const std::string& filename, int prio, uint8_t volume)
+bool SoundPlayer::requestPlayback(const char* filename, int prio, uint8_t volume)
 {
-   if (volume <= 0) return;
+   if (volume <= 0) return false;
    if (volume > 100) volume = 100;
+   requestCount++;
    SoundRequest request{};
-   strcpy(request.filename, filename.c_str());
+   request.type = SOUND_REQUEST_PLAYBACK;
+   strlcpy(request.filename, filename, SOUND_FILENAME_LEN);
    request.prio = prio;
    request.volume = volume;
+   request.requestedAtMs = millis();
+   bool accepted = sendPlaybackRequest(playQueue, request);
+   gameLog.addSound(request.filename, prio, volume, accepted, false);
+   return accepted;
+}
+
+bool SoundPlayer::requestPlaylist(const char* const filenames[], int count, int prio, uint8_t volume)
+{
+   if (volume <= 0 || count <= 0) return false;
+   if (volume > 100) volume = 100;
+   requestCount++;
+   count = min(count, SOUND_PLAYLIST_LEN);
+
+   // A new playlist replaces the previous one, which stops at its current file
+   SoundRequest request{};
+   xSemaphoreTake(playlistMutex, portMAX_DELAY);
+   for (int i = 0; i < count; i++)
+   {
+      strlcpy(playlist[i], filenames[i], SOUND_FILENAME_LEN);
+   }
+   playlistCount = count;
+   request.playlistId = ++playlistId;
+   xSemaphoreGive(playlistMutex);
+
+   request.type = SOUND_REQUEST_PLAYBACK;
+   strlcpy(request.filename, filenames[0], SOUND_FILENAME_LEN);
+   request.prio = prio;
+   request.volume = volume;
+   request.requestedAtMs = millis();
+   bool accepted = sendPlaybackRequest(playQueue, request);
+   gameLog.addSound(request.filename, prio, volume, accepted, true);
+   return accepted;
+}
+
+void SoundPlayer::startCountdown(uint32_t timeToAnswerMs, uint8_t beepVolume, uint8_t endVolume)
+{
+   SoundRequest request{};
+   request.type = SOUND_REQUEST_COUNTDOWN_START;
+   request.volume = min(beepVolume, (uint8_t)100);
+   request.endVolume = min(endVolume, (uint8_t)100);
+   request.durationMs = timeToAnswerMs;
+   request.requestedAtMs = millis();
    xQueueSend(playQueue, &request, pdMS_TO_TICKS(10));
 }
 
-[[noreturn]] void SoundPlayer::playbackHandler()
+void SoundPlayer::stopCountdown(uint8_t endVolume)
+{
+   SoundRequest request{};
+   request.type = SOUND_REQUEST_COUNTDOWN_STOP;
+   request.endVolume = min(endVolume, (uint8_t)100);
+   request.requestedAtMs = millis();
+   xQueueSend(playQueue, &request, pdMS_TO_TICKS(10));
+}
+
+void SoundPlayer::prefetch(const char* const filenames[], int count)
+{
+   prefetchCache.request(filenames, count);
+   SoundRequest request{};
+   request.type = SOUND_REQUEST_PREFETCH;
+   request.requestedAtMs = millis();
+   xQueueSend(playQueue, &request, 0);
+}
+
+void SoundPlayer::preload(const char* const filenames[], int count)
+{
+   soundCache.request(filenames, count);
+   SoundRequest request{};
+   request.type = SOUND_REQUEST_PREFETCH;
+   request.requestedAtMs = millis();
+   xQueueSend(playQueue, &request, 0);
+}
+
+void SoundPlayer::invalidate(const char* path)
 {
-   delay(1000);
+   SoundRequest request{};
+   request.type = SOUND_REQUEST_INVALIDATE;
+   strlcpy(request.filename, path, SOUND_FILENAME_LEN);
+   request.requestedAtMs = millis();
+   xQueueSend(playQueue, &request, pdMS_TO_TICKS(10));
+}
+
+/**
+ * \brief Schedule or cancel the countdown tones
+ * \param request Countdown request
+ * \param tones Tone voice
+ * \param clock Current sample clock
+ */
+static void handleCountdownRequest(const SoundRequest& request, ToneVoice& tones, uint64_t clock)
+{
+   static const Tone beep = TONE_TIMER_BEEP;
+   static const Tone end = TONE_TIMER_END;
+
+   if (request.type == SOUND_REQUEST_PREFETCH || request.type == SOUND_REQUEST_INVALIDATE) return;
+   tones.cancel();
+   if (request.type == SOUND_REQUEST_COUNTDOWN_STOP)
+   {
+      tones.schedule(end, clock, request.endVolume);
+      return;
+   }
 
+   // Count from the time of the request, it may have waited in the queue
+   uint32_t elapsedMs = millis() - request.requestedAtMs;
+   auto clockAt = [&](uint32_t ms)
+   {
+      return clock + (uint64_t)(ms > elapsedMs ? ms - elapsedMs : 0) * SOUND_OUTPUT_RATE / 1000;
+   };
+   // Beep every second while there are at least 800ms left
+   for (uint32_t t = 1000; t + 800 <= request.durationMs; t += 1000)
+   {
+      tones.schedule(beep, clockAt(t), request.volume);
+   }
+   tones.schedule(end, clockAt(request.durationMs), request.endVolume);
+   DLOGD(TAG, "Countdown of %lums scheduled", (unsigned long)request.durationMs);
+}
+
+/**
+ * \brief Sources for one file. There are two sets, so the next file of a playlist can be opened while the
+ *    current one is still playing.
+ */
+struct SoundSources
+{
+   StorageSource storage; // SD card, internal flash or RAM disk, depending on the path
+   PackSource pack;
+   AudioFileSourcePROGMEM memory;
+   PrefetchSource prefetch;
+   TrimmedSource trimmed;
+};
+
+/**
+ * \brief Open the fastest source for a file
+ * \return Source to pass to the generator
+ */
+AudioFileSource* SoundPlayer::openSource(SoundSources& sources, const char* filename)
+{
+   // Sounds in the flash bank or RAM cache are played from there, without touching the SD card.
+   // Prefetched sounds start from RAM, the file is opened when the prefetched part is used up.
+   // Leading silence of trimmed sounds is skipped. The RAM caches hold them already trimmed, the sound bank
+   // is trimmed when it is packed (its files may be converted, so the offsets would not fit anyway).
+   // Other files are read from the storage layer, or from the sound pack if they are in there.
+   // Until the index is loaded (during the boot), files are played from storage as they are.
+   bool withIndex = indexLoaded.load(std::memory_order_acquire);
+   uint32_t packOffset, packLength;
+   AudioFileSource* file = withIndex && pack.find(filename, packOffset, packLength) ? (AudioFileSource*)&sources.pack
+                                                                                   : &sources.storage;
+   AudioFileSource* in = file;
+   const SoundTrim* trim = withIndex ? trims.find(filename) : nullptr;
+   uint32_t memoryLength;
+   const uint8_t* bankData = bank.find(filename, memoryLength);
+   const uint8_t* cachedData = bankData ? nullptr : soundCache.find(filename, memoryLength);
+   const PrefetchCache::Slot* prefetched = prefetchCache.find(filename);
+   if (bankData || cachedData)
+   {
+      sources.memory.open(bankData ? bankData : cachedData, memoryLength);
+      in = &sources.memory;
+      trim = nullptr;
+   }
+   else if (prefetched)
+   {
+      if (trim) sources.trimmed.wrap(file, trim);
+      sources.prefetch.open(prefetched, trim ? (AudioFileSource*)&sources.trimmed : file);
+      in = &sources.prefetch;
+      trim = nullptr;
+   }
+   else
+   {
+      file->open(filename);
+   }
+   if (trim)
+   {
+      sources.trimmed.wrap(in, trim);
+      in = &sources.trimmed;
+   }
+   return in;
+}
+
+void SoundPlayer::invalidateCached(const char* path)
+{
+   ESP_LOGI(TAG, "%s has changed, dropping cached data", path);
+   invalidateIndexes(path);
+   dropCachedData(path);
+}
+
+/**
+ * \brief Forget the trims and sound pack entries of changed files. They are only marked as removed, so this can be
+ *    done while the files are playing.
+ */
+void SoundPlayer::invalidateIndexes(const char* path)
+{
+   if (!indexLoaded.load(std::memory_order_acquire)) return;
+   trims.remove(path);
+   pack.remove(path);
+}
+
+/**
+ * \brief Drop the prefetched and cached data of changed files, not while they are playing
+ */
+void SoundPlayer::dropCachedData(const char* path)
+{
+   prefetchCache.invalidate(path);
+   soundCache.invalidate(path);
+}
+
+bool SoundPlayer::getPlaylistEntry(uint32_t id, int index, char* filename)
+{
+   xSemaphoreTake(playlistMutex, portMAX_DELAY);
+   bool found = id == playlistId && index < playlistCount;
+   if (found) strcpy(filename, playlist[index]);
+   xSemaphoreGive(playlistMutex);
+   return found;
+}
+
+[[noreturn]] void SoundPlayer::playbackHandler()
+{
+   int bootPhase = bootTimer.begin("i2s");
    AudioGeneratorWAV wav;
+   AudioGeneratorMP3 mp3;
+   ImaAdpcmGenerator adpcm;
+   SoundSources sourceSets[2];
+   for (auto& sources: sourceSets) sources.pack.setPack(&pack);
    AudioOutputI2S out;
    out.SetPinout(I2S_BCLK, I2S_LRC, I2S_DOUT);
+   // I2S is set up once with a fixed format, the generators only talk to the resampler
+   out.SetRate(SOUND_OUTPUT_RATE);
+   out.SetBitsPerSample(16);
+   out.SetChannels(2);
+   out.SetGain(1.0f); // Volume is applied per voice
    out.begin();
+   ToneVoice tones(SOUND_OUTPUT_RATE);
+   PcmRingBuffer ring(&out, DECODE_AHEAD_FRAMES, &tones);
+   ResampleOutput resampler(&ring, SOUND_OUTPUT_RATE);
+   // Above the playback task on its core, so the DMA is fed while the decoder waits for the card
+   TaskHandle_t pumpTask = ring.startPumpTask(SOUND_PUMP_TASK_STACK, 3, 0);
+   if (pumpTask) resourceMonitor.addTask(pumpTask, SOUND_PUMP_TASK_STACK);
+   else ESP_LOGW(TAG, "No pump task, the samples are moved to I2S by the playback task");
+   bool pumpHere = !pumpTask;
+   // The DMA sends silence until the first samples arrive, requests queued meanwhile are played now
+   ready = true;
+   bootTimer.end(bootPhase);
+
+   auto selectGenerator = [&](AudioFileSource* in, const char* filename) -> AudioGenerator*
+   {
+      if (hasExtension(filename, ".mp3")) return &mp3;
+      if (readWavFormatTag(in) == WAVE_FORMAT_IMA_ADPCM) return &adpcm;
+      return &wav;
+   };
+
+   // Changed files that were playing, the caches are cleaned up after the playback
+   char deferredInvalidations[SOUND_DEFERRED_INVALIDATIONS][SOUND_FILENAME_LEN];
+   int deferredCount = 0;
+   auto deferInvalidation = [&](const char* path)
+   {
+      // The trims and pack entries go right away, only the RAM copies have to wait
+      invalidateIndexes(path);
+      for (int i = 0; i < deferredCount; i++)
+      {
+         if (isInPath(path, deferredInvalidations[i])) return;
+      }
+      if (deferredCount == SOUND_DEFERRED_INVALIDATIONS)
+      {
+         // No slot left: all RAM copies are dropped then (every path is in "")
+         deferredInvalidations[0][0] = '\0';
+         deferredCount = 1;
+         return;
+      }
+      strlcpy(deferredInvalidations[deferredCount++], path, SOUND_FILENAME_LEN);
+   };
+   auto invalidateDeferred = [&]()
+   {
+      for (int i = 0; i < deferredCount; i++) dropCachedData(deferredInvalidations[i]);
+      deferredCount = 0;
+   };
 
    while (true)
    {
       SoundRequest currentRequest{};
-      // Wait for a new request to arrive
-      if (xQueueReceive(playQueue, &currentRequest, portMAX_DELAY))
+      // Wait for a new request to arrive. Without the pump task, keep the sample clock running while tones are
+      // scheduled.
+      bool busy = (pumpHere && tones.isActive()) || soundCache.hasWork() || prefetchCache.hasWork();
+      if (!xQueueReceive(playQueue, &currentRequest, busy ? pdMS_TO_TICKS(1) : portMAX_DELAY))
+      {
+         if (pumpHere) ring.pump();
+         if (!soundCache.loadNext(nullptr)) prefetchCache.loadNext(nullptr);
+         continue;
+      }
+      if (currentRequest.type == SOUND_REQUEST_INVALIDATE)
+      {
+         invalidateCached(currentRequest.filename);
+         continue;
+      }
+      if (currentRequest.type != SOUND_REQUEST_PLAYBACK)
       {
-         play:
-         ESP_LOGI(TAG, "%lu: Playback of %s (prio %i, vol %i%%)", millis(), currentRequest.filename, currentRequest.prio, currentRequest.volume);
+         ring.lock();
+         handleCountdownRequest(currentRequest, tones, ring.getClock());
+         ring.unlock();
+         if (pumpHere) ring.pump();
+         continue;
+      }
+
+      play:
+      TRACE_BEGIN("playing");
+      DLOGI(TAG, "Playback of %s (prio %i, vol %i%%)", currentRequest.filename, currentRequest.prio, currentRequest.volume);
+
+      sdBus.setBuffered(0);
+      sdBus.setPlaying(true);
+      resampler.SetGain((float)currentRequest.volume / 100.0f);
+      ring.clear();
+      ring.resetFramesIn();
 
-         out.SetGain((float)currentRequest.volume / 100.0f);
+      SoundSources* current = &sourceSets[0];
+      SoundSources* next = &sourceSets[1];
+      TRACE_BEGIN("open");
+      AudioFileSource* in = openSource(*current, currentRequest.filename);
+      AudioGenerator* gen = selectGenerator(in, currentRequest.filename);
+      uint32_t heapBefore = ESP.getFreeHeap();
+      gen->begin(in, &resampler);
+      uint32_t decoderHeap = heapBefore - ESP.getFreeHeap();
+      // A prefetched start is played before its file is opened, the decoder stops at the end of the first part
+      ring.setInputLimit(current->prefetch.needsFile() ? PREFETCH_FIRST_FRAMES : UINT32_MAX);
+      TRACE_END("open");
+      uint64_t decodeCycles = 0;
+      int currentPrio = currentRequest.prio;
+      char currentPlayback[SOUND_FILENAME_LEN];
+      strcpy(currentPlayback, currentRequest.filename);
 
-         auto in = AudioFileSourceSD(currentRequest.filename);
-         wav.begin(&in, &out);
-         int currentPrio = currentRequest.prio;
-         char currentPlayback[128];
-         strcpy(currentPlayback, currentRequest.filename);
+      // Next file of the playlist, opened ahead so it follows without a gap
+      uint32_t currentPlaylist = currentRequest.playlistId;
+      int playlistIndex = 1;
+      char nextPlayback[SOUND_FILENAME_LEN];
+      AudioFileSource* nextIn = nullptr;
+      AudioGenerator* nextGen = nullptr;
 
-         while (wav.isRunning())
+      // Keep going until the decoded samples in the ring are played as well (and the playlist is done)
+      while (gen->isRunning() || !ring.isEmpty() || currentPlaylist)
+      {
+         if (xQueueReceive(playQueue, &currentRequest, 0))
          {
-            if (xQueueReceive(playQueue, &currentRequest, 0))
+            if (currentRequest.type == SOUND_REQUEST_INVALIDATE)
             {
-               // Request same playback again = stop
-               if (strcmp(currentRequest.filename, currentPlayback) == 0)
+               // The sources of the playing files may point into the cached data
+               if (isInPath(currentPlayback, currentRequest.filename) ||
+                   (nextIn && isInPath(nextPlayback, currentRequest.filename)))
                {
-                  break;
+                  deferInvalidation(currentRequest.filename);
                }
-               // Cancel by higher or same prio playback
-               if (currentRequest.prio <= currentPrio) {
-                  ESP_LOGD(TAG, "current playback cancelled by other playback");
-                  goto play; // i know you shouldn't but hee hee
+               else
+               {
+                  invalidateCached(currentRequest.filename);
                }
             }
-            wav.loop();
-            delay(1);
+            else if (currentRequest.type != SOUND_REQUEST_PLAYBACK)
+            {
+               ring.lock();
+               handleCountdownRequest(currentRequest, tones, ring.getClock());
+               ring.unlock();
+            }
+            // Request same playback again = stop
+            else if (strcmp(currentRequest.filename, currentPlayback) == 0)
+            {
+               ring.clear();
+               break;
+            }
+            // Cancel by higher or same prio playback
+            else if (currentRequest.prio <= currentPrio) {
+               DLOGD(TAG, "current playback cancelled by other playback");
+               gen->stop();
+               in->close();
+               if (nextIn) nextIn->close();
+               invalidateDeferred();
+               TRACE_END("playing");
+               goto play; // i know you shouldn't but hee hee
+            }
+         }
+         if (gen->isRunning())
+         {
+            // The file behind a prefetched start is opened here once its first part is out, the decoder must not
+            // allocate. The next file of a playlist is opened right away, the ring still holds this one.
+            if (current->prefetch.needsFile() && ring.getFramesIn() >= PREFETCH_FIRST_FRAMES)
+            {
+               current->prefetch.openFile();
+               ring.setInputLimit(UINT32_MAX);
+            }
+            // Decode ahead until the ring is full
+            NO_ALLOC_SCOPE("decode");
+            TRACE_BEGIN("decode");
+            uint32_t start = ESP.getCycleCount();
+            gen->loop();
+            decodeCycles += ESP.getCycleCount() - start;
+            TRACE_END("decode");
+         }
+         else if (currentPlaylist)
+         {
+            // Start the next file right away, its samples follow the last ones of this file in the ring
+            if (!nextIn && getPlaylistEntry(currentPlaylist, playlistIndex, nextPlayback))
+            {
+               nextIn = openSource(*next, nextPlayback);
+               nextGen = selectGenerator(nextIn, nextPlayback);
+            }
+            gen->stop();
+            in->close();
+            if (nextIn)
+            {
+               DLOGD(TAG, "Playlist continues with %s", nextPlayback);
+               std::swap(current, next);
+               in = nextIn;
+               gen = nextGen;
+               nextIn = nullptr;
+               playlistIndex++;
+               strcpy(currentPlayback, nextPlayback);
+               gen->begin(in, &resampler);
+               continue;
+            }
+            currentPlaylist = 0;
+         }
+         // Right after decoding as well, a new playback starts without waiting for the pump task
+         TRACE_BEGIN("i2s");
+         ring.pump();
+         TRACE_END("i2s");
+         sdBus.setBuffered(ring.getCount() * 1000 / SOUND_OUTPUT_RATE);
+         if (ring.isFull())
+         {
+            // Enough audio is buffered: open the next file of the playlist ahead, otherwise fill the caches.
+            // The caches have to wait until the next file has started, they could drop the data it uses.
+            if (currentPlaylist && !nextIn && getPlaylistEntry(currentPlaylist, playlistIndex, nextPlayback))
+            {
+               nextIn = openSource(*next, nextPlayback);
+               nextGen = selectGenerator(nextIn, nextPlayback);
+            }
+            else if (!nextIn && !soundCache.loadNext(currentPlayback))
+            {
+               prefetchCache.loadNext(currentPlayback);
+            }
          }
-         wav.stop();
-         ESP_LOGD(TAG, "Finish playback");
+         delay(1);
       }
+      gen->stop();
+      in->close();
+      if (nextIn) nextIn->close();
+      invalidateDeferred();
+      sdBus.setPlaying(false);
+      TRACE_END("playing");
+
+      uint32_t framesIn = ring.getFramesIn();
+      uint64_t decodeUs = decodeCycles / ESP.getCpuFreqMHz();
+      DLOGD(TAG, "Finish playback (decoder: %luus CPU per second of audio, %lu bytes heap)",
+            framesIn ? (unsigned long)(decodeUs * SOUND_OUTPUT_RATE / framesIn) : 0UL, (unsigned long)decoderHeap);
    }
 }
 
+bool SoundPlayer::listPackedSounds(const char* prefix, std::vector<std::string>& filenames) const
+{
+   return pack.list(prefix, filenames);
+}
+
 void SoundPlayer::begin()
 {
-   playQueue = xQueueCreate(2, sizeof(SoundRequest));
-   xTaskCreatePinnedToCore(playbackHandlerStub, "PlaybackTask", 8192, this, 2 | portPRIVILEGE_BIT, &playbackTask, 0);
+   bank.begin();
+   prefetchCache.begin(&trims);
+   soundCache.begin(&trims);
+   playlistMutex = xSemaphoreCreateMutex();
+   playQueue = xQueueCreate(4, sizeof(SoundRequest));
+   if (xTaskCreatePinnedToCore(playbackHandlerStub, "PlaybackTask", SOUND_TASK_STACK, this, 2 | portPRIVILEGE_BIT,
+                               &playbackTask, 0) == pdPASS)
+   {
+      resourceMonitor.addTask(playbackTask, SOUND_TASK_STACK);
+   }
+}
+
+void SoundPlayer::loadIndex()
+{
+   trims.load();
+   pack.begin();
+   indexLoaded.store(true, std::memory_order_release);
 }
 
 
@@ -5,41 +5,163 @@
 #ifndef ESP32_BUZZER_SOUNDS_H
 #define ESP32_BUZZER_SOUNDS_H
 
+#include <atomic>
 #include <string>
 #include <Arduino.h>
+#include "audio/soundBank.h"
+#include "audio/prefetchCache.h"
+#include "audio/soundCache.h"
+#include "audio/soundTrim.h"
+#include "audio/soundPack.h"
+#include <vector>
 
-#define SOUND_TIMER_BEEP "/buzzer/countdown_beep_short.wav"
-#define SOUND_TIMER_END  "/buzzer/countdown_beep_long.wav"
 #define SOUND_TIMER_START  "/buzzer/ding.wav"
 #define SOUNDS_RANDOM  {"/random/egon_kurz.wav", "/random/egon_komplett.wav", "/random/time-for-a-drink.wav"}
 #define SOUNDS_RANDOM_NAMES  {"Egon Kurz", "Egon Lang", "TimeForDrink"}
 #define SOUNDS_RANDOM_COUNT  3
 
 #define SOUND_PRIO_BUZZER_START 3 // high enough to stop a soundboard sound
-#define SOUND_PRIO_BUZZER_BEEP 5 // low enough to be stopped by a soundboard sound
-#define SOUND_PRIO_BUZZER_END 5
 #define SOUND_PRIO_SOUNDBOARD 4
 #define SOUND_PRIO_RANDOM 4
 
+#define SOUND_OUTPUT_RATE 44100 // I2S runs at this rate, files with other rates are resampled
+#define SOUND_FILENAME_LEN 128
+#define SOUND_PLAYLIST_LEN 8
+#define SOUND_DEFERRED_INVALIDATIONS 4 // Changed paths of playing files, kept until the playback has finished
+#define SOUND_TASK_STACK 8192 // Bytes, see the debug screen for what is left
+#define SOUND_PUMP_TASK_STACK 2048 // Bytes, moves the decoded samples to I2S
+
+// Countdown tones from the synthesizer, mixed over any playback: frequency (Hz), duration, attack, release (ms)
+#define TONE_TIMER_BEEP { 1000, 120, 5, 40 }
+#define TONE_TIMER_END  { 1000, 800, 5, 300 }
+
+struct SoundSources;
+
 class SoundPlayer
 {
 private:
    xQueueHandle playQueue;
    xTaskHandle playbackTask{};
+   SoundBank bank;
+   PrefetchCache prefetchCache;
+   SoundCache soundCache;
+   TrimIndex trims; // Loaded in loadIndex(), entries are only removed by the playback task
+   SoundPack pack; // Loaded in loadIndex(), read-only afterwards
+   std::atomic<bool> indexLoaded{ false }; // The playback task uses trims and pack only once they are loaded
+   std::atomic<bool> ready{ false }; // I2S is running
+
+   // Set by the UI task, read by the playback task, which only plays the playlist with the id it was started with
+   SemaphoreHandle_t playlistMutex = nullptr;
+   char playlist[SOUND_PLAYLIST_LEN][SOUND_FILENAME_LEN]{};
+   int playlistCount = 0;
+   uint32_t playlistId = 0;
+   uint32_t requestCount = 0;
+
    static void playbackHandlerStub(void* param);
    [[noreturn]] void playbackHandler();
+   AudioFileSource* openSource(SoundSources& sources, const char* filename);
+   bool getPlaylistEntry(uint32_t id, int index, char* filename);
+   void invalidateCached(const char* path);
+   void invalidateIndexes(const char* path);
+   void dropCachedData(const char* path);
 public:
+   /**
+    * \brief Set up the queue and the caches and start the playback task, which sets up I2S. Needs no storage.
+    */
    void begin();
 
+   /**
+    * \brief Load the trim index and the sound pack from the SD card, once it is mounted (may be another task).
+    *    Until then files are played without trimming and not from the pack.
+    */
+   void loadIndex();
+
+   /**
+    * \brief Whether the playback task has set up I2S, requests before that are played when it is done
+    */
+   bool isReady() const { return ready; }
+
    /**
     * \brief Request playback of a file
     * \param filename Filename to be played
     * \param prio Priority (lower number = higher prio)
     * \param volume Volume in percent
+    * \return false if the request was dropped, because the queue stayed full (or the volume is 0)
+    */
+   bool requestPlayback(const char* filename, int prio, uint8_t volume);
+
+   /**
+    * \brief Request playback of several files one after the other without gaps.
+    *    The next file is opened while the previous one is still playing. Stopping or cancelling the playback
+    *    (like requestPlayback) stops the whole playlist.
+    * \param filenames Filenames in playback order
+    * \param count Number of filenames (max SOUND_PLAYLIST_LEN)
+    * \param prio Priority (lower number = higher prio)
+    * \param volume Volume in percent
+    * \return false if the request was dropped, see requestPlayback()
+    */
+   bool requestPlaylist(const char* const filenames[], int count, int prio, uint8_t volume);
+
+   /**
+    * \brief Set the sounds that are likely requested next (e.g. the visible soundboard page).
+    *    Their start is loaded into RAM in the background, so playback starts without SD access.
+    *    A new call replaces the previous set.
+    * \param filenames Filenames, empty strings are ignored
+    * \param count Number of filenames (max PREFETCH_SLOTS)
+    */
+   void prefetch(const char* const filenames[], int count);
+
+   /**
+    * \brief Set the sounds that are kept completely in RAM (e.g. the most played ones), loaded in the background.
+    *    A new call replaces the previous set.
+    * \param filenames Filenames, most important first
+    * \param count Number of filenames (max SOUND_CACHE_SLOTS)
+    */
+   void preload(const char* const filenames[], int count);
+
+   /**
+    * \brief Drop everything that is kept about files that have changed (trim, prefetched and cached data).
+    *    If one of them is playing, this is done when the playback has finished, it is not interrupted.
+    * \param path File or directory
+    */
+   void invalidate(const char* path);
+
+   /**
+    * \brief Start the answer countdown: a beep every second and the end tone when the time is up.
+    *    The tones are placed on the output sample clock, so they are exactly one second apart.
+    * \param timeToAnswerMs Answer time in ms from now
+    * \param beepVolume Volume of the beeps in percent
+    * \param endVolume Volume of the end tone in percent
     */
-   void requestPlayback(const std::string& filename, int prio, uint8_t volume);
+   void startCountdown(uint32_t timeToAnswerMs, uint8_t beepVolume, uint8_t endVolume);
+
+   /**
+    * \brief Cancel a running countdown and play the end tone right away
+    * \param endVolume Volume of the end tone in percent, 0 to cancel silently
+    */
+   void stopCountdown(uint8_t endVolume);
+
+   /**
+    * \brief List the sounds in the packed sound library (see soundPack.h)
+    * \param prefix Only sounds whose name starts with this, e.g. "/soundboard/"
+    * \param[out] filenames Filenames are appended
+    * \return false if there is no pack, the sounds are in their directories then
+    */
+   bool listPackedSounds(const char* prefix, std::vector<std::string>& filenames) const;
+
+   /**
+    * \brief Number of playback and playlist requests so far (for input traces), counts up from the UI task only
+    */
+   uint32_t getRequestCount() const { return requestCount; }
 };
 
 extern SoundPlayer soundPlayer;
 
+/**
+ * \brief Check if the file type can be played (WAV or MP3)
+ * \param filename Filename with extension
+ * \return true if the file can be played
+ */
+bool isSupportedSoundFile(const std::string& filename);
+
 #endif //ESP32_BUZZER_SOUNDS_H
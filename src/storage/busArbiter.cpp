@@ -0,0 +1,66 @@
+/*
+ * SD bus arbiter
+ */
+
+#include "busArbiter.h"
+#include <Arduino.h>
+
+BusArbiter sdBus;
+
+void BusArbiter::setPlaying(bool isPlaying)
+{
+   playing = isPlaying;
+}
+
+void BusArbiter::account(BusClient client, uint32_t bytes, uint32_t us)
+{
+   this->bytes[client].fetch_add(bytes, std::memory_order_relaxed);
+   busyUs[client].fetch_add(us, std::memory_order_relaxed);
+}
+
+void BusArbiter::waitForFtp()
+{
+   // A playback that has just started or is behind gets the bus first
+   uint32_t waitedMs = 0;
+   while (isPlaying() && bufferedMs.load(std::memory_order_relaxed) < BUS_FTP_MIN_BUFFERED_MS &&
+          waitedMs < BUS_MAX_THROTTLE_MS)
+   {
+      delay(1);
+      waitedMs++;
+   }
+   if (!waitedMs) return;
+   throttleUs.fetch_add(waitedMs * 1000, std::memory_order_relaxed);
+   throttleCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BusArbiter::throttleFtp(uint32_t bytes, uint32_t busyUs)
+{
+   account(BUS_CLIENT_FTP, bytes, busyUs);
+   if (!isPlaying())
+   {
+      ftpDebtUs = 0;
+      return;
+   }
+
+   // Pause so that the accesses take only the allowed share of the time
+   ftpDebtUs += busyUs * (100 - BUS_FTP_SHARE_PERCENT) / BUS_FTP_SHARE_PERCENT;
+   if (ftpDebtUs < 1000) return;
+   uint32_t pauseMs = min(ftpDebtUs / 1000, (uint32_t)BUS_MAX_THROTTLE_MS);
+   delay(pauseMs);
+   ftpDebtUs = ftpDebtUs > pauseMs * 1000 ? min(ftpDebtUs - pauseMs * 1000, (uint32_t)BUS_MAX_THROTTLE_MS * 1000) : 0;
+   throttleUs.fetch_add(pauseMs * 1000, std::memory_order_relaxed);
+   throttleCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+BusStats BusArbiter::getStats() const
+{
+   BusStats stats{};
+   for (int i = 0; i < BUS_CLIENT_COUNT; i++)
+   {
+      stats.bytes[i] = bytes[i].load(std::memory_order_relaxed);
+      stats.busyUs[i] = busyUs[i].load(std::memory_order_relaxed);
+   }
+   stats.throttleUs = throttleUs.load(std::memory_order_relaxed);
+   stats.throttleCount = throttleCount.load(std::memory_order_relaxed);
+   return stats;
+}
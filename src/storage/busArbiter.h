@@ -0,0 +1,88 @@
+/*
+ * SD bus arbiter
+ * Sound playback and the FTP server share the SPI bus of the SD card. While a sound is playing, FTP may only use
+ * a share of the time: the reads and writes of an FTP file are split into chunks of BUS_FTP_CHUNK_BYTES
+ * (fsWatch.cpp). A chunk only starts while the player has enough audio buffered, it is timed and the FTP task is
+ * delayed accordingly afterwards, so a large transfer can't starve the playback. Also counts how the bus is used.
+ */
+
+#ifndef ESP32_BUZZER_BUSARBITER_H
+#define ESP32_BUZZER_BUSARBITER_H
+
+#include <atomic>
+#include <cstdint>
+
+#define BUS_FTP_SHARE_PERCENT 20 // Time share of FTP while a sound is playing
+#define BUS_MAX_THROTTLE_MS 200 // Longest delay of FTP before or after a single access
+#define BUS_FTP_CHUNK_BYTES 4096 // Longest single FTP access
+#define BUS_FTP_MIN_BUFFERED_MS 100 // FTP waits while the player has less audio buffered
+
+enum BusClient
+{
+   BUS_CLIENT_PLAYER, // SoundPlayer and everything else going through the storage layer
+   BUS_CLIENT_FTP,
+   BUS_CLIENT_COUNT
+};
+
+// Counters since boot, they wrap around (bytes at 4GB, times after 71 minutes of access)
+struct BusStats
+{
+   uint32_t bytes[BUS_CLIENT_COUNT]; // Bytes read (FTP: read and written)
+   uint32_t busyUs[BUS_CLIENT_COUNT]; // Time spent in file access
+   uint32_t throttleUs; // Time FTP was held back for the playback (before and after accesses)
+   uint32_t throttleCount;
+};
+
+class BusArbiter
+{
+private:
+   volatile bool playing = false;
+   std::atomic<uint32_t> bufferedMs{ 0 };
+   // Counted by the playback, FTP and loop tasks. Each counter is atomic, a snapshot may mix counters of
+   // slightly different times, they are only statistics.
+   std::atomic<uint32_t> bytes[BUS_CLIENT_COUNT]{};
+   std::atomic<uint32_t> busyUs[BUS_CLIENT_COUNT]{};
+   std::atomic<uint32_t> throttleUs{ 0 };
+   std::atomic<uint32_t> throttleCount{ 0 };
+   uint32_t ftpDebtUs = 0; // Pause FTP still owes, FTP task only
+
+public:
+   /**
+    * \brief Mark a playback as running or finished, FTP is throttled while one is running
+    */
+   void setPlaying(bool isPlaying);
+   bool isPlaying() const { return playing; }
+
+   /**
+    * \brief Tell how much audio the player has decoded ahead (playback task)
+    */
+   void setBuffered(uint32_t ms) { bufferedMs.store(ms, std::memory_order_relaxed); }
+
+   /**
+    * \brief Wait before an FTP access until the player has BUS_FTP_MIN_BUFFERED_MS buffered, at most
+    *    BUS_MAX_THROTTLE_MS (FTP task). Does not wait while no sound is playing.
+    */
+   void waitForFtp();
+
+   /**
+    * \brief Count a file access
+    * \param client Who accessed the bus
+    * \param bytes Bytes transferred
+    * \param us Duration of the access
+    */
+   void account(BusClient client, uint32_t bytes, uint32_t us);
+
+   /**
+    * \brief Count an FTP file access and wait after it so FTP stays within its share while a sound is playing
+    *    (FTP task). Short accesses add up until the pause is at least 1ms.
+    * \param bytes Bytes read or written
+    * \param busyUs Duration of the access
+    */
+   void throttleFtp(uint32_t bytes, uint32_t busyUs);
+
+   BusStats getStats() const;
+};
+
+extern BusArbiter sdBus;
+
+#endif //ESP32_BUZZER_BUSARBITER_H
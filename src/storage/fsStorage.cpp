@@ -0,0 +1,101 @@
+/*
+ * Storage backend for Arduino file systems (SD, LittleFS)
+ */
+
+#include "fsStorage.h"
+#include "tracePoints.h"
+#include "allocCounter.h"
+#include <atomic>
+#include <new>
+#include <esp_timer.h>
+
+class FsFile : public StorageFile
+{
+private:
+   mutable File file;
+   BusArbiter* bus;
+
+public:
+   FsFile(File f, BusArbiter* bus) : file(f), bus(bus) {}
+   ~FsFile() override { file.close(); }
+
+   // A file is opened for every playback, the wrappers come from a fixed pool instead of the heap. The File inside
+   // allocates when it is opened, see FsStorage::open()
+   static void* operator new(size_t size);
+   static void operator delete(void* p);
+
+   size_t read(uint8_t* data, size_t len) override
+   {
+      if (!bus) return file.read(data, len);
+      TRACE_SCOPE("sd read");
+      int64_t start = esp_timer_get_time();
+      size_t n = file.read(data, len);
+      bus->account(BUS_CLIENT_PLAYER, n, (uint32_t)(esp_timer_get_time() - start));
+      return n;
+   }
+
+   bool seek(uint32_t pos) override { return file.seek(pos); }
+   uint32_t position() const override { return file.position(); }
+   uint32_t size() const override { return file.size(); }
+};
+
+namespace
+{
+   alignas(FsFile) uint8_t filePool[FS_STORAGE_FILE_POOL][sizeof(FsFile)];
+   std::atomic<bool> filePoolUsed[FS_STORAGE_FILE_POOL]{};
+}
+
+void* FsFile::operator new(size_t size)
+{
+   for (int i = 0; i < FS_STORAGE_FILE_POOL; i++)
+   {
+      bool expected = false;
+      if (filePoolUsed[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) return filePool[i];
+   }
+   // More files open than expected, still works
+   return ::operator new(size);
+}
+
+void FsFile::operator delete(void* p)
+{
+   for (int i = 0; i < FS_STORAGE_FILE_POOL; i++)
+   {
+      if (p == filePool[i])
+      {
+         filePoolUsed[i].store(false, std::memory_order_release);
+         return;
+      }
+   }
+   ::operator delete(p);
+}
+
+StorageFilePtr FsStorage::open(const char* path)
+{
+   TRACE_SCOPE("open file");
+   int64_t start = esp_timer_get_time();
+   File f;
+   {
+      // The VFS file object, its FILE and the stdio buffer are allocated by the file system library
+      ALLOC_EXEMPT_SCOPE("file open");
+      f = fileSystem.open(path);
+   }
+   if (bus) bus->account(BUS_CLIENT_PLAYER, 0, (uint32_t)(esp_timer_get_time() - start));
+   if (!f || f.isDirectory()) return nullptr;
+   return StorageFilePtr(new FsFile(f, bus));
+}
+
+bool FsStorage::list(const char* dir, std::vector<StorageEntry>& entries)
+{
+   File root = fileSystem.open(dir);
+   if (!root || !root.isDirectory()) return false;
+   while (File f = root.openNextFile())
+   {
+      entries.push_back({ f.name(), f.isDirectory(), (uint32_t)f.size() });
+   }
+   return true;
+}
+
+bool FsStorage::exists(const char* path)
+{
+   return fileSystem.exists(path);
+}
@@ -0,0 +1,32 @@
+/*
+ * Storage backend for Arduino file systems (SD, LittleFS)
+ */
+
+#ifndef ESP32_BUZZER_FSSTORAGE_H
+#define ESP32_BUZZER_FSSTORAGE_H
+
+#include "storage.h"
+#include "busArbiter.h"
+#include <FS.h>
+
+#define FS_STORAGE_FILE_POOL 4 // File wrappers open at once without using the heap: two per playback, the cache loads
+
+class FsStorage : public StorageBackend
+{
+private:
+   fs::FS& fileSystem;
+   BusArbiter* bus;
+
+public:
+   /**
+    * \param fileSystem Arduino file system
+    * \param bus Arbiter of the bus the file system is on, to account the accesses (optional)
+    */
+   explicit FsStorage(fs::FS& fileSystem, BusArbiter* bus = nullptr) : fileSystem(fileSystem), bus(bus) {}
+   StorageFilePtr open(const char* path) override;
+   bool list(const char* dir, std::vector<StorageEntry>& entries) override;
+   bool exists(const char* path) override;
+   fs::FS* getFS() override { return &fileSystem; }
+};
+
+#endif //ESP32_BUZZER_FSSTORAGE_H
@@ -0,0 +1,152 @@
+/*
+ * Change notifications for a file system written by the FTP server
+ */
+
+#include "fsWatch.h"
+#include "storage.h"
+#include "busArbiter.h"
+#include <vfs_api.h>
+#include <esp_timer.h>
+
+static const char* TAG = "fsWatch";
+FsWatch sdWatch;
+
+/**
+ * \brief File of the FTP server. Reads and writes are split into chunks, each one waits until the player can spare
+ *    the SD bus and is counted and throttled while a sound plays.
+ */
+class FtpFileImpl : public VFSFileImpl
+{
+public:
+   FtpFileImpl(VFSImpl* fs, const char* path, const char* mode) : VFSFileImpl(fs, path, mode) {}
+
+   size_t read(uint8_t* buf, size_t size) override
+   {
+      size_t done = 0;
+      while (done < size)
+      {
+         size_t len = min(size - done, (size_t)BUS_FTP_CHUNK_BYTES);
+         sdBus.waitForFtp();
+         int64_t start = esp_timer_get_time();
+         size_t n = VFSFileImpl::read(buf + done, len);
+         sdBus.throttleFtp(n, (uint32_t)(esp_timer_get_time() - start));
+         done += n;
+         if (n < len) break;
+      }
+      return done;
+   }
+
+   size_t write(const uint8_t* buf, size_t size) override
+   {
+      size_t done = 0;
+      while (done < size)
+      {
+         size_t len = min(size - done, (size_t)BUS_FTP_CHUNK_BYTES);
+         sdBus.waitForFtp();
+         int64_t start = esp_timer_get_time();
+         size_t n = VFSFileImpl::write(buf + done, len);
+         sdBus.throttleFtp(n, (uint32_t)(esp_timer_get_time() - start));
+         done += n;
+         if (n < len) break;
+      }
+      return done;
+   }
+};
+
+/**
+ * \brief VFS that reports the changes to the watch, the files themselves are handled by the VFS as usual
+ */
+class WatchedVFSImpl : public VFSImpl
+{
+private:
+   FsWatch& watch;
+
+public:
+   WatchedVFSImpl(const char* mountpoint, FsWatch& watch) : watch(watch)
+   {
+      VFSImpl::mountpoint(mountpoint);
+   }
+
+   FileImplPtr open(const char* path, const char* mode, const bool create) override
+   {
+      FileImplPtr file = VFSImpl::open(path, mode, create);
+      if (!file) return file;
+      if (!file->isDirectory())
+      {
+         // VFSImpl::open() has checked the path and created missing directories. The file is opened again, so its
+         // transfers go through the bus arbiter (a second "w" only truncates the now empty file again).
+         file->close();
+         file = std::make_shared<FtpFileImpl>(this, path, mode);
+         if (!*file) return FileImplPtr();
+      }
+      if (mode[0] == 'r') return file;
+
+      // Written files are reported when the last reference is gone (File::close() or destructor), the upload is
+      // complete then
+      std::string filePath = path;
+      FsWatch* w = &watch;
+      return FileImplPtr(file.get(), [file, filePath, w](fs::FileImpl*)
+      {
+         file->close();
+         w->report(FS_CHANGE_WRITTEN, filePath.c_str());
+      });
+   }
+
+   bool rename(const char* pathFrom, const char* pathTo) override
+   {
+      if (!VFSImpl::rename(pathFrom, pathTo)) return false;
+      watch.report(FS_CHANGE_RENAMED, pathFrom, pathTo);
+      return true;
+   }
+
+   bool remove(const char* path) override
+   {
+      if (!VFSImpl::remove(path)) return false;
+      watch.report(FS_CHANGE_REMOVED, path);
+      return true;
+   }
+
+   bool rmdir(const char* path) override
+   {
+      if (!VFSImpl::rmdir(path)) return false;
+      watch.report(FS_CHANGE_REMOVED, path);
+      return true;
+   }
+};
+
+void FsWatch::begin(const char* mountpoint, const char* watchedDir)
+{
+   dir = watchedDir;
+   queue = xQueueCreate(FS_WATCH_QUEUE_LEN, sizeof(FsChange));
+   fileSystem.reset(new fs::FS(fs::FSImplPtr(new WatchedVFSImpl(mountpoint, *this))));
+}
+
+void FsWatch::report(FsChangeType type, const char* path, const char* newPath)
+{
+   if (!queue) return;
+   if (!isInPath(path, dir.c_str()) && !(newPath && isInPath(newPath, dir.c_str()))) return;
+
+   FsChange change{};
+   change.type = type;
+   strlcpy(change.path, path, FS_WATCH_PATH_LEN);
+   if (newPath) strlcpy(change.newPath, newPath, FS_WATCH_PATH_LEN);
+   if (xQueueSend(queue, &change, 0) != pdTRUE)
+   {
+      ESP_LOGW(TAG, "Change queue full, %s is lost", path);
+      overflow = true;
+      return;
+   }
+   ESP_LOGD(TAG, "Change %d of %s %s", type, path, change.newPath);
+}
+
+bool FsWatch::getChange(FsChange& change)
+{
+   return queue && xQueueReceive(queue, &change, 0) == pdTRUE;
+}
+
+bool FsWatch::takeOverflow()
+{
+   if (!overflow) return false;
+   overflow = false;
+   return true;
+}
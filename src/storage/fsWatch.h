@@ -0,0 +1,77 @@
+/*
+ * Change notifications for a file system written by the FTP server
+ * The FTP server library has no hooks for finished transfers, so it gets a file system that forwards everything
+ * to the VFS of the card and reports completed uploads (STOR, when the file is closed), deletions (DELE, RMD) and
+ * renames (RNTO) below a watched directory. The changes are queued for the UI task, which updates only what is
+ * affected instead of reading the whole card again. Reads and writes of its files are throttled on the SD bus while
+ * a sound plays (busArbiter.h).
+ */
+
+#ifndef ESP32_BUZZER_FSWATCH_H
+#define ESP32_BUZZER_FSWATCH_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <memory>
+#include <string>
+
+#define FS_WATCH_PATH_LEN 128
+#define FS_WATCH_QUEUE_LEN 8
+
+enum FsChangeType
+{
+   FS_CHANGE_WRITTEN, // File was uploaded (or otherwise written) and closed
+   FS_CHANGE_REMOVED, // File or directory was removed
+   FS_CHANGE_RENAMED, // File or directory was renamed to newPath
+};
+
+struct FsChange
+{
+   FsChangeType type;
+   char path[FS_WATCH_PATH_LEN]; // Path in the file system, e.g. "/soundboard/1_Foo/1_bar.wav"
+   char newPath[FS_WATCH_PATH_LEN]; // Renames only
+};
+
+class FsWatch
+{
+private:
+   QueueHandle_t queue = nullptr;
+   std::string dir;
+   std::unique_ptr<fs::FS> fileSystem;
+   volatile bool overflow = false;
+
+public:
+   /**
+    * \brief Create the watched file system
+    * \param mountpoint VFS mountpoint of the file system to watch, e.g. "/sd" for SD
+    * \param dir Only changes in this directory (and below) are reported, without trailing "/"
+    */
+   void begin(const char* mountpoint, const char* dir);
+
+   /**
+    * \return File system to hand to the FTP server, nullptr before begin()
+    */
+   fs::FS* getFS() { return fileSystem.get(); }
+
+   /**
+    * \brief Queue a change if it is in the watched directory (FTP task)
+    * \param newPath New path for renames, nullptr otherwise
+    */
+   void report(FsChangeType type, const char* path, const char* newPath = nullptr);
+
+   /**
+    * \brief Get the next change (UI task)
+    * \return false if there is none
+    */
+   bool getChange(FsChange& change);
+
+   /**
+    * \brief Check if changes were lost because the queue was full, resets the flag (UI task)
+    * \return true if everything has to be read again
+    */
+   bool takeOverflow();
+};
+
+extern FsWatch sdWatch;
+
+#endif //ESP32_BUZZER_FSWATCH_H
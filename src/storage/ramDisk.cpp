@@ -0,0 +1,95 @@
+/*
+ * Storage backend that keeps the files in RAM
+ */
+
+#include "ramDisk.h"
+#include <algorithm>
+#include <cstring>
+
+class RamFile : public StorageFile
+{
+private:
+   const std::vector<uint8_t>& content;
+   uint32_t pos = 0;
+
+public:
+   explicit RamFile(const std::vector<uint8_t>& content) : content(content) {}
+
+   size_t read(uint8_t* data, size_t len) override
+   {
+      size_t n = std::min(len, content.size() - pos);
+      memcpy(data, content.data() + pos, n);
+      pos += n;
+      return n;
+   }
+
+   bool seek(uint32_t newPos) override
+   {
+      if (newPos > content.size()) return false;
+      pos = newPos;
+      return true;
+   }
+
+   uint32_t position() const override { return pos; }
+   uint32_t size() const override { return content.size(); }
+};
+
+const RamDisk::RamFileData* RamDisk::find(const char* path) const
+{
+   for (const auto& file: files)
+   {
+      if (file.path == path) return &file;
+   }
+   return nullptr;
+}
+
+void RamDisk::addFile(const char* path, const uint8_t* data, size_t size)
+{
+   removeFile(path);
+   files.push_back({ path, std::vector<uint8_t>(data, data + size) });
+}
+
+bool RamDisk::removeFile(const char* path)
+{
+   auto it = std::find_if(files.begin(), files.end(), [&](const RamFileData& f) { return f.path == path; });
+   if (it == files.end()) return false;
+   files.erase(it);
+   return true;
+}
+
+StorageFilePtr RamDisk::open(const char* path)
+{
+   // Open files refer to the content, it must not be replaced or removed while they are open
+   const RamFileData* file = find(path);
+   return file ? StorageFilePtr(new RamFile(file->content)) : nullptr;
+}
+
+bool RamDisk::list(const char* dir, std::vector<StorageEntry>& entries)
+{
+   std::string prefix = dir;
+   if (prefix.empty() || prefix.back() != '/') prefix += '/';
+   size_t firstEntry = entries.size();
+   bool found = prefix == "/";
+   for (const auto& file: files)
+   {
+      if (file.path.compare(0, prefix.size(), prefix) != 0) continue;
+      found = true;
+
+      // Files deeper down show up as their directory, once
+      size_t slash = file.path.find('/', prefix.size());
+      std::string name = file.path.substr(prefix.size(), slash == std::string::npos ? std::string::npos : slash - prefix.size());
+      bool isDirectory = slash != std::string::npos;
+      bool listed = std::any_of(entries.begin() + firstEntry, entries.end(),
+                                [&](const StorageEntry& e) { return e.name == name; });
+      if (!listed) entries.push_back({ name, isDirectory, isDirectory ? 0 : (uint32_t)file.content.size() });
+   }
+   return found;
+}
+
+bool RamDisk::exists(const char* path)
+{
+   if (find(path)) return true;
+   // Directories exist as long as there are files in them
+   std::vector<StorageEntry> entries;
+   return list(path, entries);
+}
@@ -0,0 +1,38 @@
+/*
+ * Storage backend that keeps the files in RAM
+ * For tests and benchmarks of the file handling without an SD card, and for small files that are generated at
+ * runtime.
+ */
+
+#ifndef ESP32_BUZZER_RAMDISK_H
+#define ESP32_BUZZER_RAMDISK_H
+
+#include "storage.h"
+
+class RamDisk : public StorageBackend
+{
+private:
+   struct RamFileData
+   {
+      std::string path;
+      std::vector<uint8_t> content;
+   };
+   std::vector<RamFileData> files;
+
+   const RamFileData* find(const char* path) const;
+
+public:
+   /**
+    * \brief Add a file (the data is copied), an existing file with the same path is replaced
+    * \param path Full path starting with "/", directories are implied by the paths of the files
+    */
+   void addFile(const char* path, const uint8_t* data, size_t size);
+   bool removeFile(const char* path);
+   void clear() { files.clear(); }
+
+   StorageFilePtr open(const char* path) override;
+   bool list(const char* dir, std::vector<StorageEntry>& entries) override;
+   bool exists(const char* path) override;
+};
+
+#endif //ESP32_BUZZER_RAMDISK_H
@@ -0,0 +1,65 @@
+/*
+ * Storage layer
+ */
+
+#include "storage.h"
+#include <cstring>
+
+Storage storage;
+
+bool Storage::mount(const char* name, const char* prefix, StorageBackend* backend)
+{
+   int count = mountCount.load(std::memory_order_relaxed);
+   if (count >= STORAGE_MAX_MOUNTS || !backend) return false;
+   std::string p = prefix;
+   while (!p.empty() && p.back() == '/') p.pop_back();
+   mounts[count] = { name, p, backend };
+   mountCount.store(count + 1, std::memory_order_release);
+   return true;
+}
+
+/**
+ * \brief Find the backend for a path
+ * \param[out] backendPath Path within the backend, points into path (no copy, files are opened during playback)
+ * \return Backend or nullptr if nothing is mounted there
+ */
+StorageBackend* Storage::resolve(const char* path, const char*& backendPath) const
+{
+   const Mount* best = nullptr;
+   for (int i = 0; i < mountCount; i++)
+   {
+      const Mount& m = mounts[i];
+      if (isInPath(path, m.prefix.c_str()) && (!best || m.prefix.size() > best->prefix.size())) best = &m;
+   }
+   if (!best) return nullptr;
+   backendPath = path + best->prefix.size();
+   if (!*backendPath) backendPath = "/";
+   return best->backend;
+}
+
+StorageFilePtr Storage::open(const char* path) const
+{
+   const char* backendPath;
+   StorageBackend* backend = resolve(path, backendPath);
+   return backend ? backend->open(backendPath) : nullptr;
+}
+
+bool Storage::list(const char* dir, std::vector<StorageEntry>& entries) const
+{
+   const char* backendPath;
+   StorageBackend* backend = resolve(dir, backendPath);
+   return backend && backend->list(backendPath, entries);
+}
+
+bool Storage::exists(const char* path) const
+{
+   const char* backendPath;
+   StorageBackend* backend = resolve(path, backendPath);
+   return backend && backend->exists(backendPath);
+}
+
+bool isInPath(const char* path, const char* dir)
+{
+   size_t len = strlen(dir);
+   return strncmp(path, dir, len) == 0 && (path[len] == '/' || path[len] == '\0');
+}
@@ -0,0 +1,109 @@
+/*
+ * Storage layer
+ * Small read-only file interface with backends for SD, LittleFS (internal flash) and a RAM disk. Backends are
+ * mounted at path prefixes, e.g. SD at "/" and LittleFS at "/flash", so a sound can be moved to internal flash by
+ * just changing its path. The RAM disk allows running the file handling without any card.
+ */
+
+#ifndef ESP32_BUZZER_STORAGE_H
+#define ESP32_BUZZER_STORAGE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs { class FS; }
+
+#define STORAGE_MAX_MOUNTS 4
+
+struct StorageEntry
+{
+   std::string name; // Name without the directory
+   bool isDirectory;
+   uint32_t size;
+};
+
+class StorageFile
+{
+public:
+   virtual ~StorageFile() = default; // Closes the file
+   virtual size_t read(uint8_t* data, size_t len) = 0;
+   virtual bool seek(uint32_t pos) = 0;
+   virtual uint32_t position() const = 0;
+   virtual uint32_t size() const = 0;
+};
+
+using StorageFilePtr = std::unique_ptr<StorageFile>;
+
+class StorageBackend
+{
+public:
+   virtual ~StorageBackend() = default;
+
+   /**
+    * \brief Open a file for reading
+    * \param path Path within the backend, starting with "/"
+    * \return File or nullptr if it does not exist
+    */
+   virtual StorageFilePtr open(const char* path) = 0;
+
+   /**
+    * \brief List a directory
+    * \param[out] entries Entries are appended
+    * \return false if the directory does not exist
+    */
+   virtual bool list(const char* dir, std::vector<StorageEntry>& entries) = 0;
+
+   virtual bool exists(const char* path) = 0;
+
+   /**
+    * \return Arduino file system of the backend (for the FTP server) or nullptr if there is none
+    */
+   virtual fs::FS* getFS() { return nullptr; }
+};
+
+class Storage
+{
+private:
+   struct Mount
+   {
+      const char* name;
+      std::string prefix; // Without trailing "/", empty for the root
+      StorageBackend* backend;
+   };
+   Mount mounts[STORAGE_MAX_MOUNTS];
+   std::atomic<int> mountCount{ 0 }; // Mounts are added by the boot task while the playback task may resolve paths
+
+   StorageBackend* resolve(const char* path, const char*& backendPath) const;
+
+public:
+   /**
+    * \brief Mount a backend, paths starting with the prefix go to it (the longest prefix wins)
+    * \param name Name for logs and the FTP server
+    * \param prefix Path prefix like "/flash", "/" for the root
+    * \return false if there are too many mounts
+    */
+   bool mount(const char* name, const char* prefix, StorageBackend* backend);
+
+   StorageFilePtr open(const char* path) const;
+   bool list(const char* dir, std::vector<StorageEntry>& entries) const;
+   bool exists(const char* path) const;
+
+   int getMountCount() const { return mountCount; }
+   const char* getMountName(int index) const { return mounts[index].name; }
+   StorageBackend* getBackend(int index) const { return mounts[index].backend; }
+};
+
+extern Storage storage;
+
+/**
+ * \brief Check if a path is a file or directory itself or inside of it
+ * \param path Path to check, e.g. "/soundboard/1_Foo/1_bar.wav"
+ * \param dir Path without trailing "/", e.g. "/soundboard/1_Foo", empty for the root
+ */
+bool isInPath(const char* path, const char* dir);
+
+#endif //ESP32_BUZZER_STORAGE_H
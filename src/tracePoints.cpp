@@ -0,0 +1,44 @@
+/*
+ * Trace points
+ */
+
+#include "tracePoints.h"
+
+#if TRACE_POINTS
+
+TracePoints tracePoints;
+
+void TracePoints::loop()
+{
+   while (Serial.available())
+   {
+      if (Serial.read() == TRACE_POINTS_DUMP_KEY) dump(Serial);
+   }
+}
+
+void TracePoints::dump(Print& out)
+{
+   paused = true;
+   delay(1); // Lets events that are being written on the other core finish
+   uint32_t end = next.load();
+   uint32_t count = min(end, (uint32_t)TRACE_POINTS_EVENTS);
+
+   // Tab separated, trace_to_chrome.py looks for the lines between the markers
+   char line[96];
+   snprintf(line, sizeof line, "TRACE DUMP cpu_mhz=%u events=%u overwritten=%u\n", (unsigned)ESP.getCpuFreqMHz(),
+            (unsigned)count, (unsigned)(end - count));
+   out.write(line);
+   for (uint32_t i = end - count; i != end; i++)
+   {
+      const TraceEvent& event = events[i % TRACE_POINTS_EVENTS];
+      snprintf(line, sizeof line, "%u\t%u\t%c\t%s\t%s\n", (unsigned)event.cycles, (unsigned)event.core,
+               "BEi"[event.type], event.task ? event.task : "?", event.name);
+      out.write(line);
+   }
+   out.write("TRACE END\n");
+
+   next = 0;
+   paused = false;
+}
+
+#endif
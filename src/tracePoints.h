@@ -0,0 +1,107 @@
+/*
+ * Trace points
+ * TRACE_BEGIN/TRACE_END/TRACE_SCOPE mark spans and TRACE_INSTANT single moments in the loop stages, the playback
+ * task, SD reads and the FTP task. With TRACE_POINTS=1 (env:trace) each one writes its name, type, core, task and the
+ * cycle counter into a fixed ring of the last TRACE_POINTS_EVENTS events, for both cores and all tasks. Sending 't'
+ * over the serial port dumps the ring as text; scripts/trace_to_chrome.py turns the dump into a Chrome trace, to be
+ * opened in Perfetto or chrome://tracing. Without TRACE_POINTS the macros are empty and nothing of this is built.
+ */
+
+#ifndef ESP32_BUZZER_TRACEPOINTS_H
+#define ESP32_BUZZER_TRACEPOINTS_H
+
+#ifndef TRACE_POINTS
+#define TRACE_POINTS 0
+#endif
+
+#if TRACE_POINTS
+
+#include <atomic>
+#include <cstdint>
+#include <Arduino.h>
+
+#define TRACE_POINTS_EVENTS 1024 // 16kB, power of two
+#define TRACE_POINTS_DUMP_KEY 't'
+
+// Names have to be string literals, only their address is stored
+#define TRACE_BEGIN(name) tracePoints.add(TRACE_EVENT_BEGIN, name)
+#define TRACE_END(name) tracePoints.add(TRACE_EVENT_END, name)
+#define TRACE_INSTANT(name) tracePoints.add(TRACE_EVENT_INSTANT, name)
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+enum TraceEventType : uint8_t
+{
+   TRACE_EVENT_BEGIN,
+   TRACE_EVENT_END,
+   TRACE_EVENT_INSTANT
+};
+
+struct TraceEvent
+{
+   uint32_t cycles; // CPU cycle counter of the core, wraps every 18s at 240MHz
+   const char* name;
+   const char* task; // Name in the task control block
+   TraceEventType type;
+   uint8_t core;
+};
+
+class TracePoints
+{
+private:
+   TraceEvent events[TRACE_POINTS_EVENTS]{};
+   std::atomic<uint32_t> next{ 0 }; // Counts up, the ring keeps the last events
+   std::atomic<bool> paused{ false };
+
+public:
+   /**
+    * \brief Record an event, use the TRACE_ macros
+    */
+   void add(TraceEventType type, const char* name)
+   {
+      if (paused.load(std::memory_order_relaxed)) return;
+      TraceEvent& event = events[next.fetch_add(1, std::memory_order_relaxed) % TRACE_POINTS_EVENTS];
+      event.cycles = ESP.getCycleCount();
+      event.name = name;
+      event.task = pcTaskGetTaskName(nullptr);
+      event.type = type;
+      event.core = (uint8_t)xPortGetCoreID();
+   }
+
+   /**
+    * \brief Dump the ring when TRACE_POINTS_DUMP_KEY was received over the serial port, call once per loop
+    */
+   void loop();
+
+   /**
+    * \brief Write the recorded events as text and start over. Recording is paused while writing.
+    */
+   void dump(Print& out);
+};
+
+extern TracePoints tracePoints;
+
+/**
+ * \brief Span from its construction to the end of the block
+ */
+class TraceScope
+{
+private:
+   const char* name;
+
+public:
+   explicit TraceScope(const char* name) : name(name) { TRACE_BEGIN(name); }
+   ~TraceScope() { TRACE_END(name); }
+};
+
+#else
+
+#define TRACE_BEGIN(name) do {} while (0)
+#define TRACE_END(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#define TRACE_SCOPE(name) do {} while (0)
+
+#endif
+
+#endif //ESP32_BUZZER_TRACEPOINTS_H